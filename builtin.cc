@@ -0,0 +1,47 @@
+/* ked -- simple text editor with minimal dependency */
+/* Copyright (C) 2019  Koki Fukuda */
+
+/* This program is free software: you can redistribute it and/or modify */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or */
+/* (at your option) any later version. */
+
+/* This program is distributed in the hope that it will be useful, */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the */
+/* GNU General Public License for more details. */
+
+/* You should have received a copy of the GNU General Public License */
+/* along with this program.  If not, see <https://www.gnu.org/licenses/>. */
+
+#include <ked/Extension.hh>
+#include <ked/Ui.hh>
+
+#include "ked.hh"
+
+/* Extensions are linked into the executable by `make static', which
+ * defines KED_BUILTIN_SYSTEM. Hooks of them are named by EXTENSION_HOOK. */
+#ifdef KED_BUILTIN_SYSTEM
+extern "C" {
+void system_extension_on_load();
+void system_extension_on_attach_ui(Ked::Ui &ui);
+void system_extension_on_unload();
+}
+#endif
+
+static const Ked::Extension::Builtin builtins[] = {
+#ifdef KED_BUILTIN_SYSTEM
+    {"system",
+     {&system_extension_on_load, &system_extension_on_unload,
+      &system_extension_on_attach_ui, nullptr}},
+#endif
+    {nullptr, {nullptr, nullptr, nullptr, nullptr}}};
+
+int builtin_load(void) {
+    int n = 0;
+    for (const Ked::Extension::Builtin *ext = builtins; ext->name != nullptr;
+         ++ext, ++n)
+        Ked::Extension::load_builtin(*ext);
+
+    return n;
+}
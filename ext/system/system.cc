@@ -16,28 +16,71 @@
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <string>
+
 #include <ked/Face.hh>
+#include <ked/Highlight.hh>
+#include <ked/Profile.hh>
 #include <ked/Rune.hh>
+#include <ked/Session.hh>
 #include <ked/ked.hh>
 
 namespace SystemExtension {
     static Ked::String *lf;
 
     static std::size_t current_col = 0;
-    static bool moving;
+    /* Where the last line move left the cursor. current_col is kept while
+     * the cursor stays there. */
+    static Ked::Buffer *goal_buf;
+    static std::size_t goal_point;
+
+    /* Takes column of the cursor as the goal of line moves unless the cursor
+     * is where the last line move left it. */
+    static void update_goal_column(Ked::Buffer &buf) {
+        if (&buf == goal_buf && buf.point == goal_point) return;
+
+        /* Line start of the cursor is usually known by the layout, so this
+         * does not scan long lines. */
+        current_col = buf.point - buf.line_start(buf.point) + 1;
+    }
+
+    static void set_goal_point(Ked::Buffer &buf) {
+        goal_buf = &buf;
+        goal_point = buf.point;
+    }
+
+    DEFINE_EDITOR_COMMAND(cursor_forward) {
+        if (buf.point == buf.buf_size - (buf.gap_end - buf.gap_start)) {
+            ui.command_failed("End of buffer");
 
-    DEFINE_EDITOR_COMMAND(cursor_forward) { buf.cursor_move(1, true); }
+            return;
+        }
+
+        buf.cursor_move(1, true);
+    }
 
-    DEFINE_EDITOR_COMMAND(cursor_back) { buf.cursor_move(1, false); }
+    DEFINE_EDITOR_COMMAND(cursor_back) {
+        if (buf.point == 0) {
+            ui.command_failed("Beginning of buffer");
+
+            return;
+        }
+
+        buf.cursor_move(1, false);
+    }
 
     DEFINE_EDITOR_COMMAND(cursor_forward_line) {
+        update_goal_column(buf);
+
         Ked::SearchResult *result = buf.search(buf.point, *lf, true);
         std::size_t rest;
         if (result == nullptr) {
-            moving = true;
             buf.cursor_move(
                 buf.buf_size - (buf.gap_end - buf.gap_start) - buf.point, true);
-            moving = false;
+            ui.command_failed("End of buffer");
 
             return;
         } else {
@@ -50,33 +93,30 @@ namespace SystemExtension {
 
         result = buf.search(n_start, *lf, true);
         if (result == nullptr) {
-            moving = true;
             buf.cursor_move(rest + current_col, true);
-            moving = false;
         } else {
             /* If I use result->end here, it includes '\n' so exclusive line end
              * point is result->start. */
             std::size_t len = result->start - n_start;
             if (len > current_col) {
-                moving = true;
                 buf.cursor_move(rest + current_col, 1);
-                moving = false;
             } else {
-                moving = true;
                 buf.cursor_move(rest + len + 1, true);
-                moving = false;
             }
         }
 
         delete result;
+
+        set_goal_point(buf);
     }
 
     DEFINE_EDITOR_COMMAND(cursor_back_line) {
+        update_goal_column(buf);
+
         Ked::SearchResult *result = buf.search(buf.point, *lf, false);
         if (result == nullptr) {
-            moving = true;
             buf.cursor_move(buf.point, false);
-            moving = false;
+            ui.command_failed("Beginning of buffer");
 
             return;
         }
@@ -94,16 +134,14 @@ namespace SystemExtension {
             len = n_end - result->start;
 
         if (len > current_col) {
-            moving = true;
             buf.cursor_move(rest + len - current_col + 1, false);
-            moving = false;
         } else {
-            moving = true;
             buf.cursor_move(rest + 1, false);
-            moving = false;
         }
 
         delete result;
+
+        set_goal_point(buf);
     }
 
     DEFINE_EDITOR_COMMAND(cursor_beginning_of_line) {
@@ -132,43 +170,254 @@ namespace SystemExtension {
 
     DEFINE_EDITOR_COMMAND(buffer_save) { buf.save(); }
 
+    DEFINE_EDITOR_COMMAND(session_save) {
+        if (Ked::Session::save(ui, true))
+            ui.write_message("Session saved");
+        else
+            ui.command_failed("Cannot save session");
+    }
+
+    DEFINE_EDITOR_COMMAND(toggle_truncate_lines) {
+        buf.set_truncate_lines(!buf.truncate_lines);
+    }
+
+    DEFINE_EDITOR_COMMAND(macro_start) { ui.start_macro(); }
+
+    DEFINE_EDITOR_COMMAND(macro_stop) { ui.stop_macro(); }
+
+    DEFINE_EDITOR_COMMAND(macro_replay) { ui.replay_macro(1); }
+
+    DEFINE_EDITOR_COMMAND(macro_replay_all) { ui.replay_macro(0); }
+
+    DEFINE_EDITOR_COMMAND(show_profile) {
+        Ked::Buffer *report = ui.buffer_find("*profile*");
+        if (report == nullptr) {
+            report = new Ked::Buffer("*profile*");
+            ui.buffer_add(report);
+        }
+
+        std::string text = Ked::Profile::report();
+        if (!Ked::Profile::enabled())
+            text = "Profiling is off. Start ked with --profile, or run "
+                   "toggle_profile.\n\n" +
+                   text;
+        report->clear();
+        report->insert_utf8(text.data(), text.size());
+        report->cursor_move(report->point, false);
+
+        ui.buffer_select("*profile*");
+    }
+
+    DEFINE_EDITOR_COMMAND(toggle_profile) {
+        Ked::Profile::set_enabled(!Ked::Profile::enabled());
+        ui.write_message(Ked::Profile::enabled() ? "Profiling on"
+                                                 : "Profiling off");
+    }
+
+    DEFINE_EDITOR_COMMAND(buffer_next) {
+        ui.buffer_cycle(1);
+        ui.write_message(ui.current_buffer->buf_name);
+    }
+
+    DEFINE_EDITOR_COMMAND(buffer_previous) {
+        ui.buffer_cycle(-1);
+        ui.write_message(ui.current_buffer->buf_name);
+    }
+
+    DEFINE_EDITOR_COMMAND(split_window_below) {
+        if (!ui.split_window(false)) ui.command_failed("Window too small");
+    }
+
+    DEFINE_EDITOR_COMMAND(split_window_right) {
+        if (!ui.split_window(true)) ui.command_failed("Window too small");
+    }
+
+    DEFINE_EDITOR_COMMAND(delete_window) {
+        if (!ui.delete_window())
+            ui.command_failed("Cannot delete the only window");
+    }
+
+    DEFINE_EDITOR_COMMAND(delete_other_windows) { ui.delete_other_windows(); }
+
+    DEFINE_EDITOR_COMMAND(other_window) { ui.other_window(1); }
+
     DEFINE_EDITOR_COMMAND(editor_quit) { ui.exit_editor(); }
 
+    DEFINE_EDITOR_COMMAND(process_stop) { ui.suspend(); }
+
     DEFINE_EDITOR_COMMAND(display_way_of_quit) {
         ui.write_message("Ctrl+Q to quit.");
     }
 
-    static void on_cursor_move(Ked::Buffer &buf) {
-        if (moving) return;
+    /* Lexer states of C grammar at line ends. */
+    enum CState { C_NORMAL, C_COMMENT };
+
+    /* Sorted for binary search. */
+    static char const *const c_keywords[] = {
+        "auto",     "bool",     "break",    "case",      "catch",
+        "char",     "class",    "const",    "constexpr", "continue",
+        "default",  "delete",   "do",       "double",    "else",
+        "enum",     "extern",   "false",    "float",     "for",
+        "goto",     "if",       "inline",   "int",       "long",
+        "namespace", "new",     "nullptr",  "private",   "protected",
+        "public",   "register", "return",   "short",     "signed",
+        "sizeof",   "static",   "struct",   "switch",    "template",
+        "this",     "throw",    "true",     "try",       "typedef",
+        "typename", "union",    "unsigned", "using",     "virtual",
+        "void",     "volatile", "while"};
+
+    static Ked::Face::FaceId face_keyword;
+    static Ked::Face::FaceId face_comment;
+    static Ked::Face::FaceId face_string;
+    static Ked::Face::FaceId face_number;
+    static Ked::Face::FaceId face_preprocessor;
+
+    /* Returns the byte if the rune is ASCII, or 0x80 otherwise. */
+    static unsigned char ascii_at(Ked::Buffer &buf, std::size_t p) {
+        Ked::Rune const &r = buf.get_rune(p).c;
+
+        return r[1] == 0 ? r[0] : 0x80;
+    }
 
-        Ked::SearchResult *result = buf.search(buf.point, *lf, false);
-        if (result == nullptr)
-            current_col = buf.point;
-        else
-            current_col = buf.point - result->start;
+    static bool is_ident_char(unsigned char c) {
+        return c == '_' || (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') ||
+               (c >= 'A' && c <= 'Z');
+    }
+
+    static bool is_c_keyword(std::string const &word) {
+        return std::binary_search(std::begin(c_keywords), std::end(c_keywords),
+                                  word.c_str(),
+                                  [](char const *a, char const *b) {
+                                      return std::strcmp(a, b) < 0;
+                                  });
+    }
+
+    static void paint(Ked::Buffer &buf, std::size_t start, std::size_t end,
+                      Ked::Face::FaceId face) {
+        for (std::size_t p = start; p < end; ++p) buf.get_rune(p).face = face;
     }
 
-    static void on_buffer_entry_change(std::vector<Ked::Buffer *> &bufs) {
-        for (auto itr = std::begin(bufs); itr != std::end(bufs); ++itr) {
-            if ((*itr)->buf_name == "__system_header__")
-                (*itr)->default_face_name = "SystemHeader";
-            else if ((*itr)->buf_name == "__system_footer__")
-                (*itr)->default_face_name = "SystemFooter";
-            else
-                (*itr)->add_cursor_move_listener(&on_cursor_move);
+    static Ked::Highlight::State lex_c(Ked::Buffer &buf, std::size_t start,
+                                       std::size_t end,
+                                       Ked::Highlight::State state) {
+        paint(buf, start, end, FACE_ID_DEFAULT);
+
+        bool leading = true;
+        std::size_t i = start;
+        while (i < end) {
+            std::size_t from = i;
+
+            if (state == C_COMMENT) {
+                while (i < end && !(ascii_at(buf, i) == '*' && i + 1 < end &&
+                                    ascii_at(buf, i + 1) == '/'))
+                    ++i;
+                if (i < end) {
+                    i += 2;
+                    state = C_NORMAL;
+                }
+                paint(buf, from, i, face_comment);
+
+                continue;
+            }
+
+            unsigned char c = ascii_at(buf, i);
+            unsigned char next = i + 1 < end ? ascii_at(buf, i + 1) : 0;
+            if (c == '/' && next == '/') {
+                paint(buf, i, end, face_comment);
+
+                break;
+            } else if (c == '/' && next == '*') {
+                i += 2;
+                state = C_COMMENT;
+                paint(buf, from, i, face_comment);
+            } else if (c == '#' && leading) {
+                paint(buf, i, end, face_preprocessor);
+
+                break;
+            } else if (c == '"' || c == '\'') {
+                for (++i; i < end && ascii_at(buf, i) != c; ++i) {
+                    if (ascii_at(buf, i) == '\\') ++i;
+                }
+                i = std::min(i + 1, end);
+                paint(buf, from, i, face_string);
+            } else if (c >= '0' && c <= '9') {
+                while (i < end && is_ident_char(ascii_at(buf, i))) ++i;
+                paint(buf, from, i, face_number);
+            } else if (is_ident_char(c)) {
+                std::string word;
+                while (i < end && is_ident_char(ascii_at(buf, i)))
+                    word.push_back(ascii_at(buf, i++));
+                if (is_c_keyword(word)) paint(buf, from, i, face_keyword);
+            } else {
+                ++i;
+            }
+
+            if (c != ' ' && c != '\t') leading = false;
         }
+
+        return state;
+    }
+
+    static bool has_suffix(std::string const &s, char const *suffix) {
+        std::size_t len = std::strlen(suffix);
+
+        return s.size() >= len && s.compare(s.size() - len, len, suffix) == 0;
+    }
+
+    static void on_buffer_added(Ked::Ui &ui, Ked::BufferAddedEvent const &ev) {
+        if (ev.buf->buf_name == "__system_header__")
+            ev.buf->default_face = Ked::Face::id("SystemHeader");
+        else if (ev.buf->buf_name == "__system_footer__")
+            ev.buf->default_face = Ked::Face::id("SystemFooter");
+
+        std::string const &path = ev.buf->path;
+        if (has_suffix(path, ".c") || has_suffix(path, ".h") ||
+            has_suffix(path, ".cc") || has_suffix(path, ".hh") ||
+            has_suffix(path, ".cpp") || has_suffix(path, ".hpp"))
+            ui.set_grammar(*ev.buf, "c");
     }
 
     extern "C" {
-    void extension_on_load() {
+    void EXTENSION_HOOK(extension_on_load)() {
         lf = new Ked::String("\n");
 
-        moving = 0;
         current_col = 1;
+        goal_buf = nullptr;
+        goal_point = 0;
     }
 
-    void extension_on_attach_ui(Ked::Ui &ui) {
-        ui.add_buffer_entry_change_listener(&on_buffer_entry_change);
+    void EXTENSION_HOOK(extension_on_attach_ui)(Ked::Ui &ui) {
+        ui.events.on_buffer_added([&ui](Ked::BufferAddedEvent const &ev) {
+            on_buffer_added(ui, ev);
+        });
+
+        ADD_EDITOR_COMMAND(ui, cursor_forward);
+        ADD_EDITOR_COMMAND(ui, cursor_back);
+        ADD_EDITOR_COMMAND(ui, cursor_forward_line);
+        ADD_EDITOR_COMMAND(ui, cursor_back_line);
+        ADD_EDITOR_COMMAND(ui, cursor_beginning_of_line);
+        ADD_EDITOR_COMMAND(ui, cursor_end_of_line);
+        ADD_EDITOR_COMMAND(ui, delete_backward);
+        ADD_EDITOR_COMMAND(ui, delete_forward);
+        ADD_EDITOR_COMMAND(ui, buffer_save);
+        ADD_EDITOR_COMMAND(ui, session_save);
+        ADD_EDITOR_COMMAND(ui, buffer_next);
+        ADD_EDITOR_COMMAND(ui, buffer_previous);
+        ADD_EDITOR_COMMAND(ui, toggle_truncate_lines);
+        ADD_EDITOR_COMMAND(ui, macro_start);
+        ADD_EDITOR_COMMAND(ui, macro_stop);
+        ADD_EDITOR_COMMAND(ui, macro_replay);
+        ADD_EDITOR_COMMAND(ui, macro_replay_all);
+        ADD_EDITOR_COMMAND(ui, show_profile);
+        ADD_EDITOR_COMMAND(ui, toggle_profile);
+        ADD_EDITOR_COMMAND(ui, split_window_below);
+        ADD_EDITOR_COMMAND(ui, split_window_right);
+        ADD_EDITOR_COMMAND(ui, delete_window);
+        ADD_EDITOR_COMMAND(ui, delete_other_windows);
+        ADD_EDITOR_COMMAND(ui, other_window);
+        ADD_EDITOR_COMMAND(ui, editor_quit);
+        ADD_EDITOR_COMMAND(ui, process_stop);
+        ADD_EDITOR_COMMAND(ui, display_way_of_quit);
 
         ui.add_global_keybind("^[[A", EDITOR_COMMAND_PTR(cursor_back_line));
         ui.add_global_keybind("^[[B", EDITOR_COMMAND_PTR(cursor_forward_line));
@@ -186,16 +435,39 @@ namespace SystemExtension {
         ui.add_global_keybind("^Q", EDITOR_COMMAND_PTR(editor_quit));
         ui.add_global_keybind("^X^C", EDITOR_COMMAND_PTR(editor_quit));
         ui.add_global_keybind("^X^S", EDITOR_COMMAND_PTR(buffer_save));
-        /* ui.add_global_keybind("^Z", EDITOR_COMMAND_PTR(process_stop)); */
+        ui.add_global_keybind("^Xs", EDITOR_COMMAND_PTR(session_save));
+        ui.add_global_keybind("^X^[[C", EDITOR_COMMAND_PTR(buffer_next));
+        ui.add_global_keybind("^X^[[D", EDITOR_COMMAND_PTR(buffer_previous));
+        ui.add_global_keybind("^X(", EDITOR_COMMAND_PTR(macro_start));
+        ui.add_global_keybind("^X)", EDITOR_COMMAND_PTR(macro_stop));
+        ui.add_global_keybind("^Xe", EDITOR_COMMAND_PTR(macro_replay));
+        ui.add_global_keybind("^XE", EDITOR_COMMAND_PTR(macro_replay_all));
+        ui.add_global_keybind("^Xp", EDITOR_COMMAND_PTR(show_profile));
+        ui.add_global_keybind("^X0", EDITOR_COMMAND_PTR(delete_window));
+        ui.add_global_keybind("^X1",
+                              EDITOR_COMMAND_PTR(delete_other_windows));
+        ui.add_global_keybind("^X2", EDITOR_COMMAND_PTR(split_window_below));
+        ui.add_global_keybind("^X3", EDITOR_COMMAND_PTR(split_window_right));
+        ui.add_global_keybind("^Xo", EDITOR_COMMAND_PTR(other_window));
+        ui.add_global_keybind("^Xt",
+                              EDITOR_COMMAND_PTR(toggle_truncate_lines));
+        ui.add_global_keybind("^Z", EDITOR_COMMAND_PTR(process_stop));
         ui.add_global_keybind("^F", EDITOR_COMMAND_PTR(cursor_forward));
         ui.add_global_keybind("\x7f", EDITOR_COMMAND_PTR(delete_backward));
 
-        Ked::Face::add("", FACE_NONE);
         Ked::Face::add("SystemHeader", FACE_ATTR_COLOR_256(1, 16, 231));
         Ked::Face::add("SystemFooter", FACE_COLOR_256(16, 231));
+        Ked::Face::add("WindowDivider", FACE_COLOR_256(16, 231));
+
+        face_keyword = Ked::Face::add("Keyword", FACE_FG_256(4));
+        face_comment = Ked::Face::add("Comment", FACE_FG_256(8));
+        face_string = Ked::Face::add("String", FACE_FG_256(2));
+        face_number = Ked::Face::add("Number", FACE_FG_256(5));
+        face_preprocessor = Ked::Face::add("Preprocessor", FACE_FG_256(3));
+        Ked::Highlight::add_grammar("c", &lex_c);
     }
 
-    void extension_on_unload() {
+    void EXTENSION_HOOK(extension_on_unload)() {
         delete lf;
         lf = nullptr;
     }
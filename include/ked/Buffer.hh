@@ -19,17 +19,31 @@
 #ifndef KED_BUFFER_HH
 #define KED_BUFFER_HH
 
+#include <ctime>
 #include <functional>
+#include <map>
+#include <mutex>
 #include <string>
+#include <vector>
 
+#include "EventBus.hh"
+#include "Keybind.hh"
 #include "Rune.hh"
 
 /* Amont of buffer allocate once.  */
 #define INIT_GAP_SIZE 1024
 /* Allocates additional buffer when gap is smaller than MIN_GAP_SIZE. */
 #define MIN_GAP_SIZE 32
+/* Runes looked back at most to find where a grapheme cluster starts. */
+#define MAX_CLUSTER_CONTEXT 128
+/* Lines shorter than this are laid out every time instead of being cached. */
+#define MIN_CACHED_LINE_LENGTH 1024
+/* Runes between entries of the column index. */
+#define COLUMN_INDEX_INTERVAL 256
 
 namespace Ked {
+    class Journal;
+
     enum LineEnding { LEND_LF, LEND_CR, LEND_CRLF };
 
     struct SearchResult {
@@ -40,18 +54,124 @@ namespace Ked {
     /* Buffer struct defines editing buffer for each file. every edit event take
      * place on buffer, rather than UI. */
     class Buffer {
-        struct BufferListener {
-            std::vector<std::function<void(Buffer &)>> listener;
-            bool calling;
+    public:
+        /* Soft wrap layout of a line. */
+        struct LineLayout {
+            /* Number of runes in the line, excluding LF. */
+            std::size_t length;
+            /* Offsets from the line start where wrapped rows begin. */
+            std::vector<std::size_t> breaks;
+            /* Offset until which breaks are known. Equals length once the
+             * whole line is laid out. */
+            std::size_t laid_out;
+            /* Column index of truncated line; columns[k] is the column where
+             * cluster at column_offsets[k] begins. */
+            std::vector<std::size_t> column_offsets;
+            std::vector<std::size_t> columns;
+            /* Whether column index covers the whole line. */
+            bool column_indexed;
+        };
+
+        /* Layouts of long lines keyed by the line start. Like the text,
+         * they are split at the last edit: ones after it are keyed by the
+         * distance from the end of the text, so that an edit moves only the
+         * ones between it and the previous edit. len is the length of the
+         * text in all functions. */
+        class LayoutMap {
+            std::map<std::size_t, LineLayout> before;
+            std::map<std::size_t, LineLayout> after;
+
+        public:
+            /* Returns layout of the line starting at start, or nullptr. */
+            LineLayout *find(std::size_t start, std::size_t len);
+            /* Returns layout of the line starting at start, adding one if
+             * missing. */
+            LineLayout &get(std::size_t start, std::size_t len);
+            /* Returns the last layout of a line starting at or before p and
+             * sets start to its start, or returns nullptr if none. */
+            LineLayout const *last_at(std::size_t p, std::size_t len,
+                                      std::size_t &start) const;
+            /* Drops layouts made stale by replacing removed runes at pos
+             * with inserted ones. len is the length before the edit. */
+            void edit(std::size_t pos, std::size_t removed,
+                      std::size_t inserted, bool lf_changed, std::size_t len);
+            void clear();
+            void swap(LayoutMap &other);
+        };
 
-            void call(Buffer &buf);
+        /* Viewport of a window showing this buffer. The one in use lives in
+         * the members of Buffer itself, and the others are parked here. */
+        struct View {
+            std::size_t point;
+            std::size_t visible_start_point;
+            std::size_t display_range_x_start;
+            std::size_t display_range_x_end;
+            std::size_t display_range_y_start;
+            std::size_t display_range_y_end;
+            std::size_t cursor_x;
+            std::size_t cursor_y;
+            bool truncate_lines;
+            std::size_t scroll_x;
+            LayoutMap layouts;
+            /* Whether the text changed while parked, so that the cursor
+             * position must be computed again. */
+            bool edited;
         };
 
-        BufferListener on_cursor_move_listeners;
+    private:
+        /* Name of the mode whose keymap applies to this buffer. */
+        std::string mode_name;
+
+        /* Layouts of long lines. */
+        LayoutMap layouts;
+        /* Layout of the short line used last. */
+        LineLayout short_layout;
+
+        /* Views of the windows showing this buffer, and the one whose
+         * state is in the members now. */
+        std::vector<View *> views;
+        View *active_view;
+
+        /* Image content is mapped from, or nullptr if content is
+         * allocated. */
+        void *mapping;
+        std::size_t mapping_size;
+
+        /* Whether cursor_moved only records that it is called. */
+        bool updates_held;
+        bool cursor_pending;
 
         void update_cursor_position();
+        /* Follows the new point with the cursor and the screen, and raises
+         * point moved event if notify is true. */
+        void cursor_moved(bool notify);
+        /* Raises text changed event for replacing removed runes at pos with
+         * inserted ones, and updates layouts. */
+        void text_changed(std::size_t pos, std::size_t removed,
+                          std::size_t inserted, bool lf_changed);
+        /* Widens the gap by amount. content_mutex must be held. */
         void expand(std::size_t amount);
+        /* Reads content from path, or makes it empty if path is missing. */
+        void read_file();
+        /* Frees content, whether it is allocated or mapped. */
+        void release_content();
+        /* Moves the gap to point. Only editing needs the gap there, so
+         * moving the cursor alone never copies text. content_mutex must be
+         * held. */
+        void move_gap();
         void scroll_in_need();
+        /* Lays out the line until a row beginning after offset and at least
+         * n_breaks breaks are known. */
+        void lay_out(std::size_t start, LineLayout &layout, std::size_t offset,
+                     std::size_t n_breaks);
+        /* Extends column index of the line until an entry after both offset
+         * and column is known. */
+        void index_columns(std::size_t start, LineLayout &layout,
+                           std::size_t offset, std::size_t column);
+        /* Drops layouts made stale by replacing removed runes at pos with
+         * inserted ones, and keeps visible_start_point on the same text. */
+        void update_layouts(std::size_t pos, std::size_t removed,
+                            std::size_t inserted, bool lf_changed);
 
     public:
         /* Buffer name to be displayed. */
@@ -60,7 +180,8 @@ namespace Ked {
         std::string path;
         /* Buffer file path to be saved. */
         AttrRune *content;
-        /* Cursor position in this buffer excluding gap area. */
+        /* Cursor position in this buffer excluding gap area. The gap is not
+         * always there. */
         std::size_t point;
         /* Buffer size including gap. */
         std::size_t buf_size;
@@ -79,14 +200,40 @@ namespace Ked {
         std::size_t display_range_x_end;
         std::size_t display_range_y_start;
         std::size_t display_range_y_end;
+        /* Modification time and size of the file when it is read or saved
+         * last, which tell whether the file is changed by others. */
+        struct timespec file_mtime;
+        std::size_t file_size;
         /* Whether this buffer is modified of not. */
         bool modified;
-        /* Default face name. */
-        std::string default_face_name;
+        /* Incremented every time the text changes, with content_mutex
+         * held. */
+        unsigned long version;
+        /* Held while content or the gap is changed, and by job workers
+         * while they copy the text. */
+        std::mutex content_mutex;
+        /* Incremented every time faces of the text are changed by a
+         * highlighter. */
+        unsigned long paint_version;
+        /* Face of runes with no face. */
+        Face::FaceId default_face;
         /* Cursor X position in display area. */
         std::size_t cursor_x;
         /* Cursor Y position in display area. */
         std::size_t cursor_y;
+        /* Whether long lines are clipped to the display area instead of being
+         * wrapped. */
+        bool truncate_lines;
+        /* Column shown at the left edge when lines are truncated. */
+        std::size_t scroll_x;
+        /* Key bindings only for this buffer, preferred over the ones of the
+         * mode and global ones. */
+        KeyHandling::Keybind keybind;
+        /* Where events of this buffer go, set when added to Ui. */
+        EventBus *events;
+        /* Journal edits are recorded to, owned by this buffer, or nullptr.
+         * It is deleted with this buffer unless the edits are unsaved. */
+        Journal *journal;
 
         /* Constructor that initializes fundamental members. */
         Buffer();
@@ -96,6 +243,11 @@ namespace Ked {
         /* Constructs Buffer with buffer of content of path. path must be
          * regular file. */
         Buffer(std::string const &name, std::string const &path);
+        /* Constructs Buffer of path from image written by write_image,
+         * which is mapped instead of decoding the file. The file is read
+         * if the image is not of the file as it is now. */
+        Buffer(std::string const &name, std::string const &path,
+               std::string const &image);
         ~Buffer();
         /* Creates buffer for the path, specified in 1st argument, with name of
          * 2nd argument. If file is not exisiting, ked creates the file when
@@ -105,12 +257,48 @@ namespace Ked {
         void insert(Rune const &r);
         /* Insertes char to buffer point position. */
         void insert(char c);
-        /* Deletes 1 character backward. */
+        /* Insertes UTF-8 string to buffer point position at once, moving the
+         * cursor just once. */
+        void insert_utf8(char const *str, std::size_t len);
+        /* Replaces removed runes at pos with UTF-8 string as an edit,
+         * leaving the point after it. */
+        void replace(std::size_t pos, std::size_t removed, char const *str,
+                     std::size_t len);
+        /* Deletes whole text. */
+        void clear();
+        /* Deletes 1 grapheme cluster backward. */
         void delete_backward();
-        /* Deletes 1 character forward. */
+        /* Deletes 1 grapheme cluster forward. */
         void delete_forward();
-        /* Scroll for n lines vertically to forward or backward. */
-        void scroll(std::size_t n_lines, bool forward);
+        /* Moves this buffer to given range of the display, and lays out the
+         * visible part again. */
+        void set_display_range(std::size_t x_start, std::size_t x_end,
+                               std::size_t y_start, std::size_t y_end);
+        /* Defers following the point with the cursor until release_updates
+         * is called, so that many edits in a row pay for it once. */
+        void hold_updates();
+        void release_updates();
+        /* Starts following edits with view. The first view takes the
+         * current viewport, and the others start as its copy. */
+        void add_view(View &view);
+        void remove_view(View &view);
+        /* Parks the viewport in use and brings view in, so that members
+         * like point and cursor_x are those of view. */
+        void use_view(View &view);
+        /* Switches between wrapping and truncating long lines. */
+        void set_truncate_lines(bool truncate);
+        /* Assigns given function to given key sequence only in this
+         * buffer. */
+        void add_keybind(std::string const &key,
+                         KeyHandling::EditorCommand func);
+        /* Returns name of the mode this buffer is in, or empty string if
+         * none. */
+        std::string const &mode() const;
+        /* Puts this buffer in the mode, whose keymap is looked up after the
+         * buffer's own. */
+        void set_mode(std::string const &name);
+        /* Scroll for n rows vertically to forward or backward. */
+        void scroll(std::size_t n_rows, bool forward);
         /* Searches specified string from Buffer and returns the range it
          * occrrs. If
          * the string not found after or before start_point, returns null. */
@@ -118,13 +306,40 @@ namespace Ked {
                              bool forward) const;
         /* Saves buffer content. */
         bool save();
+        /* Writes the text to image to be mapped by the constructor later.
+         * Returns false if the text is modified or the file is changed
+         * since it is read. An image already up to date is kept as is. */
+        bool write_image(std::string const &image) const;
         /* Gets point's rune. */
         AttrRune &get_rune(std::size_t point) const;
         AttrRune *get_rune_ptr(std::size_t point) const;
-
-        /* Adds listener to be called just after change buffer's point in any
-         * way. */
-        void add_cursor_move_listener(std::function<void(Buffer &)> listener);
+        /* Returns the end of grapheme cluster starting at point p, and
+         * stores columns the cluster occupies to width if not null. */
+        std::size_t cluster_end(std::size_t p,
+                                unsigned int *width = nullptr) const;
+        /* Returns p if p is a boundary of grapheme clusters, or the nearest
+         * boundary after (if forward) or before p otherwise. */
+        std::size_t cluster_boundary(std::size_t p, bool forward) const;
+        /* Returns start of the line p is in. */
+        std::size_t line_start(std::size_t p) const;
+        /* Returns layout of the line starting at start. Layout of a short
+         * line is valid only until next call. */
+        LineLayout &line_layout(std::size_t start);
+        /* Returns the row of the line offset is in. */
+        std::size_t row_of(std::size_t start, LineLayout &layout,
+                           std::size_t offset);
+        /* Returns offset from line start where the row ends. */
+        std::size_t row_end(std::size_t start, LineLayout &layout,
+                            std::size_t row);
+        /* Returns the point the row p is in begins. */
+        std::size_t row_start(std::size_t p);
+        /* Returns the column offset is drawn at in truncated line. */
+        std::size_t column_of(std::size_t start, LineLayout &layout,
+                              std::size_t offset);
+        /* Returns offset of the cluster drawn over column in truncated line,
+         * and stores the column the cluster begins to cluster_column. */
+        std::size_t offset_at(std::size_t start, LineLayout &layout,
+                              std::size_t column, std::size_t *cluster_column);
     };
 
     Buffer *buffer_from_stdin();
@@ -0,0 +1,125 @@
+/*
+ * ked -- simple text editor with minimal dependency
+ * Copyright (C) 2019  Koki Fukuda
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef KED_EVENT_BUS_HH
+#define KED_EVENT_BUS_HH
+
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <vector>
+
+#include "Profile.hh"
+
+/* Times deliver repeats for events raised by listeners. */
+#define MAX_DELIVERY_ROUNDS 8
+
+namespace Ked {
+    class Buffer;
+
+    /* Text of buf in [start, end) may have changed; it was [start, old_end)
+     * before. Text outside of it is the same, shifted by end - old_end
+     * after the range. */
+    struct TextChangedEvent {
+        Buffer *buf;
+        std::size_t start;
+        std::size_t end;
+        std::size_t old_end;
+    };
+
+    struct PointMovedEvent {
+        Buffer *buf;
+        std::size_t point;
+    };
+
+    struct BufferAddedEvent {
+        Buffer *buf;
+    };
+
+    /* Visible part or display range of buf changed. */
+    struct ViewportChangedEvent {
+        Buffer *buf;
+    };
+
+    /* Collects events of buffers and delivers them to listeners at once.
+     * Events of the same kind on a buffer are merged until delivered, so a
+     * listener is called at most once per buffer however many edits were
+     * made. */
+    class EventBus {
+        struct Pending {
+            bool text_changed;
+            std::size_t start;
+            std::size_t end;
+            /* Runes inserted minus ones removed. */
+            long delta;
+            bool point_moved;
+            bool viewport_changed;
+        };
+
+        template <typename Event> struct Listener {
+            std::function<void(Event const &)> func;
+            /* Where time spent in func is counted. */
+            Profile::Site *site;
+        };
+
+        std::vector<Buffer *> added;
+        std::map<Buffer *, Pending> pending;
+
+        std::vector<Listener<TextChangedEvent>> text_changed_listeners;
+        std::vector<Listener<PointMovedEvent>> point_moved_listeners;
+        std::vector<Listener<BufferAddedEvent>> buffer_added_listeners;
+        std::vector<Listener<ViewportChangedEvent>> viewport_changed_listeners;
+
+        Pending &pending_of(Buffer *buf);
+
+        template <typename Event>
+        static void call(std::vector<Listener<Event>> const &listeners,
+                         Event const &ev) {
+            for (auto itr = std::begin(listeners); itr != std::end(listeners);
+                 ++itr) {
+                Profile::Scope scope(itr->site);
+                itr->func(ev);
+            }
+        }
+
+    public:
+        void on_text_changed(
+            std::function<void(TextChangedEvent const &)> listener);
+        void on_point_moved(
+            std::function<void(PointMovedEvent const &)> listener);
+        void on_buffer_added(
+            std::function<void(BufferAddedEvent const &)> listener);
+        void on_viewport_changed(
+            std::function<void(ViewportChangedEvent const &)> listener);
+
+        /* Records that removed runes at pos of buf were replaced with
+         * inserted ones. */
+        void text_changed(Buffer *buf, std::size_t pos, std::size_t removed,
+                          std::size_t inserted);
+        void point_moved(Buffer *buf);
+        void buffer_added(Buffer *buf);
+        void viewport_changed(Buffer *buf);
+        /* Drops events of buf, which is going to be deleted. */
+        void forget(Buffer *buf);
+
+        /* Calls listeners with events recorded so far. */
+        void deliver();
+    };
+} // namespace Ked
+
+#endif
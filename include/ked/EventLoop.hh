@@ -0,0 +1,91 @@
+/*
+ * ked -- simple text editor with minimal dependency
+ * Copyright (C) 2019  Koki Fukuda
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef KED_EVENT_LOOP_HH
+#define KED_EVENT_LOOP_HH
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <vector>
+
+#include <signal.h>
+
+namespace Ked {
+    /* Central loop of the editor that multiplexes file descriptors, timers,
+     * signals and requests from other threads with epoll. Every callback
+     * runs on the thread calling run_once. */
+    class EventLoop {
+        struct Timer {
+            bool repeat;
+            std::function<void()> callback;
+        };
+
+        int epoll_fd;
+        int signal_fd;
+        int wakeup_fd;
+        sigset_t signals;
+
+        std::map<int, std::function<void(std::uint32_t)>> fd_callbacks;
+        /* Timers keyed by its timerfd. */
+        std::map<int, Timer> timers;
+        std::map<int, std::vector<std::function<void()>>> signal_callbacks;
+
+        std::mutex posted_mutex;
+        std::vector<std::function<void()>> posted;
+
+        void dispatch_signals();
+        void dispatch_posted();
+        void dispatch_timer(int fd);
+
+    public:
+        EventLoop();
+        ~EventLoop();
+
+        /* Calls callback with epoll event bits every time fd gets ready for
+         * events. Returns false if fd cannot be watched. */
+        bool add_fd(int fd, std::uint32_t events,
+                    std::function<void(std::uint32_t)> callback);
+        /* Stops watching fd. */
+        void remove_fd(int fd);
+
+        /* Calls callback after ms milliseconds, and every ms milliseconds
+         * after that if repeat is true. Returns timer ID, or -1 on error. */
+        int add_timer(unsigned int ms, bool repeat,
+                      std::function<void()> callback);
+        /* Cancels timer returned by add_timer. */
+        void cancel_timer(int id);
+
+        /* Calls callback when signal sig arrives. The signal is blocked for
+         * calling thread; it must be blocked in other threads too, so block
+         * it before any thread is created. */
+        bool add_signal(int sig, std::function<void()> callback);
+
+        /* Runs callback on the loop thread as soon as possible. This is the
+         * only member function safe to call from other threads. */
+        void post(std::function<void()> callback);
+
+        /* Waits up to timeout_ms milliseconds (-1 to wait forever) for
+         * events, and dispatches all events ready at that time. Returns the
+         * number of sources dispatched. */
+        int run_once(int timeout_ms);
+    };
+} // namespace Ked
+
+#endif
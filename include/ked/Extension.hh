@@ -19,13 +19,50 @@
 #ifndef EXTENSION_HH
 #define EXTENSION_HH
 
+#include <functional>
 #include <string>
+#include <vector>
 
 #include "Ui.hh"
 
 namespace Ked {
     namespace Extension {
+        /* Hooks of an extension, any of which may be nullptr. */
+        struct Hooks {
+            void (*on_load)();
+            void (*on_unload)();
+            void (*on_attach_ui)(Ked::Ui &ui);
+            void (*on_detach_ui)(Ked::Ui &ui);
+        };
+
+        /* Extension linked into the executable. */
+        struct Builtin {
+            char const *name;
+            Hooks hooks;
+        };
+
         bool load(std::string const &path);
+        /* Loads extension linked into the executable. Extension files of
+         * the same name given to load_all are skipped after this. */
+        void load_builtin(Builtin const &ext);
+        /* Opens all extensions in parallel, and then calls their
+         * extension_on_load in the given order on the calling thread. The
+         * ones that failed to open are skipped, and their errors are stored
+         * to errors. Files already loaded or given earlier, by whatever
+         * path, and files named after such an extension are skipped.
+         * Returns false if any failed. */
+        bool load_all(std::vector<std::string> const &paths,
+                      std::vector<std::string> &errors);
+        /* Declares the extension at path, which provides commands, to be
+         * loaded the first time one of them runs. The commands are made
+         * available when UI is attached, so keys can be bound to them
+         * without loading the extension. */
+        void autoload(std::string const &path,
+                      std::vector<std::string> const &commands);
+        /* Sets callback called when an autoloaded extension has been
+         * attached to UI, before its command runs, so that preferences can
+         * override key bindings the extension added. */
+        void on_autoload_attached(std::function<void(Ked::Ui &ui)> callback);
         void unload_all();
 
         void attach_ui(Ked::Ui *ui);
@@ -19,13 +19,57 @@
 #ifndef FACE_HH
 #define FACE_HH
 
+#include <cstdint>
 #include <string>
 
+/* ID of the face with no attributes. Runes with this face are drawn with
+ * default face of the buffer. */
+#define FACE_ID_DEFAULT 0
+
 namespace Ked {
     namespace Face {
-        void add(std::string const &name, std::string const &face);
+        typedef unsigned int FaceId;
+
+        enum ColorType { COLOR_DEFAULT, COLOR_256, COLOR_RGB };
+
+        struct Color {
+            ColorType type;
+            /* Palette index for COLOR_256, or 0xRRGGBB for COLOR_RGB. */
+            std::uint32_t value;
+        };
+
+        enum Flag {
+            BOLD = 1 << 0,
+            DIM = 1 << 1,
+            ITALIC = 1 << 2,
+            UNDERLINE = 1 << 3,
+            REVERSE = 1 << 4
+        };
+
+        /* Drawing attributes a face consists of. */
+        struct Attributes {
+            Color fg;
+            Color bg;
+            /* Bitwise OR of Flag. */
+            unsigned int flags;
+        };
+
+        Color default_color();
+        Color color_256(unsigned char index);
+        Color color_rgb(std::uint32_t rgb);
+        /* Converts SGR parameter, such as 1 for bold, to Flag. */
+        unsigned int flag_from_sgr(unsigned int code);
+        Attributes attributes(Color fg, Color bg, unsigned int flags);
 
-        std::string &lookup(std::string const &name);
+        /* Defines face, or redefines it if exists, and returns its ID. */
+        FaceId add(std::string const &name, Attributes const &attrs);
+        /* Returns ID of the face. Face not defined yet gets an ID with no
+         * attributes so that it can be defined later. */
+        FaceId id(std::string const &name);
+        Attributes const &get(FaceId id);
+        /* Returns escape sequence that changes attributes of face from to
+         * those of face to. Only differing attributes are emitted. */
+        std::string const &transition(FaceId from, FaceId to);
     } // namespace Face
 } // namespace Ked
 
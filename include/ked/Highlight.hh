@@ -0,0 +1,104 @@
+/*
+ * ked -- simple text editor with minimal dependency
+ * Copyright (C) 2019  Koki Fukuda
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef KED_HIGHLIGHT_HH
+#define KED_HIGHLIGHT_HH
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "Buffer.hh"
+#include "EventBus.hh"
+#include "Face.hh"
+
+/* Lines highlighted below the screen so that scrolling need not wait. */
+#define HIGHLIGHT_LOOKAHEAD 64
+/* Lines lexed at most before each redraw. The rest is done in the next
+ * iterations of the main loop. */
+#define HIGHLIGHT_BUDGET 4096
+
+namespace Ked {
+    namespace Highlight {
+        /* Lexer state at a line boundary, whose meaning is up to grammar. A
+         * buffer starts in state 0. */
+        using State = unsigned int;
+        /* Sets faces of runes in line [start, end) of buf lexed from state,
+         * and returns the state at the end of the line. */
+        using Lexer = std::function<State(Buffer &buf, std::size_t start,
+                                          std::size_t end, State state)>;
+
+        /* Registers grammar with name. */
+        void add_grammar(std::string const &name, Lexer lexer);
+        /* Returns lexer of the grammar, or nullptr if no such grammar. */
+        Lexer const *grammar(std::string const &name);
+
+        /* Highlights a buffer incrementally. State at each line start is
+         * kept, so an edit makes lines lexed again only from the edited one
+         * until the state gets the same as before. */
+        class Highlighter {
+            struct Checkpoint {
+                std::size_t start;
+                State state;
+            };
+
+            Lexer lexer;
+            /* Start of lines and the state there, from the beginning of the
+             * buffer. All but the last one are lexed unless dirty. */
+            std::vector<Checkpoint> lines;
+            /* Whether the last line is lexed too. */
+            bool complete;
+            /* Lines from first_dirty are lexed again until the state
+             * converges past dirty_until. */
+            bool dirty;
+            std::size_t first_dirty;
+            std::size_t dirty_until;
+            /* Starts of lines from shift_from are stored less shift_delta,
+             * so that an edit shifts only the lines between it and the
+             * previous one, like the gap of a buffer. */
+            std::size_t shift_from;
+            std::size_t shift_delta;
+            /* Faces of the line being lexed before lexing it. */
+            std::vector<Face::FaceId> old_faces;
+
+            /* Start of k-th line. */
+            std::size_t line_start(std::size_t k) const;
+            /* Moves shift_from to k. */
+            void move_shift(std::size_t k);
+            /* Index of the line containing pos among known ones. */
+            std::size_t line_index(std::size_t pos) const;
+            /* Lexes k-th line and records the start of the next one. Returns
+             * true if the state converged. */
+            bool lex_line(Buffer &buf, std::size_t k);
+
+        public:
+            Highlighter(Lexer lexer);
+
+            /* Marks lines touched by the change dirty. */
+            void text_changed(TextChangedEvent const &ev);
+            /* Lexes until n_lines lines from the one containing pos are
+             * highlighted, lexing budget lines at most. Returns false if
+             * there is work left. */
+            bool update(Buffer &buf, std::size_t pos, std::size_t n_lines,
+                        std::size_t budget);
+        };
+    } // namespace Highlight
+} // namespace Ked
+
+#endif
@@ -0,0 +1,81 @@
+/*
+ * ked -- simple text editor with minimal dependency
+ * Copyright (C) 2019  Koki Fukuda
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef KED_INPUT_HH
+#define KED_INPUT_HH
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "Rune.hh"
+
+/* Size of chunk read from the terminal at once. */
+#define INPUT_BUFFER_SIZE 65536
+/* Milliseconds to wait for the rest of escape sequence before taking ESC
+ * as a key by itself. */
+#define ESCAPE_TIMEOUT 50
+
+namespace Ked {
+    /* Decoded unit of the terminal input. */
+    struct InputEvent {
+        enum Type { KEY, RUNE, PASTE };
+
+        Type type;
+        /* Byte of the key if type is KEY. */
+        unsigned char key;
+        /* UTF-8 character if type is RUNE. */
+        Rune rune;
+        /* Pasted UTF-8 text if type is PASTE. */
+        std::string text;
+    };
+
+    /* Splits raw terminal input into key, rune and paste events. A UTF-8
+     * sequence or bracketed paste marker may be split across chunks, so the
+     * parser keeps incomplete sequence until the rest arrives. */
+    class InputParser {
+        /* Incomplete UTF-8 sequence. */
+        Rune utf8_buf;
+        unsigned int utf8_len;
+        unsigned int utf8_need;
+
+        /* Length of paste start or end marker matched so far. */
+        std::size_t marker_len;
+        bool in_paste;
+        std::string paste_text;
+
+        void push_key(unsigned char c, std::vector<InputEvent> &out);
+        void feed_paste(unsigned char c, std::vector<InputEvent> &out);
+        void feed_char(unsigned char c, std::vector<InputEvent> &out);
+
+    public:
+        InputParser();
+
+        /* Parses len bytes of buf and appends decoded events to out. */
+        void feed(char const *buf, std::size_t len,
+                  std::vector<InputEvent> &out);
+        /* Returns true if the parser holds a prefix of paste start marker
+         * that may turn out to be plain keys. */
+        bool pending() const;
+        /* Gives up waiting for the rest of held marker and emits it as
+         * keys. */
+        void flush(std::vector<InputEvent> &out);
+    };
+} // namespace Ked
+
+#endif
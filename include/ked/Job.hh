@@ -0,0 +1,149 @@
+/*
+ * ked -- simple text editor with minimal dependency
+ * Copyright (C) 2019  Koki Fukuda
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef KED_JOB_HH
+#define KED_JOB_HH
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Buffer.hh"
+#include "EventLoop.hh"
+#include "Rune.hh"
+
+/* Upper limit of worker threads in the pool. */
+#define MAX_JOB_WORKERS 8
+/* Runes copied into a snapshot at most while the buffer is locked. */
+#define SNAPSHOT_CHUNK_SIZE 65536
+
+namespace Ked {
+    /* Read-only copy of a buffer as it was when a job is submitted. */
+    struct BufferSnapshot {
+        /* Runes of the buffer, without the gap. Faces are left default
+         * since highlighters paint them meanwhile. */
+        std::vector<AttrRune> content;
+        std::string path;
+        /* Buffer::version the snapshot was taken at. */
+        unsigned long version;
+
+        /* Encodes content into UTF-8. */
+        std::string text() const;
+    };
+
+    class Job;
+
+    /* Runs on a worker thread and returns what to do with the result on the
+     * loop thread, or empty function if nothing. */
+    using JobWork = std::function<std::function<void()>(
+        BufferSnapshot const &snapshot, Job const &job)>;
+
+    class Job {
+        friend class JobPool;
+
+        /* nullptr if the job is not about a buffer. */
+        Buffer *buf;
+        unsigned long version;
+        std::atomic<bool> cancel_requested;
+        JobWork work;
+
+    public:
+        Job(Buffer *buf, unsigned long version, JobWork work);
+
+        /* Long running work should check this from time to time and give up
+         * if true. */
+        bool cancelled() const;
+        /* Drops the result of the job. */
+        void cancel();
+    };
+
+    /* Threads shared by extensions to do expensive work off the loop
+     * thread. Workers are started on first submit. */
+    class JobPool {
+        /* Snapshot shared by jobs submitted while a buffer is not changed.
+         * Its text is copied by the first worker running one of them, so
+         * the loop thread never copies the buffer. */
+        struct PendingSnapshot {
+            /* nullptr if the jobs are not about a buffer. */
+            Buffer *buf;
+            std::mutex mutex;
+            bool copied;
+            BufferSnapshot snapshot;
+        };
+
+        struct Task {
+            std::shared_ptr<Job> job;
+            std::shared_ptr<PendingSnapshot> snapshot;
+        };
+
+        EventLoop &loop;
+        std::vector<std::thread> workers;
+        std::mutex queue_mutex;
+        std::condition_variable queue_cond;
+        std::deque<Task> queue;
+        bool stopping;
+        /* Held by a worker from checking its job is not cancelled until it
+         * locks the buffer, so that cancel() can wait until no worker is
+         * about to touch the buffer. */
+        std::mutex copy_mutex;
+
+        /* Following members are touched only on the loop thread. */
+        /* Jobs whose result is not delivered yet. */
+        std::vector<std::shared_ptr<Job>> active;
+        /* Snapshot of each buffer with active jobs, shared by jobs submitted
+         * while the buffer is not changed. */
+        std::map<Buffer *, std::shared_ptr<PendingSnapshot>> snapshots;
+
+        void start_workers();
+        void run_worker();
+        /* Copies the buffer into pending unless it is already done, in
+         * chunks. Returns false if job is cancelled or the buffer is
+         * changed before that. Runs on a worker. */
+        bool take_snapshot(PendingSnapshot &pending, Job const &job);
+        void finish(std::shared_ptr<Job> job, std::function<void()> done);
+        void enqueue(std::shared_ptr<Job> job,
+                     std::shared_ptr<PendingSnapshot> snapshot);
+
+    public:
+        JobPool(EventLoop &loop);
+        ~JobPool();
+
+        /* Runs work with snapshot of buf on a worker thread, and calls the
+         * function it returns on the loop thread before next redraw. The
+         * result is dropped if the job is cancelled or buf is changed
+         * meanwhile. Must be called on the loop thread. */
+        std::shared_ptr<Job> submit(Buffer &buf, JobWork work);
+        /* Runs work not about any buffer, which gets an empty snapshot. The
+         * result is dropped only if the job is cancelled. Must be called on
+         * the loop thread. */
+        std::shared_ptr<Job> submit(JobWork work);
+        /* Cancels every job of buf, waiting for a worker starting to copy
+         * it. Jobs must be cancelled before buf is deleted. */
+        void cancel(Buffer *buf);
+    };
+} // namespace Ked
+
+#endif
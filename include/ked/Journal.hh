@@ -0,0 +1,92 @@
+/*
+ * ked -- simple text editor with minimal dependency
+ * Copyright (C) 2019  Koki Fukuda
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef KED_JOURNAL_HH
+#define KED_JOURNAL_HH
+
+#include <cstddef>
+#include <ctime>
+#include <string>
+#include <vector>
+
+/* Bytes of records kept unwritten at most. */
+#define JOURNAL_FLUSH_SIZE 65536
+/* Milliseconds records are kept unwritten at most. */
+#define JOURNAL_FLUSH_INTERVAL 1000
+
+namespace Ked {
+    class Buffer;
+
+    /* Edit replacing removed runes at pos with text in UTF-8. */
+    struct JournalRecord {
+        std::size_t pos;
+        std::size_t removed;
+        std::string text;
+    };
+
+    /* Append-only log of edits of a buffer since its file is read or
+     * saved, from which edits not saved are brought back after crash.
+     * Records are batched in memory until flush writes and syncs them,
+     * so its cost follows the amount of edits rather than the file
+     * size. The journal is locked while open, so that another session
+     * editing the same file neither replays nor truncates it. */
+    class Journal {
+        int fd;
+        std::string path;
+        /* Records not written yet. */
+        std::string pending;
+
+        Journal(int fd, std::string const &path);
+
+    public:
+        /* Writes records left. */
+        ~Journal();
+
+        /* Opens journal at path, creating it if missing, and locks it.
+         * Returns nullptr if it cannot be opened, or with errno set to
+         * EWOULDBLOCK if another session has it locked. */
+        static Journal *open(std::string const &path);
+        /* Returns edits of the journal if it is for the file of mtime and
+         * file_size, or nothing otherwise. Records after a broken one, such
+         * as the one being written on crash, are dropped. If end is given,
+         * it is set to the size of the journal up to the last record
+         * returned. */
+        std::vector<JournalRecord> read(struct timespec const &mtime,
+                                        std::size_t file_size,
+                                        std::size_t *end = nullptr) const;
+
+        /* Records that removed runes at pos are replaced with inserted ones
+         * of buf. Records are flushed once they grow to
+         * JOURNAL_FLUSH_SIZE. */
+        void record(Buffer const &buf, std::size_t pos, std::size_t removed,
+                    std::size_t inserted);
+        /* Returns true if some records are not written yet. */
+        bool dirty() const;
+        /* Writes records and waits until they are on the disk. */
+        bool flush();
+        /* Drops records to start over for buf just saved. */
+        bool reset(Buffer const &buf);
+        /* Drops whatever follows end returned by read, so that records
+         * are appended after the ones read. */
+        bool truncate(std::size_t end);
+        /* Deletes the journal, which is no longer needed. */
+        void remove();
+    };
+} // namespace Ked
+
+#endif
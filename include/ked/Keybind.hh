@@ -0,0 +1,95 @@
+/*
+ * ked -- simple text editor with minimal dependency
+ * Copyright (C) 2019  Koki Fukuda
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef KED_KEYBIND_HH
+#define KED_KEYBIND_HH
+
+#include <array>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "Profile.hh"
+
+namespace Ked {
+    class Buffer;
+    class Ui;
+
+    namespace KeyHandling {
+        using EditorCommand =
+            std::function<void(Ked::Ui &ui, Ked::Buffer &buf)>;
+
+        enum KeyBindState {
+            KEYBIND_NOT_HANDLED,
+            KEYBIND_HANDLED,
+            KEYBIND_WAIT
+        };
+
+        /* Key bindings compiled into a state machine. Each state has a
+         * transition table indexed by the next byte, so a key is handled
+         * with one table lookup and no allocation. */
+        class Keybind {
+            struct State {
+                /* Next state for each byte, or 0 if no binding continues
+                 * with the byte. */
+                std::array<unsigned int, 256> next;
+                /* Command bound to the sequence reaching this state. */
+                EditorCommand func;
+                /* Where time spent in func is counted. */
+                Profile::Site *site;
+            };
+
+            /* State 0 is the initial one. */
+            std::vector<State> states;
+
+            std::string compile_key(std::string const &key);
+            void merge_state(unsigned int state, Keybind const &other,
+                             unsigned int other_state);
+
+        public:
+            Keybind();
+
+            void add(std::string const &key, EditorCommand func);
+            /* Adds every binding of other, replacing the ones bound to the
+             * same sequence or to a prefix of its sequences. */
+            void merge(Keybind const &other);
+            /* Removes all bindings. */
+            void clear();
+            /* Returns true if nothing is bound. */
+            bool empty() const;
+            /* Returns the state after byte c from state, or 0 if no binding
+             * continues with c. */
+            unsigned int advance(unsigned int state, unsigned char c) const;
+            /* Returns command bound to the state, or nullptr if none. */
+            EditorCommand const *command(unsigned int state) const;
+            /* Advances state with c and runs the command if a binding is
+             * completed. state is reset unless more keys are waited. */
+            KeyBindState handle(unsigned int &state, unsigned char c, Ui &ui,
+                                Buffer &buf);
+        };
+
+        /* Returns a number that changes whenever any keymap or a mode of any
+         * buffer changes, so that resolved keymaps can be reused until
+         * then. */
+        unsigned long keymap_version();
+        /* Tells resolved keymaps are outdated. */
+        void keymap_changed();
+    } // namespace KeyHandling
+} // namespace Ked
+
+#endif
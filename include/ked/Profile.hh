@@ -0,0 +1,111 @@
+/*
+ * ked -- simple text editor with minimal dependency
+ * Copyright (C) 2019  Koki Fukuda
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef KED_PROFILE_HH
+#define KED_PROFILE_HH
+
+#include <array>
+#include <cstdint>
+#include <string>
+
+#include <time.h>
+
+/* Latest durations kept per site to compute percentiles. */
+#define PROFILE_SAMPLES 1024
+
+namespace Ked {
+    /* Time spent in commands, listeners and hooks of each extension. */
+    namespace Profile {
+        /* Aggregated durations of a piece of code. */
+        struct Site {
+            /* Extension the code belongs to. */
+            std::string owner;
+            std::string name;
+            unsigned long count;
+            std::uint64_t total_ns;
+            std::uint64_t max_ns;
+            /* Ring buffer of latest durations. */
+            std::array<std::uint32_t, PROFILE_SAMPLES> samples;
+            std::size_t next_sample;
+        };
+
+        /* Whether commands, listeners and hooks are timed. It is off unless
+         * enabled, leaving one branch per call that would be measured. */
+        bool enabled();
+        void set_enabled(bool enable);
+
+        /* Returns site of name owned by the current owner. The pointer is
+         * valid forever. */
+        Site *site(std::string const &name);
+        /* Returns extension whose code is being set up. */
+        std::string const &current_owner();
+
+        /* Makes sites taken while alive belong to the extension. */
+        class Owner {
+            std::string prev;
+
+        public:
+            Owner(std::string const &name);
+            ~Owner();
+        };
+
+        /* Adds time until destructed to the site. Nothing is measured if
+         * site is nullptr or profiling is disabled. */
+        class Scope {
+            Site *site;
+            struct timespec start;
+
+        public:
+            Scope(Site *site);
+            ~Scope();
+        };
+
+        /* Formats sites as a table, slowest in total first. */
+        std::string report();
+
+        /* Starts recording startup phases, measuring time from now. */
+        void start_startup_trace();
+        /* Returns true while startup phases are recorded. */
+        bool tracing_startup();
+        /* Tells the first screen is drawn, which ends the startup trace. */
+        void startup_painted();
+
+        /* Records time until destructed as a startup phase, nested in the
+         * phase alive on the same thread, or in parent if given. The
+         * subject, such as extension name, is appended to name. This may
+         * be used on any thread. */
+        class Phase {
+            /* Index of the record, or -1 if not tracing. */
+            long record;
+            unsigned int depth;
+            /* Whether this is counted as the phase alive on the thread. */
+            bool innermost;
+
+        public:
+            Phase(char const *name, std::string const &subject = "",
+                  Phase const *parent = nullptr);
+            ~Phase();
+        };
+
+        /* Formats recorded phases in the order they started, headed by
+         * time to first paint. */
+        std::string startup_report();
+    } // namespace Profile
+} // namespace Ked
+
+#endif
@@ -23,6 +23,7 @@
 #include <vector>
 #include <string>
 
+#include "Face.hh"
 #include "Terminal.hh"
 
 namespace Ked {
@@ -44,8 +45,8 @@ namespace Ked {
          * |-----+------------|
          * | ... | 1 bit      | */
         unsigned int attrs;
-        /* Face name this Rune should use. */
-        std::string face_name;
+        /* Face this Rune should use. */
+        Face::FaceId face;
 
         bool is_protected() const;
         bool is_lf() const;
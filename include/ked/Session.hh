@@ -0,0 +1,55 @@
+/*
+ * ked -- simple text editor with minimal dependency
+ * Copyright (C) 2019  Koki Fukuda
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef KED_SESSION_HH
+#define KED_SESSION_HH
+
+#include <string>
+
+/* Files smaller than this are read again rather than imaged, as decoding
+ * them takes little time. */
+#define MIN_IMAGE_FILE_SIZE (1 << 20)
+
+namespace Ked {
+    class Ui;
+
+    /* Files being edited, saved to be opened again as they were. */
+    namespace Session {
+        /* Returns $XDG_CACHE_HOME/ked or ~/.cache/ked, where session,
+         * images and journals are saved, creating it if missing. Returns
+         * empty string if it cannot be made. */
+        std::string const &directory();
+        /* Returns path of the journal of the file, or empty string if
+         * directory cannot be made. */
+        std::string journal_path(std::string const &file);
+
+        /* Saves path, cursor and viewport of each file buffer of ui, and
+         * which one is current. If write_images is true, unmodified buffers
+         * of large files are also written as images, which are mapped by
+         * restore instead of decoding the files again, and images of other
+         * files are deleted. Returns false if the session cannot be
+         * written. */
+        bool save(Ui &ui, bool write_images);
+        /* Adds buffers of the saved session to ui as they were, and shows
+         * the one current then. Images are used if the files are not
+         * changed since. Returns false if no buffer is restored. */
+        bool restore(Ui &ui);
+    } // namespace Session
+} // namespace Ked
+
+#endif
@@ -29,6 +29,12 @@ namespace Ked {
         std::size_t io_buffer_off;
 
         struct termios *orig_termios;
+        int orig_fd_flags;
+        /* Terminal is read from in_fd and written to out_fd. */
+        int in_fd;
+        int out_fd;
+        /* Whether input reached its end, as the terminal is hung up. */
+        bool closed;
 
       public:
         std::size_t width;
@@ -37,16 +43,37 @@ namespace Ked {
         /* Initializes terminal to use alternate screen and noncanonical mode.
          */
         Terminal();
+        /* Same as above, but for the terminal on given descriptors, which
+         * are not closed by Terminal. */
+        Terminal(int in_fd, int out_fd);
         /* Restores original terminal settings. */
         ~Terminal();
 
+        /* Switches the terminal to the state for the editor. Called again
+         * after the process resumed from stop. */
+        void setup();
+        /* Restores the terminal to the state before setup(). */
+        void restore();
+        /* Reads the window size again. Returns true if it has changed. */
+        bool update_size();
+        /* Returns the descriptor input comes from. */
+        int input_fd() const;
+        /* Returns true once read_input meets the end of input or an error,
+         * after which nothing arrives any more. */
+        bool input_closed() const;
+
         /* Write 1 byte to the terminal. */
         void put_char(char c);
         void put_str(char const *str);
         void put_str(std::string const &str);
         void put_buf(char const *buf, std::size_t len);
-        /* Reads 1 byte from stdin and return the value. */
+        /* Reads 1 byte from the terminal and return the value. */
         char get_char();
+        /* Reads bytes already available on the terminal, up to len bytes.
+         * Waits at most timeout_ms milliseconds for the first byte to arrive
+         * (-1 to wait forever). Returns the number of bytes read, or 0 on
+         * timeout or if input is closed. */
+        std::size_t read_input(char *buf, std::size_t len, int timeout_ms);
 
         void move_cursor(unsigned int, unsigned int);
 
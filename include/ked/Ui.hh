@@ -19,106 +19,304 @@
 #ifndef KED_UI_HH
 #define KED_UI_HH
 
-#include <list>
+#include <array>
+#include <cstdint>
+#include <functional>
 #include <map>
+#include <memory>
 #include <mutex>
 #include <string>
 #include <vector>
 
 #include "Buffer.hh"
+#include "EventBus.hh"
+#include "EventLoop.hh"
 #include "Face.hh"
+#include "Highlight.hh"
+#include "Input.hh"
+#include "Job.hh"
+#include "Keybind.hh"
 #include "Terminal.hh"
+#include "Window.hh"
 
 namespace Ked {
-    class Ui;
-
-    namespace KeyHandling {
-        using EditorCommand =
-            std::function<void(Ked::Ui &ui, Ked::Buffer &buf)>;
-
-        enum KeyBindState {
-            KEYBIND_NOT_HANDLED,
-            KEYBIND_HANDLED,
-            KEYBIND_WAIT
+    class Ui {
+        /* What is drawn on a cell of the terminal. */
+        struct Cell {
+            Rune c;
+            /* Rest of grapheme cluster drawn in this cell. */
+            std::string tail;
+            Face::FaceId face;
         };
 
-        class Keybind {
-            struct BindingElement {
-                std::string key;
-                EditorCommand func;
-            };
-
-            std::list<BindingElement *> binding;
+        /* Node of the window layout. A leaf shows a window, and the others
+         * split their area between two children. */
+        struct LayoutNode {
+            Window *window;
+            /* Whether children are side by side rather than one above the
+             * other. */
+            bool side_by_side;
+            LayoutNode *parent;
+            std::unique_ptr<LayoutNode> first;
+            std::unique_ptr<LayoutNode> second;
+            /* Area assigned by the last layout, including the divider on
+             * the right and the bottom. Ends are exclusive. */
+            unsigned int x_start;
+            unsigned int x_end;
+            unsigned int y_start;
+            unsigned int y_end;
 
-            char *compile_key(std::string const &seq);
-            int compare_key(std::string const &key,
-                            std::vector<char> const &seq);
-            int compare_key(std::string const &key,
-                            std::vector<char> const &seq, std::size_t n);
-
-        public:
-            ~Keybind();
-
-            void add(std::string const &key, EditorCommand func);
-            KeyBindState handle(std::vector<char> const &seq, Ui &ui,
-                                Buffer &buf);
+            ~LayoutNode();
         };
-    } // namespace KeyHandling
 
-    class Ui {
         bool editor_exited;
+        /* True from suspend until resume, while the terminal belongs to
+         * the shell and is neither read nor drawn. */
+        bool suspended;
+        /* System buffers drawn outside of windows. */
         std::vector<Buffer *> displayed_buffers;
+        std::unique_ptr<LayoutNode> layout_root;
+        /* Windows in the order of the layout. */
+        std::vector<Window *> windows;
+        Face::FaceId divider_face;
         std::vector<Buffer *> buffers;
-        std::vector<AttrRune> display_buffer;
+        std::vector<Cell> display_buffer;
         unsigned int maybe_next_x;
         unsigned int maybe_next_y;
 
-        std::string current_face_name;
+        /* Face the terminal is drawing with. */
+        Face::FaceId current_face;
         std::mutex display_buffer_mutex;
 
-        std::vector<std::function<void(std::vector<Buffer *> &)>>
-            on_buffer_entry_changed_listener;
+        InputParser input_parser;
+        std::vector<char> input_buffer;
+        std::vector<InputEvent> input_events;
+        int escape_timer;
+
+        /* Keymaps of buffer, mode and global ones merged for
+         * resolved_buffer, valid while keymap version is resolved_version. */
+        KeyHandling::Keybind resolved_keybind;
+        /* Keymap looked up for resolved_buffer; points global_keybind if
+         * neither the buffer nor its mode has bindings. */
+        KeyHandling::Keybind *resolved;
+        Buffer *resolved_buffer;
+        unsigned long resolved_version;
+
+        /* Reads terminal input and applies it, given events of the input
+         * descriptor. Exits the editor once the terminal is hung up. */
+        void handle_input(std::uint32_t events);
+        /* Reads input of term in the event loop. */
+        void watch_input();
+        /* Highlighters of buffers with grammar. */
+        std::map<Buffer *, Highlight::Highlighter> highlighters;
+        /* Timer to continue highlighting left for the next iteration, or
+         * -1. */
+        int highlight_timer;
+
+        /* Timer to flush journals after edits, or -1. */
+        int journal_timer;
+        /* Starts journal of buf, applying edits left in the journal by a
+         * session which did not exit. */
+        void start_journal(Buffer *buf);
+        /* Writes and syncs records of all journals. */
+        void flush_journals();
+        /* Flushes journals in a while if they have records, so that edits
+         * in a row are synced at once. */
+        void schedule_journal_flush();
+
+        /* Keyboard macro recorded last. */
+        std::vector<InputEvent> macro;
+        /* Events of the key sequence being typed while recording, which are
+         * kept out of macro unless the sequence completes as a command other
+         * than stop_macro. */
+        std::vector<InputEvent> macro_pending;
+        bool recording_macro;
+        bool replaying_macro;
+        /* Set by command_failed to stop the replay. */
+        bool macro_failed;
+
+        /* Applies decoded input events to the current buffer. */
+        void dispatch_input();
+        /* Applies an input event to the current buffer. */
+        void dispatch_event(InputEvent &ev);
+        /* Highlights visible part of displayed buffers within budget. */
+        void highlight();
+        /* Delivers buffer events, highlights and redraws. */
+        void update_screen();
+        /* Draws r followed by tail, which occupies width columns. */
+        void draw_cell(AttrRune const &r, std::string const &tail,
+                       Face::FaceId default_face, unsigned int width,
+                       unsigned int x, unsigned int y);
+        /* Switches drawing attributes of the terminal to face. */
+        void use_face(Face::FaceId face);
+        /* Draws grapheme cluster of buf in [start, end). */
+        void draw_cluster(Buffer &buf, std::size_t start, std::size_t end,
+                          unsigned int width, unsigned int x, unsigned int y);
+        /* Draws the line clipped to the display range, and returns the
+         * column next to the last drawn one. */
+        unsigned int draw_truncated_line(Buffer &buf, std::size_t start,
+                                         Buffer::LineLayout &layout,
+                                         unsigned int y);
+        /* Draws visible part of buf, clearing the rest of each row up to
+         * column right. */
+        void draw_buffer(Buffer &buf, unsigned int right);
+        /* Draws dividers on the right and the bottom of the window. */
+        void draw_dividers(LayoutNode const &node);
+        /* Assigns the area to the node and its descendants. */
+        void layout_node(LayoutNode &node, unsigned int x_start,
+                         unsigned int x_end, unsigned int y_start,
+                         unsigned int y_end);
+        /* Collects windows under node to windows in the layout order. */
+        void collect_windows(LayoutNode &node);
+        /* Returns the leaf showing win under node, or nullptr if none. */
+        LayoutNode *find_node(LayoutNode &node, Window *win);
+        /* Shows buf in current_window, making the first window if none. */
+        void show_in_window(Buffer *buf);
+        /* Makes win current_window and its buffer current_buffer. */
+        void select_window(Window *win);
 
     public:
         Terminal *term;
         Ked::KeyHandling::Keybind global_keybind;
+        /* Keymaps of modes keyed by mode name. */
+        std::map<std::string, KeyHandling::Keybind> mode_keybinds;
+        /* Commands extensions made available by name, which user
+         * preference binds keys to. */
+        std::map<std::string, KeyHandling::EditorCommand> commands;
+        /* Extension which added each command, for profiling. */
+        std::map<std::string, std::string> command_owners;
         Buffer *current_buffer;
+        /* Window current_buffer is edited through, or nullptr before any
+         * buffer is shown. */
+        Window *current_window;
+        /* Loop the editor runs on. Extensions may watch their file
+         * descriptors, timers and signals with it. */
+        EventLoop event_loop;
+        /* Events of buffers, delivered once before each redraw. */
+        EventBus events;
+        /* Workers for expensive work of extensions. Jobs of a buffer are
+         * cancelled when its text changes. */
+        JobPool jobs;
+        /* Stops the process on the terminal after suspend restored it. It
+         * stops this process by default. */
+        std::function<void()> stop_process;
 
         Ui(Terminal *term);
         ~Ui();
 
         /* Draws char to the terminal if needed. */
-        void draw_char(unsigned char c, std::string const &face, unsigned int x,
+        void draw_char(unsigned char c, Face::FaceId face, unsigned int x,
                        unsigned int y);
         /* Draws AttrRune with its attrubutes to the termianl if needed. */
-        void draw_rune(AttrRune const &r, std::string const &default_face,
+        void draw_rune(AttrRune const &r, Face::FaceId default_face,
                        unsigned int x, unsigned int y);
         /* Make next drawing to take place in the position. */
         void invalidate_point(unsigned int x, unsigned int y);
+        /* Forgets what is on the screen so that next redraw rewrites
+         * everything. */
+        void invalidate();
         /* Display message on the message area. */
         void write_message(std::string const &msg);
+        /* Tells the running command failed, showing msg. Replaying keyboard
+         * macro stops at this. */
+        void command_failed(std::string const &msg);
         /* Initializes buffers that are needed for system to work. */
         void init_system_buffers();
-        /* Reads displayed_buffers and rewrites areas that are changed. */
+        /* Reads displayed_buffers and windows, and rewrites areas that are
+         * changed. Windows looking the same as last time are skipped. */
         void redraw_editor();
+        /* Assigns display range of displayed buffers and windows according
+         * to the terminal size. */
+        void layout();
+        /* Follows the new terminal size. */
+        void handle_resize();
+        /* Draws on term from now on, rewriting everything at next redraw.
+         * The previous terminal is no longer used. */
+        void set_terminal(Terminal *term);
         /* Reserve editor exit on next exit point. */
         void exit_editor();
+        /* Restores the terminal and stops the process with stop_process. The
+         * terminal is neither read nor drawn until resume, which is called
+         * on SIGCONT and sets up the editor again. */
+        void suspend();
+        void resume();
 
         /* Assigns given function to given key sequence. */
         void add_global_keybind(std::string const &key,
                                 KeyHandling::EditorCommand func);
+        /* Assigns given function to given key sequence in buffers in the
+         * mode. */
+        void add_mode_keybind(std::string const &mode, std::string const &key,
+                              KeyHandling::EditorCommand func);
+        /* Makes func available as command of the name. */
+        void add_command(std::string const &name,
+                         KeyHandling::EditorCommand func);
+        /* Returns extension which added command of the name, which time
+         * spent in keys bound to it is counted for. */
+        std::string command_owner(std::string const &name) const;
+        /* Returns command of the name, or nullptr if none. */
+        KeyHandling::EditorCommand const *
+        find_command(std::string const &name) const;
+        /* Returns keymap for current_buffer, where bindings of the buffer
+         * are preferred over the ones of its mode, and them over global
+         * ones. It is cached until any keymap changes. */
+        KeyHandling::Keybind &current_keybind();
+
+        /* Highlights buf with the grammar, or stops highlighting if name is
+         * empty. Returns false if no such grammar. */
+        bool set_grammar(Buffer &buf, std::string const &name);
 
-        /* Adds listener to be called just after buffer changed. */
-        void add_buffer_entry_change_listener(
-            std::function<void(std::vector<Buffer *> &)>);
+        /* Starts recording decoded keys, runes and pastes as keyboard
+         * macro. */
+        void start_macro();
+        /* Finishes recording keyboard macro, leaving out the keys invoked
+         * this. */
+        void stop_macro();
+        /* Replays keyboard macro times times, or until it fails or stops
+         * moving the point if times is 0. Buffers are followed and redrawn
+         * just once after all. Returns false if the replay failed. */
+        bool replay_macro(std::size_t times);
 
+        /* Runs until exit_editor is called. It may run again afterwards,
+         * for example on another terminal. */
         void main_loop();
-        /* Sets buffer to drawing target. */
+        /* Sets buffer to drawing target. Buffers other than system ones are
+         * shown in current_window. */
         void buffer_show(std::string const &name);
-        /* Select the buffer as current_buffer. */
+        /* Select the buffer as current_buffer, along with the window showing
+         * it if any. */
         void buffer_switch(std::string const &name);
-        /* Add buffer to internal buffer list. */
+        /* Add buffer to internal buffer list. Edits of a file buffer are
+         * recorded to its journal from now on. */
         void buffer_add(Buffer *buf);
+        /* Returns buffer of the name, or nullptr if none. */
+        Buffer *buffer_find(std::string const &name);
+        /* Deletes buf, dropping its highlighting and jobs. Returns false
+         * and keeps it if it is current_buffer or shown on the screen. */
+        bool buffer_remove(Buffer *buf);
+        /* Returns all buffers in the order they are added. */
+        std::vector<Buffer *> const &buffer_list() const;
+        /* Shows the buffer in place of current_buffer and selects it. */
+        void buffer_select(std::string const &name);
+        /* Reads files on job workers and adds their buffers, named by the
+         * paths, in the given order as they become ready. */
+        void buffer_load(std::vector<std::string> const &paths);
+        /* Selects buffer count after current_buffer among the ones other
+         * than system buffers, wrapping around. Negative count goes
+         * backward. */
+        void buffer_cycle(int count);
+
+        /* Splits current_window into two showing its buffer, one above the
+         * other or side by side. Returns false if it is too small. */
+        bool split_window(bool side_by_side);
+        /* Closes current_window, giving its area to the neighbor. Returns
+         * false if it is the only window. */
+        bool delete_window();
+        /* Closes all windows but current_window. */
+        void delete_other_windows();
+        /* Selects window count after current_window in the layout order,
+         * wrapping around. Negative count goes backward. */
+        void other_window(int count);
     };
 
 } // namespace Ked
@@ -0,0 +1,80 @@
+/*
+ * ked -- simple text editor with minimal dependency
+ * Copyright (C) 2019  Koki Fukuda
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef KED_UNICODE_HH
+#define KED_UNICODE_HH
+
+#include "Rune.hh"
+
+namespace Ked {
+    namespace Unicode {
+        /* Grapheme_Cluster_Break property defined in UAX #29, plus
+         * Extended_Pictographic needed by its rule GB11. */
+        enum GraphemeBreak {
+            GB_OTHER,
+            GB_CR,
+            GB_LF,
+            GB_CONTROL,
+            GB_EXTEND,
+            GB_ZWJ,
+            GB_REGIONAL_INDICATOR,
+            GB_PREPEND,
+            GB_SPACING_MARK,
+            GB_L,
+            GB_V,
+            GB_T,
+            GB_LV,
+            GB_LVT,
+            GB_EXTENDED_PICTOGRAPHIC
+        };
+
+        /* What a grapheme cluster seen so far looks like, to decide whether
+         * the next code point continues it. */
+        struct GraphemeState {
+            GraphemeBreak prev;
+            /* Cluster is Extended_Pictographic Extend*, optionally followed
+             * by ZWJ if prev is GB_ZWJ. */
+            bool pictographic;
+            /* Number of regional indicators in a row is odd. */
+            bool odd_regional_indicator;
+        };
+
+        /* Code point used for broken UTF-8 sequence. */
+        constexpr char32_t replacement_character = 0xfffd;
+
+        /* Returns code point of the rune, or replacement_character if the
+         * rune is not a valid UTF-8 sequence. */
+        char32_t decode(Rune const &r);
+
+        /* Returns number of columns the code point occupies when ked draws
+         * it. Control characters are drawn like ^X, and tab is 8 columns
+         * wide. */
+        unsigned char width(char32_t c);
+
+        /* Returns Grapheme_Cluster_Break property of the code point. */
+        GraphemeBreak grapheme_break(char32_t c);
+
+        /* Starts a new grapheme cluster with property first. */
+        void grapheme_begin(GraphemeState &state, GraphemeBreak first);
+        /* Returns true if there is a cluster boundary before the code point
+         * with property next. Either way the state moves to next. */
+        bool grapheme_break_before(GraphemeState &state, GraphemeBreak next);
+    } // namespace Unicode
+} // namespace Ked
+
+#endif
@@ -0,0 +1,79 @@
+/*
+ * ked -- simple text editor with minimal dependency
+ * Copyright (C) 2019  Koki Fukuda
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef KED_WINDOW_HH
+#define KED_WINDOW_HH
+
+#include <cstddef>
+
+#include "Buffer.hh"
+#include "Face.hh"
+
+/* Smallest area, including dividers, that a window can be split from. */
+#define MIN_SPLIT_WIDTH 6
+#define MIN_SPLIT_HEIGHT 4
+
+namespace Ked {
+    /* Area of the screen showing a buffer. Windows showing the same buffer
+     * share its text, and each keeps its own cursor and scroll position. */
+    class Window {
+        /* What the window showed when it was drawn last. */
+        struct Drawn {
+            Buffer *buf;
+            unsigned long version;
+            unsigned long paint_version;
+            Face::FaceId default_face;
+            std::size_t visible_start_point;
+            std::size_t scroll_x;
+            bool truncate_lines;
+            std::size_t display_range_x_start;
+            std::size_t display_range_x_end;
+            std::size_t display_range_y_start;
+            std::size_t display_range_y_end;
+        };
+
+        Buffer *buf;
+        Buffer::View view;
+        Drawn drawn;
+        /* Whether drawn is meaningful. */
+        bool drawn_valid;
+
+    public:
+        Window(Buffer *buf);
+        ~Window();
+
+        Buffer *buffer() const;
+        /* Shows buf in this window instead. */
+        void set_buffer(Buffer *buf);
+        /* Makes the viewport members of the buffer those of this window.
+         * Must be called before the buffer is used through this window. */
+        void activate();
+        /* Moves this window to given range of the display. */
+        void set_display_range(std::size_t x_start, std::size_t x_end,
+                               std::size_t y_start, std::size_t y_end);
+        /* Returns whether the window may look different from when it was
+         * drawn last. The window must be active. */
+        bool needs_redraw() const;
+        /* Records that the window is drawn as it is now. */
+        void mark_drawn();
+        /* Makes the next redraw draw this window. */
+        void mark_dirty();
+    };
+} // namespace Ked
+
+#endif
@@ -20,6 +20,7 @@
 #define KED_HH
 
 #include "Buffer.hh"
+#include "Face.hh"
 #include "Ui.hh"
 
 #define EDITOR_COMMAND_ARG_LIST \
@@ -27,10 +28,41 @@
 
 #define DEFINE_EDITOR_COMMAND(name) void ec_##name(EDITOR_COMMAND_ARG_LIST)
 #define EDITOR_COMMAND_PTR(name) &ec_##name
+/* Makes the command defined with DEFINE_EDITOR_COMMAND available by its
+ * name. */
+#define ADD_EDITOR_COMMAND(ui, name)                                          \
+    (ui).add_command(#name, EDITOR_COMMAND_PTR(name))
 
-#define FACE_COLOR_256(fg, bg) "\e[0m\e[38;5;" #fg "m\e[48;5;" #bg "m"
-#define FACE_ATTR_COLOR_256(attr, fg, bg) \
-    "\e[" #attr "m\e[38;5;" #fg "m\e[48;5;" #bg "m"
-#define FACE_NONE "\e[0m"
+/* Names extension hook. Extensions linked into static ked share one symbol
+ * namespace, so they are compiled with KED_BUILTIN_NAME and their hooks get
+ * the name as prefix, such as system_extension_on_load. */
+#ifdef KED_BUILTIN_NAME
+#define EXTENSION_HOOK_CONCAT(ext, hook) ext##_##hook
+#define EXTENSION_HOOK_EXPAND(ext, hook) EXTENSION_HOOK_CONCAT(ext, hook)
+#define EXTENSION_HOOK(hook) EXTENSION_HOOK_EXPAND(KED_BUILTIN_NAME, hook)
+#else
+#define EXTENSION_HOOK(hook) hook
+#endif
+
+#define FACE_COLOR_256(fg, bg)                                                \
+    Ked::Face::attributes(Ked::Face::color_256(fg), Ked::Face::color_256(bg), \
+                          0)
+#define FACE_ATTR_COLOR_256(attr, fg, bg)                                     \
+    Ked::Face::attributes(Ked::Face::color_256(fg), Ked::Face::color_256(bg), \
+                          Ked::Face::flag_from_sgr(attr))
+/* Foreground only, on the default background. */
+#define FACE_FG_256(fg)                                                       \
+    Ked::Face::attributes(Ked::Face::color_256(fg),                           \
+                          Ked::Face::default_color(), 0)
+/* Colors are given as 0xRRGGBB. */
+#define FACE_COLOR_RGB(fg, bg)                                                \
+    Ked::Face::attributes(Ked::Face::color_rgb(fg), Ked::Face::color_rgb(bg), \
+                          0)
+#define FACE_ATTR_COLOR_RGB(attr, fg, bg)                                     \
+    Ked::Face::attributes(Ked::Face::color_rgb(fg), Ked::Face::color_rgb(bg), \
+                          Ked::Face::flag_from_sgr(attr))
+#define FACE_NONE                                                             \
+    Ked::Face::attributes(Ked::Face::default_color(),                         \
+                          Ked::Face::default_color(), 0)
 
 #endif
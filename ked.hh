@@ -17,12 +17,60 @@
 #ifndef KED_H
 #define KED_H
 
+#include <cstddef>
+#include <string>
+#include <vector>
+
 #define PROGRAM_NAME "ked"
+/* Default memory budget of buffers the daemon keeps, in megabytes. */
+#define DAEMON_CACHE_SIZE 256
+/* Interval in milliseconds to save the session while editing. */
+#define SESSION_SAVE_INTERVAL 30000
+
+namespace Ked {
+    class Ui;
+}
+
+/* Loads extensions linked into the executable, and returns the number of
+ * them. */
+int builtin_load(void);
 
 /* Load user preference and initialize the editor with it and returns 1 if
  * success and 0 if fail. If debug is true then it loads etc/kedrc as
- * preference else loads $HOME/.kedrc. Unless the preference system extension
- * with loadSystemExtension(string path) first, it fails. */
-bool userpref_load(bool debug);
+ * preference else loads $HOME/.kedrc. The preference is a list of
+ * statements:
+ *
+ *   loadExtension(path);          (or loadSystemExtension(path);)
+ *   autoloadExtension(path);
+ *   bindKey(key, command);
+ *   bindModeKey(mode, key, command);
+ *   setFace(name, fg, bg, attribute...);
+ *
+ * where colors are palette index, "#RRGGBB" or "default", and attributes are
+ * "bold", "dim", "italic", "underline" or "reverse". # starts a comment
+ * lasting until the end of line. Unless has_builtin is true, it fails if
+ * the preference is missing or loads no extension.
+ *
+ * Extension given to autoloadExtension is loaded the first time one of its
+ * commands runs. The commands are declared in its manifest, foo.manifest for
+ * foo.so, with command(name); statements, and bindKey and bindModeKey there
+ * give default bindings. */
+bool userpref_load(bool debug, bool has_builtin);
+/* Applies key bindings and faces of the preference to ui. This must be
+ * called after extensions are attached to ui. Key bindings are applied
+ * again whenever an autoloaded extension is attached later. */
+void userpref_attach_ui(Ked::Ui &ui);
+
+/* Runs editor for clients in background, keeping the preference,
+ * extensions and buffers loaded. Clients connect to a Unix domain socket in
+ * $XDG_RUNTIME_DIR/ked or /tmp/ked-UID, and are served one at a time on
+ * their terminals. Buffers neither modified nor shown are deleted, least
+ * recently used first, while buffers take more than cache_size bytes.
+ * Returns only if the daemon cannot start. */
+int daemon_run(std::size_t cache_size);
+/* Asks the running daemon to open files on this terminal, and waits until
+ * the editor exits. Returns false if no daemon can take it, or stores the
+ * exit status to status and returns true. */
+bool client_run(std::vector<std::string> const &files, int *status);
 
 #endif
@@ -20,34 +20,37 @@
 #include <cstring>
 #include <fstream>
 #include <functional>
+#include <iterator>
+#include <map>
+#include <mutex>
 #include <string>
+#include <utility>
+#include <vector>
 
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
 
 #include <ked/Buffer.hh>
+#include <ked/Journal.hh>
+#include <ked/Keybind.hh>
+#include <ked/Unicode.hh>
 
 #include "libked.hh"
 
 namespace Ked {
-    void Buffer::BufferListener::call(Buffer &buf) {
-        /* Drop if calling to avoid infinite loop. */
-        if (calling) return;
-
-        calling = true;
-        for (auto itr = std::begin(listener); itr != std::end(listener);
-             ++itr) {
-            (*itr)(buf);
-        }
-        calling = false;
-    }
-
     Buffer::Buffer()
-        : point(0), buf_size(0), gap_start(0), gap_end(0), lend(LEND_LF),
+        : active_view(nullptr), mapping(nullptr), mapping_size(0),
+          updates_held(false), cursor_pending(false), content(nullptr),
+          point(0), buf_size(0), gap_start(0), gap_end(0), lend(LEND_LF),
           visible_start_point(0), display_range_x_start(0),
           display_range_x_end(0), display_range_y_start(0),
-          display_range_y_end(0), modified(false), cursor_x(1), cursor_y(1) {}
+          display_range_y_end(0), file_mtime(), file_size(0),
+          modified(false), version(0), paint_version(0),
+          default_face(FACE_ID_DEFAULT), cursor_x(1), cursor_y(1),
+          truncate_lines(false), scroll_x(0), events(nullptr),
+          journal(nullptr) {}
 
     Buffer::Buffer(std::string const &name) : Buffer() {
         buf_name = name;
@@ -62,142 +65,458 @@ namespace Ked {
         buf_name = name;
         path = file_path;
 
+        read_file();
+    }
+
+    Buffer::Buffer(std::string const &name, std::string const &file_path,
+                   std::string const &image)
+        : Buffer() {
+        buf_name = name;
+        path = file_path;
+
         struct stat stat_buf;
-        if (stat(file_path.c_str(), &stat_buf) != 0) {
-            buf_size = INIT_GAP_SIZE;
-            gap_end = INIT_GAP_SIZE;
-            content = new AttrRune[buf_size];
+        if (stat(file_path.c_str(), &stat_buf) == 0)
+            content = IO::map_image(image, stat_buf.st_mtim, stat_buf.st_size,
+                                    &buf_size, &gap_end, &lend, &mapping,
+                                    &mapping_size);
+        if (content == nullptr) {
+            read_file();
 
             return;
         }
 
-        std::ifstream f(file_path);
-        if (!f) {
+        file_mtime = stat_buf.st_mtim;
+        file_size = stat_buf.st_size;
+    }
+
+    Buffer::~Buffer() {
+        {
+            /* Waits for a job worker still copying the text. */
+            std::lock_guard<std::mutex> lock(content_mutex);
+            release_content();
+        }
+
+        if (journal != nullptr) {
+            if (!modified) journal->remove();
+            delete journal;
+        }
+
+        if (events != nullptr) events->forget(this);
+
+        /* Resolved keymap may be kept for the address. */
+        KeyHandling::keymap_changed();
+    }
+
+    void Buffer::read_file() {
+        struct stat stat_buf;
+        std::ifstream f;
+        if (stat(path.c_str(), &stat_buf) == 0) f.open(path);
+        if (!f.is_open()) {
             buf_size = INIT_GAP_SIZE;
             gap_end = INIT_GAP_SIZE;
             content = new AttrRune[buf_size];
+
+            return;
         }
+
+        file_mtime = stat_buf.st_mtim;
+        file_size = stat_buf.st_size;
+
         buf_size = stat_buf.st_size;
         gap_end = INIT_GAP_SIZE;
         content = IO::create_content_buffer(f, &buf_size, INIT_GAP_SIZE, &lend);
     }
 
-    Buffer::~Buffer() {
-        delete[] content;
+    void Buffer::release_content() {
+        if (mapping != nullptr)
+            munmap(mapping, mapping_size);
+        else
+            delete[] content;
+
+        mapping = nullptr;
+        mapping_size = 0;
         content = nullptr;
     }
 
     void Buffer::update_cursor_position() {
-        unsigned int new_cursor_x = 1;
-        unsigned int new_cursor_y = 1;
-
         if (point < visible_start_point) {
             cursor_y = 0;
 
             return;
         }
 
-        AttrRune *r;
-        size_t i = visible_start_point;
-        while (i < buf_size - (gap_end - gap_start) && i < point) {
-            r = get_rune_ptr(i);
-            new_cursor_x += r->display_width;
-
-            if (r->is_lf()) {
-                new_cursor_x = 1;
-                ++new_cursor_y;
-            } else if (i + 1 < buf_size - (gap_end - gap_start) &&
-                       i + 1 < point) {
-                AttrRune *next = get_rune_ptr(i + 1);
-                if (!next->is_lf() &&
-                    new_cursor_x + next->display_width >
-                        (display_range_x_end - display_range_x_start)) {
-                    new_cursor_x = 1;
-                    ++new_cursor_y;
+        /* Rows this far below the screen make scroll_in_need jump, so they
+         * need not be counted exactly. */
+        std::size_t max_y =
+            2 * (display_range_y_end - display_range_y_start) + 1;
+
+        std::size_t start = line_start(visible_start_point);
+        std::size_t y = 1;
+        for (;;) {
+            LineLayout &layout = line_layout(start);
+            std::size_t first_row =
+                start < visible_start_point
+                    ? row_of(start, layout, visible_start_point - start)
+                    : 0;
+
+            if (point <= start + layout.length) {
+                std::size_t row = row_of(start, layout, point - start);
+                if (truncate_lines) {
+                    std::size_t width =
+                        display_range_x_end - display_range_x_start;
+                    std::size_t col = column_of(start, layout, point - start);
+
+                    /* Last column is for the mark of clipped line. Bring the
+                     * cursor to the center when it goes out. */
+                    if (width >= 2 &&
+                        (col < scroll_x || col + 2 > scroll_x + width))
+                        scroll_x = col > width / 2 ? col - width / 2 : 0;
+
+                    cursor_x = col - scroll_x + 1;
+                } else {
+                    std::size_t i =
+                        start + (row == 0 ? 0 : layout.breaks[row - 1]);
+                    std::size_t x = 1;
+                    unsigned int width;
+                    while (i < point) {
+                        i = cluster_end(i, &width);
+                        x += width;
+                    }
+
+                    cursor_x = x;
                 }
+                cursor_y = y + row - first_row;
+
+                return;
+            }
+
+            lay_out(start, layout, 0, first_row + max_y);
+            if (layout.laid_out == layout.length)
+                y += layout.breaks.size() + 1 - first_row;
+            else
+                y = max_y + 1;
+
+            if (y > max_y) {
+                cursor_x = 1;
+                cursor_y = y;
+
+                return;
+            }
+
+            start += layout.length + 1;
+        }
+    }
+
+    void Buffer::lay_out(std::size_t start, LineLayout &layout,
+                         std::size_t offset, std::size_t n_breaks) {
+        std::size_t width = display_range_x_end - display_range_x_start;
+        std::size_t end = start + layout.length;
+        std::size_t i = start + layout.laid_out;
+        /* Truncated line is always a row. */
+        if (width == 0 || truncate_lines) i = end;
+
+        unsigned int used = 0;
+        unsigned int cur_width;
+        unsigned int next_width;
+        std::size_t next = cluster_end(i, &cur_width);
+        while (i < end &&
+               (layout.laid_out <= offset || layout.breaks.size() < n_breaks)) {
+            used += cur_width;
+
+            std::size_t next_end = cluster_end(next, &next_width);
+            if (next < end && used + next_width >= width) {
+                layout.breaks.push_back(next - start);
+                layout.laid_out = next - start;
+                used = 0;
             }
 
-            ++i;
+            i = next;
+            next = next_end;
+            cur_width = next_width;
+        }
+
+        if (i >= end) layout.laid_out = layout.length;
+    }
+
+    /* Returns where p is after replacing removed runes at pos with inserted
+     * ones. Positions at pos stay before the inserted runes. */
+    static std::size_t shift_point(std::size_t p, std::size_t pos,
+                                   std::size_t removed, std::size_t inserted) {
+        if (p <= pos) return p;
+        if (p < pos + removed) return pos;
+
+        return p + inserted - removed;
+    }
+
+    Buffer::LineLayout *Buffer::LayoutMap::find(std::size_t start,
+                                                std::size_t len) {
+        auto found = before.find(start);
+        if (found != std::end(before)) return &found->second;
+
+        found = after.find(len - start);
+        if (found != std::end(after)) return &found->second;
+
+        return nullptr;
+    }
+
+    Buffer::LineLayout &Buffer::LayoutMap::get(std::size_t start,
+                                               std::size_t len) {
+        LineLayout *found = find(start, len);
+        if (found != nullptr) return *found;
+
+        /* Lines in before must start earlier than ones in after. */
+        if (!after.empty() && start > len - std::prev(std::end(after))->first)
+            return after[len - start];
+
+        return before[start];
+    }
+
+    Buffer::LineLayout const *
+    Buffer::LayoutMap::last_at(std::size_t p, std::size_t len,
+                               std::size_t &start) const {
+        auto found = after.lower_bound(len - p);
+        if (found != std::end(after)) {
+            start = len - found->first;
+
+            return &found->second;
+        }
+
+        found = before.upper_bound(p);
+        if (found == std::begin(before)) return nullptr;
+
+        --found;
+        start = found->first;
+
+        return &found->second;
+    }
+
+    void Buffer::LayoutMap::edit(std::size_t pos, std::size_t removed,
+                                 std::size_t inserted, bool lf_changed,
+                                 std::size_t len) {
+        /* Moves the split to pos. Layouts after it keep their keys through
+         * the edit. */
+        for (auto itr = before.upper_bound(pos); itr != std::end(before);) {
+            auto node = before.extract(itr++);
+            node.key() = len - node.key();
+            after.insert(std::move(node));
+        }
+        for (auto itr = after.lower_bound(len - pos); itr != std::end(after);) {
+            auto node = after.extract(itr++);
+            node.key() = len - node.key();
+            before.insert(std::move(node));
+        }
+
+        if (!before.empty()) {
+            auto line = std::prev(std::end(before));
+            if (pos <= line->first + line->second.length) {
+                if (lf_changed) {
+                    before.erase(line);
+                } else {
+                    LineLayout &layout = line->second;
+                    layout.length = layout.length + inserted - removed;
+
+                    /* Text before the edit is not changed, but the cluster
+                     * just before it may be, and so is the break before
+                     * that cluster. */
+                    std::size_t n = std::lower_bound(std::begin(layout.breaks),
+                                                     std::end(layout.breaks),
+                                                     pos - line->first) -
+                                    std::begin(layout.breaks);
+                    layout.breaks.resize(n == 0 ? 0 : n - 1);
+                    layout.laid_out =
+                        layout.breaks.empty() ? 0 : layout.breaks.back();
+
+                    /* Clusters before the edit still begin at the same
+                     * column. */
+                    n = std::lower_bound(std::begin(layout.column_offsets),
+                                         std::end(layout.column_offsets),
+                                         pos - line->first) -
+                        std::begin(layout.column_offsets);
+                    layout.column_offsets.resize(n);
+                    layout.columns.resize(n);
+                    layout.column_indexed = false;
+                }
+            }
         }
 
-        cursor_x = new_cursor_x;
-        cursor_y = new_cursor_y;
+        /* Lines joined to the edited one. */
+        after.erase(after.lower_bound(len - pos - removed), std::end(after));
+    }
+
+    void Buffer::LayoutMap::clear() {
+        before.clear();
+        after.clear();
+    }
+
+    void Buffer::LayoutMap::swap(LayoutMap &other) {
+        before.swap(other.before);
+        after.swap(other.after);
+    }
+
+    void Buffer::update_layouts(std::size_t pos, std::size_t removed,
+                                std::size_t inserted, bool lf_changed) {
+        std::size_t len = buf_size - (gap_end - gap_start) - inserted + removed;
+        layouts.edit(pos, removed, inserted, lf_changed, len);
+
+        visible_start_point =
+            shift_point(visible_start_point, pos, removed, inserted);
+        visible_start_point = row_start(visible_start_point);
+
+        /* Parked views are laid out again when they are brought in. */
+        for (auto itr = std::begin(views); itr != std::end(views); ++itr) {
+            View *view = *itr;
+            if (view == active_view) continue;
+
+            view->layouts.edit(pos, removed, inserted, lf_changed, len);
+            view->point = shift_point(view->point, pos, removed, inserted);
+            view->visible_start_point = shift_point(view->visible_start_point,
+                                                    pos, removed, inserted);
+            view->edited = true;
+        }
     }
 
     void Buffer::expand(std::size_t amount) {
         AttrRune *new_buf = new AttrRune[buf_size + amount];
         for (std::size_t i = 0; i < gap_start; ++i)
             new_buf[i] = content[i];
-        for (std::size_t i = gap_end; i < buf_size - gap_end; ++i)
+        for (std::size_t i = gap_end; i < buf_size; ++i)
             new_buf[i + amount] = content[i];
-        delete[] content;
+        release_content();
 
         content = new_buf;
         gap_end += amount;
         buf_size += amount;
     }
 
+    void Buffer::move_gap() {
+        if (point > gap_start) {
+            std::copy(content + gap_end,
+                      content + gap_end + (point - gap_start),
+                      content + gap_start);
+            gap_end += point - gap_start;
+            gap_start = point;
+        } else if (point < gap_start) {
+            std::copy_backward(content + point, content + gap_start,
+                               content + gap_end);
+            gap_end -= gap_start - point;
+            gap_start = point;
+        }
+    }
+
     void Buffer::scroll_in_need() {
-        if (cursor_y > display_range_y_end - display_range_y_start) {
-            scroll(1, true);
+        std::size_t height = display_range_y_end - display_range_y_start;
+        if (height == 0) return;
+
+        if (cursor_y > height * 2) {
+            /* Cursor went far away from the screen; jump to its row rather
+             * than scrolling row by row. */
+            visible_start_point = row_start(point);
+            scroll(height - 1, false);
 
             update_cursor_position();
+        }
+
+        if (cursor_y > height) {
+            while (cursor_y > height) {
+                std::size_t prev_start = visible_start_point;
+                scroll(1, true);
+                if (visible_start_point == prev_start) break;
+
+                update_cursor_position();
+            }
         } else if (cursor_y == 0) {
-            scroll(1, false);
+            /* Show the cursor on the top row. */
+            visible_start_point = row_start(point);
 
             update_cursor_position();
         }
     }
 
+    void Buffer::cursor_moved(bool notify) {
+        if (notify && events != nullptr) events->point_moved(this);
+
+        if (updates_held) {
+            cursor_pending = true;
+
+            return;
+        }
+
+        std::size_t prev_start = visible_start_point;
+        std::size_t prev_scroll_x = scroll_x;
+
+        update_cursor_position();
+
+        scroll_in_need();
+
+        if (events != nullptr && (visible_start_point != prev_start ||
+                                  scroll_x != prev_scroll_x))
+            events->viewport_changed(this);
+    }
+
+    void Buffer::text_changed(std::size_t pos, std::size_t removed,
+                              std::size_t inserted, bool lf_changed) {
+        modified = true;
+        {
+            /* Job workers check version between chunks they copy. */
+            std::lock_guard<std::mutex> lock(content_mutex);
+            ++version;
+        }
+
+        update_layouts(pos, removed, inserted, lf_changed);
+
+        if (journal != nullptr) journal->record(*this, pos, removed, inserted);
+
+        if (events != nullptr)
+            events->text_changed(this, pos, removed, inserted);
+    }
+
+    void Buffer::hold_updates() { updates_held = true; }
+
+    void Buffer::release_updates() {
+        if (!updates_held) return;
+
+        updates_held = false;
+        if (cursor_pending) cursor_moved(false);
+        cursor_pending = false;
+    }
+
     void Buffer::cursor_move(std::size_t n, bool forward) {
         if (n == 0) return;
 
         if (forward) {
-            if (n > buf_size - gap_end) {
-                n = buf_size - gap_end;
+            std::size_t len = buf_size - (gap_end - gap_start);
+            if (n > len - point) {
+                n = len - point;
             }
-
-            for (std::size_t i = 0; i < n; ++i)
-                content[gap_start + i] = content[gap_end + i];
-            gap_start += n;
-            gap_end += n;
-            point += n;
+            /* Never stop inside of a grapheme cluster. */
+            point = cluster_boundary(point + n, true);
         } else {
-            if (n > gap_start) {
-                n = gap_start;
+            if (n > point) {
+                n = point;
             }
-
-            for (std::size_t i = 0; i < n; ++i)
-                content[gap_end - i - 1] = content[gap_start - i - 1];
-            gap_start -= n;
-            gap_end -= n;
-            point -= n;
+            point = cluster_boundary(point - n, false);
         }
 
-        update_cursor_position();
-
-        scroll_in_need();
-
-        on_cursor_move_listeners.call(*this);
+        cursor_moved(true);
     }
 
     void Buffer::insert(Rune const &r) {
-        if (gap_end - gap_start < MIN_GAP_SIZE) expand(INIT_GAP_SIZE);
+        {
+            std::lock_guard<std::mutex> lock(content_mutex);
+            move_gap();
+            if (gap_end - gap_start < MIN_GAP_SIZE) expand(INIT_GAP_SIZE);
 
-        content[gap_start].c = r;
-        content[gap_start].face_name = default_face_name;
-        content[gap_start].calculate_width();
+            content[gap_start].c = r;
+            content[gap_start].face = FACE_ID_DEFAULT;
+            content[gap_start].calculate_width();
 
-        ++gap_start;
+            ++gap_start;
+        }
         ++point;
 
-        modified = true;
-
-        update_cursor_position();
-
-        scroll_in_need();
+        text_changed(point - 1, 0, 1, content[gap_start - 1].is_lf());
 
-        on_cursor_move_listeners.call(*this);
+        cursor_moved(true);
     }
 
     void Buffer::insert(char const c) {
@@ -207,64 +526,181 @@ namespace Ked {
         insert(r);
     }
 
+    void Buffer::insert_utf8(char const *str, std::size_t len) {
+        std::size_t n_rune = IO::count_runes(str, len);
+        if (n_rune == 0) return;
+
+        {
+            std::lock_guard<std::mutex> lock(content_mutex);
+            move_gap();
+            if (gap_end - gap_start < n_rune + MIN_GAP_SIZE)
+                expand(n_rune + INIT_GAP_SIZE);
+
+            n_rune = IO::decode_utf8(str, len, content + gap_start);
+
+            gap_start += n_rune;
+        }
+        point += n_rune;
+
+        text_changed(point - n_rune, 0, n_rune,
+                     std::memchr(str, '\n', len) != nullptr);
+
+        cursor_moved(true);
+    }
+
+    void Buffer::replace(std::size_t pos, std::size_t removed,
+                         char const *str, std::size_t len) {
+        std::size_t text_len = buf_size - (gap_end - gap_start);
+        if (pos > text_len) pos = text_len;
+        if (removed > text_len - pos) removed = text_len - pos;
+        if (removed == 0 && len == 0) return;
+
+        point = pos;
+
+        bool lf_changed = std::memchr(str, '\n', len) != nullptr;
+        std::size_t n_rune = IO::count_runes(str, len);
+        {
+            std::lock_guard<std::mutex> lock(content_mutex);
+            move_gap();
+
+            for (std::size_t i = gap_end; i < gap_end + removed; ++i)
+                if (content[i].is_lf()) lf_changed = true;
+            gap_end += removed;
+
+            if (gap_end - gap_start < n_rune + MIN_GAP_SIZE)
+                expand(n_rune + INIT_GAP_SIZE);
+
+            n_rune = IO::decode_utf8(str, len, content + gap_start);
+            gap_start += n_rune;
+        }
+        point += n_rune;
+
+        text_changed(pos, removed, n_rune, lf_changed);
+
+        cursor_moved(true);
+    }
+
+    void Buffer::clear() {
+        std::size_t len = buf_size - (gap_end - gap_start);
+        if (len == 0) return;
+
+        {
+            std::lock_guard<std::mutex> lock(content_mutex);
+            gap_start = 0;
+            gap_end = buf_size;
+        }
+        point = 0;
+
+        text_changed(0, len, 0, true);
+
+        cursor_moved(true);
+    }
+
     void Buffer::delete_backward() {
         if (point == 0) return;
 
-        if (get_rune(point - 1).is_protected()) return;
-
-        --gap_start;
-        --point;
+        std::size_t start = cluster_boundary(point - 1, false);
+        bool lf_changed = false;
+        for (std::size_t i = start; i < point; ++i) {
+            if (get_rune(i).is_protected()) return;
+            if (get_rune(i).is_lf()) lf_changed = true;
+        }
 
-        update_cursor_position();
+        std::size_t n = point - start;
+        {
+            std::lock_guard<std::mutex> lock(content_mutex);
+            move_gap();
+            gap_start -= n;
+        }
+        point = start;
 
-        scroll_in_need();
+        text_changed(point, n, 0, lf_changed);
 
-        on_cursor_move_listeners.call(*this);
+        cursor_moved(true);
     }
 
     void Buffer::delete_forward() {
         if (point >= buf_size - (gap_end - gap_start)) return;
 
-        if (get_rune(point).is_protected()) return;
+        std::size_t end = cluster_end(point);
+        bool lf_changed = false;
+        for (std::size_t i = point; i < end; ++i) {
+            if (get_rune(i).is_protected()) return;
+            if (get_rune(i).is_lf()) lf_changed = true;
+        }
 
-        ++gap_end;
+        {
+            std::lock_guard<std::mutex> lock(content_mutex);
+            move_gap();
+            gap_end += end - point;
+        }
 
-        update_cursor_position();
+        text_changed(point, end - point, 0, lf_changed);
 
-        /* Do NOT call on_cursor_move_listener here because forward deleting do
-         * not change cursor point. */
+        /* Forward deleting does not change cursor point, so no point moved
+         * event is raised. */
+        cursor_moved(false);
     }
 
-    void Buffer::scroll(std::size_t n, bool forward) {
-        if (forward) {
-            std::size_t new_point = visible_start_point;
-            while (new_point < buf_size - (gap_end - gap_start) && n != 0) {
-                if (get_rune(new_point).is_lf()) --n;
+    void Buffer::set_display_range(std::size_t x_start, std::size_t x_end,
+                                   std::size_t y_start, std::size_t y_end) {
+        if (x_end - x_start != display_range_x_end - display_range_x_start) {
+            layouts.clear();
+            short_layout.breaks.clear();
+        }
 
-                ++new_point;
-            }
+        display_range_x_start = x_start;
+        display_range_x_end = x_end;
+        display_range_y_start = y_start;
+        display_range_y_end = y_end;
+        visible_start_point = row_start(visible_start_point);
 
-            visible_start_point = new_point;
-        } else {
-            if (visible_start_point == 0) return;
+        /* Only the part from visible_start_point to the cursor is walked, so
+         * this costs the same however large the buffer is. */
+        update_cursor_position();
+
+        scroll_in_need();
 
-            ++n;
-            std::size_t new_point = visible_start_point - 1;
-            while (new_point != 0 && n != 0) {
-                if (get_rune(new_point).is_lf()) {
-                    --n;
-                    if (n == 0) {
-                        ++new_point;
+        if (events != nullptr) events->viewport_changed(this);
+    }
 
+    void Buffer::scroll(std::size_t n, bool forward) {
+        std::size_t start = line_start(visible_start_point);
+        while (n != 0) {
+            LineLayout &layout = line_layout(start);
+            std::size_t row =
+                row_of(start, layout, visible_start_point - start);
+
+            if (forward) {
+                if (row_end(start, layout, row) != layout.length) {
+                    visible_start_point = start + layout.breaks[row];
+                } else {
+                    if (start + layout.length >=
+                        buf_size - (gap_end - gap_start))
                         break;
-                    }
+
+                    start += layout.length + 1;
+                    visible_start_point = start;
                 }
+            } else {
+                if (row != 0) {
+                    visible_start_point =
+                        start + (row == 1 ? 0 : layout.breaks[row - 2]);
+                } else {
+                    if (start == 0) break;
 
-                --new_point;
+                    start = line_start(start - 1);
+                    LineLayout &prev = line_layout(start);
+                    lay_out(start, prev, prev.length, 0);
+                    visible_start_point =
+                        start + (prev.breaks.empty() ? 0 : prev.breaks.back());
+                }
             }
 
-            visible_start_point = new_point;
+            --n;
         }
+
+        if (events != nullptr) events->viewport_changed(this);
     }
 
     SearchResult *Buffer::search(std::size_t start_point, String const &search,
@@ -344,9 +780,29 @@ namespace Ked {
         bool success = IO::save_buffer_utf8(*this);
         if (success) modified = false;
 
+        struct stat stat_buf;
+        if (success && stat(path.c_str(), &stat_buf) == 0) {
+            file_mtime = stat_buf.st_mtim;
+            file_size = stat_buf.st_size;
+        }
+        if (success && journal != nullptr) journal->reset(*this);
+
         return success;
     }
 
+    bool Buffer::write_image(std::string const &image) const {
+        if (modified || path.empty()) return false;
+
+        struct stat stat_buf;
+        if (stat(path.c_str(), &stat_buf) != 0 ||
+            stat_buf.st_mtim.tv_sec != file_mtime.tv_sec ||
+            stat_buf.st_mtim.tv_nsec != file_mtime.tv_nsec ||
+            (std::size_t)stat_buf.st_size != file_size)
+            return false;
+
+        return IO::write_image(*this, image);
+    }
+
     AttrRune &Buffer::get_rune(std::size_t point) const {
         return gap_start <= point ? content[point + (gap_end - gap_start)]
                                   : content[point];
@@ -357,9 +813,312 @@ namespace Ked {
                                   : content + point;
     }
 
-    void
-    Buffer::add_cursor_move_listener(std::function<void(Buffer &)> listener) {
-        on_cursor_move_listeners.listener.push_back(listener);
+    std::size_t Buffer::cluster_end(std::size_t p, unsigned int *width) const {
+        std::size_t len = buf_size - (gap_end - gap_start);
+        if (p >= len) {
+            if (width != nullptr) *width = 0;
+
+            return len;
+        }
+
+        AttrRune *r = get_rune_ptr(p);
+
+        /* ASCII followed by ASCII is always a cluster by itself, which keeps
+         * ASCII text away from the tables. CR is drawn as ^M, so it is not
+         * joined with following LF either. */
+        if (r->c[0] == '\r' ||
+            (r->c[0] < 0x80 &&
+             (p + 1 >= len || get_rune_ptr(p + 1)->c[0] < 0x80))) {
+            if (width != nullptr) *width = r->display_width;
+
+            return p + 1;
+        }
+
+        Unicode::GraphemeState state;
+        Unicode::grapheme_begin(
+            state, Unicode::grapheme_break(Unicode::decode(r->c)));
+        unsigned int w = r->display_width;
+
+        std::size_t i = p + 1;
+        for (; i < len; ++i) {
+            AttrRune *next = get_rune_ptr(i);
+            bool after_zwj = state.prev == Unicode::GB_ZWJ;
+            if (Unicode::grapheme_break_before(
+                    state, Unicode::grapheme_break(Unicode::decode(next->c))))
+                break;
+
+            /* Pictograph joined with ZWJ is drawn as a part of the first
+             * one. */
+            if (!after_zwj) w += next->display_width;
+        }
+
+        /* Cluster of only zero width characters is drawn after a space. */
+        if (w == 0) w = 1;
+        if (width != nullptr) *width = w;
+
+        return i;
+    }
+
+    std::size_t Buffer::cluster_boundary(std::size_t p, bool forward) const {
+        std::size_t len = buf_size - (gap_end - gap_start);
+        if (p == 0) return 0;
+        if (p >= len) return len;
+
+        AttrRune *prev = get_rune_ptr(p - 1);
+        AttrRune *cur = get_rune_ptr(p);
+        if (prev->c[0] < 0x80 && cur->c[0] < 0x80) return p;
+
+        /* Look back for a place surely to be a boundary, then split clusters
+         * from there. */
+        std::size_t start = p - 1;
+        for (std::size_t n = 0; start > 0 && n < MAX_CLUSTER_CONTEXT;
+             --start, ++n) {
+            prev = get_rune_ptr(start - 1);
+            cur = get_rune_ptr(start);
+            if (prev->is_lf() || prev->c[0] == '\r' ||
+                (prev->c[0] < 0x80 && cur->c[0] < 0x80))
+                break;
+        }
+
+        for (;;) {
+            std::size_t end = cluster_end(start);
+            if (end == p) return p;
+            if (end > p) return forward ? end : start;
+
+            start = end;
+        }
+    }
+
+    std::size_t Buffer::line_start(std::size_t p) const {
+        std::size_t len = buf_size - (gap_end - gap_start);
+        std::size_t start;
+        LineLayout const *found = layouts.last_at(p, len, start);
+        if (found != nullptr && p <= start + found->length) return start;
+
+        while (p > 0 && !get_rune_ptr(p - 1)->is_lf()) --p;
+
+        return p;
+    }
+
+    Buffer::LineLayout &Buffer::line_layout(std::size_t start) {
+        std::size_t len = buf_size - (gap_end - gap_start);
+        LineLayout *found = layouts.find(start, len);
+        if (found != nullptr) return *found;
+
+        std::size_t end = start;
+        while (end < len && !get_rune_ptr(end)->is_lf()) ++end;
+
+        LineLayout &layout = end - start < MIN_CACHED_LINE_LENGTH
+                                 ? short_layout
+                                 : layouts.get(start, len);
+        layout.length = end - start;
+        layout.breaks.clear();
+        layout.laid_out = 0;
+        layout.column_offsets.clear();
+        layout.columns.clear();
+        layout.column_indexed = false;
+
+        return layout;
+    }
+
+    std::size_t Buffer::row_of(std::size_t start, LineLayout &layout,
+                               std::size_t offset) {
+        lay_out(start, layout, offset, 0);
+
+        return std::upper_bound(std::begin(layout.breaks),
+                                std::end(layout.breaks), offset) -
+               std::begin(layout.breaks);
+    }
+
+    std::size_t Buffer::row_end(std::size_t start, LineLayout &layout,
+                                std::size_t row) {
+        lay_out(start, layout, row == 0 ? 0 : layout.breaks[row - 1], row + 1);
+
+        return row < layout.breaks.size() ? layout.breaks[row] : layout.length;
+    }
+
+    std::size_t Buffer::row_start(std::size_t p) {
+        std::size_t start = line_start(p);
+        LineLayout &layout = line_layout(start);
+        std::size_t row = row_of(start, layout, p - start);
+
+        return start + (row == 0 ? 0 : layout.breaks[row - 1]);
+    }
+
+    void Buffer::index_columns(std::size_t start, LineLayout &layout,
+                               std::size_t offset, std::size_t column) {
+        if (layout.column_offsets.empty()) {
+            layout.column_offsets.push_back(0);
+            layout.columns.push_back(0);
+        }
+
+        std::size_t end = start + layout.length;
+        std::size_t i = start + layout.column_offsets.back();
+        std::size_t col = layout.columns.back();
+        std::size_t last = i;
+        unsigned int width;
+        while (!layout.column_indexed &&
+               (layout.column_offsets.back() <= offset ||
+                layout.columns.back() <= column)) {
+            if (i >= end) {
+                layout.column_indexed = true;
+
+                break;
+            }
+
+            i = cluster_end(i, &width);
+            col += width;
+
+            if (i - last >= COLUMN_INDEX_INTERVAL && i < end) {
+                layout.column_offsets.push_back(i - start);
+                layout.columns.push_back(col);
+                last = i;
+            }
+        }
+    }
+
+    std::size_t Buffer::column_of(std::size_t start, LineLayout &layout,
+                                  std::size_t offset) {
+        index_columns(start, layout, offset, 0);
+
+        std::size_t k = std::upper_bound(std::begin(layout.column_offsets),
+                                         std::end(layout.column_offsets),
+                                         offset) -
+                        std::begin(layout.column_offsets) - 1;
+        std::size_t i = start + layout.column_offsets[k];
+        std::size_t col = layout.columns[k];
+        unsigned int width;
+        while (i < start + offset) {
+            i = cluster_end(i, &width);
+            col += width;
+        }
+
+        return col;
+    }
+
+    std::size_t Buffer::offset_at(std::size_t start, LineLayout &layout,
+                                  std::size_t column,
+                                  std::size_t *cluster_column) {
+        index_columns(start, layout, 0, column);
+
+        std::size_t k =
+            std::upper_bound(std::begin(layout.columns),
+                             std::end(layout.columns), column) -
+            std::begin(layout.columns) - 1;
+        std::size_t end = start + layout.length;
+        std::size_t i = start + layout.column_offsets[k];
+        std::size_t col = layout.columns[k];
+        unsigned int width;
+        while (i < end) {
+            std::size_t next = cluster_end(i, &width);
+            if (col + width > column) break;
+
+            col += width;
+            i = next;
+        }
+
+        *cluster_column = col;
+
+        return i - start;
+    }
+
+    void Buffer::add_keybind(std::string const &key,
+                             KeyHandling::EditorCommand func) {
+        keybind.add(key, func);
+    }
+
+    std::string const &Buffer::mode() const { return mode_name; }
+
+    void Buffer::set_mode(std::string const &name) {
+        if (name == mode_name) return;
+
+        mode_name = name;
+        KeyHandling::keymap_changed();
+    }
+
+    void Buffer::add_view(View &view) {
+        if (views.empty()) {
+            active_view = &view;
+        } else {
+            /* Layouts are made again as the view needs them. */
+            view.point = point;
+            view.visible_start_point = visible_start_point;
+            view.display_range_x_start = display_range_x_start;
+            view.display_range_x_end = display_range_x_end;
+            view.display_range_y_start = display_range_y_start;
+            view.display_range_y_end = display_range_y_end;
+            view.cursor_x = cursor_x;
+            view.cursor_y = cursor_y;
+            view.truncate_lines = truncate_lines;
+            view.scroll_x = scroll_x;
+            view.layouts.clear();
+            view.edited = false;
+        }
+
+        views.push_back(&view);
+    }
+
+    void Buffer::remove_view(View &view) {
+        views.erase(std::remove(std::begin(views), std::end(views), &view),
+                    std::end(views));
+        /* The members keep its viewport for the view added next. */
+        if (active_view == &view) active_view = nullptr;
+    }
+
+    void Buffer::use_view(View &view) {
+        if (active_view == &view) return;
+
+        if (active_view != nullptr) {
+            View &parked = *active_view;
+            parked.point = point;
+            parked.visible_start_point = visible_start_point;
+            parked.display_range_x_start = display_range_x_start;
+            parked.display_range_x_end = display_range_x_end;
+            parked.display_range_y_start = display_range_y_start;
+            parked.display_range_y_end = display_range_y_end;
+            parked.cursor_x = cursor_x;
+            parked.cursor_y = cursor_y;
+            parked.truncate_lines = truncate_lines;
+            parked.scroll_x = scroll_x;
+            parked.layouts.swap(layouts);
+            parked.edited = false;
+        }
+
+        point = view.point;
+        visible_start_point = view.visible_start_point;
+        display_range_x_start = view.display_range_x_start;
+        display_range_x_end = view.display_range_x_end;
+        display_range_y_start = view.display_range_y_start;
+        display_range_y_end = view.display_range_y_end;
+        cursor_x = view.cursor_x;
+        cursor_y = view.cursor_y;
+        truncate_lines = view.truncate_lines;
+        scroll_x = view.scroll_x;
+        layouts.swap(view.layouts);
+        view.layouts.clear();
+        active_view = &view;
+
+        if (view.edited) {
+            view.edited = false;
+
+            visible_start_point = row_start(visible_start_point);
+            update_cursor_position();
+            scroll_in_need();
+        }
+    }
+
+    void Buffer::set_truncate_lines(bool truncate) {
+        truncate_lines = truncate;
+        scroll_x = 0;
+
+        layouts.clear();
+        visible_start_point = row_start(visible_start_point);
+
+        update_cursor_position();
+
+        scroll_in_need();
+
+        if (events != nullptr) events->viewport_changed(this);
     }
 
     Buffer *buffer_from_stdin() {
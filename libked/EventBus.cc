@@ -0,0 +1,148 @@
+/*
+ * ked -- simple text editor with minimal dependency
+ * Copyright (C) 2019  Koki Fukuda
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <map>
+#include <utility>
+#include <vector>
+
+#include <ked/Buffer.hh>
+#include <ked/EventBus.hh>
+#include <ked/Profile.hh>
+
+namespace Ked {
+    void EventBus::on_text_changed(
+        std::function<void(TextChangedEvent const &)> listener) {
+        Profile::Site *site = Profile::site("on_text_changed");
+        text_changed_listeners.push_back({listener, site});
+    }
+
+    void EventBus::on_point_moved(
+        std::function<void(PointMovedEvent const &)> listener) {
+        Profile::Site *site = Profile::site("on_point_moved");
+        point_moved_listeners.push_back({listener, site});
+    }
+
+    void EventBus::on_buffer_added(
+        std::function<void(BufferAddedEvent const &)> listener) {
+        Profile::Site *site = Profile::site("on_buffer_added");
+        buffer_added_listeners.push_back({listener, site});
+    }
+
+    void EventBus::on_viewport_changed(
+        std::function<void(ViewportChangedEvent const &)> listener) {
+        Profile::Site *site = Profile::site("on_viewport_changed");
+        viewport_changed_listeners.push_back({listener, site});
+    }
+
+    EventBus::Pending &EventBus::pending_of(Buffer *buf) {
+        auto found = pending.find(buf);
+        if (found != std::end(pending)) return found->second;
+
+        Pending &p = pending[buf];
+        p.text_changed = false;
+        p.start = 0;
+        p.end = 0;
+        p.delta = 0;
+        p.point_moved = false;
+        p.viewport_changed = false;
+
+        return p;
+    }
+
+    void EventBus::text_changed(Buffer *buf, std::size_t pos,
+                                std::size_t removed, std::size_t inserted) {
+        if (text_changed_listeners.empty()) return;
+
+        Pending &p = pending_of(buf);
+        if (!p.text_changed) {
+            p.text_changed = true;
+            p.start = pos;
+            p.end = pos + inserted;
+        } else {
+            /* Grow the range to cover both, in the new coordinates. */
+            if (p.end >= pos + removed)
+                p.end = p.end - removed + inserted;
+            else
+                p.end = std::max(p.end, pos + inserted);
+            p.start = std::min(p.start, pos);
+        }
+        p.delta += (long)inserted - (long)removed;
+    }
+
+    void EventBus::point_moved(Buffer *buf) {
+        if (point_moved_listeners.empty()) return;
+
+        pending_of(buf).point_moved = true;
+    }
+
+    void EventBus::buffer_added(Buffer *buf) { added.push_back(buf); }
+
+    void EventBus::viewport_changed(Buffer *buf) {
+        if (viewport_changed_listeners.empty()) return;
+
+        pending_of(buf).viewport_changed = true;
+    }
+
+    void EventBus::forget(Buffer *buf) {
+        pending.erase(buf);
+        added.erase(std::remove(std::begin(added), std::end(added), buf),
+                    std::end(added));
+    }
+
+    void EventBus::deliver() {
+        for (int round = 0; round < MAX_DELIVERY_ROUNDS; ++round) {
+            if (added.empty() && pending.empty()) return;
+
+            /* Listeners may raise events, which go to the next round. */
+            std::vector<Buffer *> bufs;
+            bufs.swap(added);
+            std::map<Buffer *, Pending> events;
+            events.swap(pending);
+
+            for (auto itr = std::begin(bufs); itr != std::end(bufs); ++itr) {
+                BufferAddedEvent ev = {*itr};
+                call(buffer_added_listeners, ev);
+            }
+
+            for (auto itr = std::begin(events); itr != std::end(events);
+                 ++itr) {
+                Buffer *buf = itr->first;
+                Pending &p = itr->second;
+
+                if (p.text_changed) {
+                    std::size_t old_end = (long)p.end - p.delta;
+                    TextChangedEvent ev = {buf, p.start, p.end, old_end};
+                    call(text_changed_listeners, ev);
+                }
+
+                if (p.point_moved) {
+                    PointMovedEvent ev = {buf, buf->point};
+                    call(point_moved_listeners, ev);
+                }
+
+                if (p.viewport_changed) {
+                    ViewportChangedEvent ev = {buf};
+                    call(viewport_changed_listeners, ev);
+                }
+            }
+        }
+    }
+} // namespace Ked
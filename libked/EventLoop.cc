@@ -0,0 +1,223 @@
+/*
+ * ked -- simple text editor with minimal dependency
+ * Copyright (C) 2019  Koki Fukuda
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <cerrno>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include <pthread.h>
+#include <signal.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#include <ked/EventLoop.hh>
+
+/* Maximum number of events received by one epoll_wait. */
+#define MAX_EVENTS 64
+
+namespace Ked {
+    EventLoop::EventLoop() {
+        epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+
+        sigemptyset(&signals);
+        signal_fd = signalfd(-1, &signals, SFD_NONBLOCK | SFD_CLOEXEC);
+        wakeup_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+        struct epoll_event ev;
+        ev.events = EPOLLIN;
+        ev.data.fd = signal_fd;
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, signal_fd, &ev);
+        ev.data.fd = wakeup_fd;
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, wakeup_fd, &ev);
+    }
+
+    EventLoop::~EventLoop() {
+        for (auto itr = std::begin(timers); itr != std::end(timers); ++itr)
+            close(itr->first);
+
+        close(wakeup_fd);
+        close(signal_fd);
+        close(epoll_fd);
+    }
+
+    bool EventLoop::add_fd(int fd, std::uint32_t events,
+                           std::function<void(std::uint32_t)> callback) {
+        struct epoll_event ev;
+        ev.events = events;
+        ev.data.fd = fd;
+
+        int op = fd_callbacks.count(fd) != 0 ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
+        if (epoll_ctl(epoll_fd, op, fd, &ev) != 0) return false;
+
+        fd_callbacks[fd] = callback;
+
+        return true;
+    }
+
+    void EventLoop::remove_fd(int fd) {
+        if (fd_callbacks.erase(fd) == 0) return;
+
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+    }
+
+    int EventLoop::add_timer(unsigned int ms, bool repeat,
+                             std::function<void()> callback) {
+        int fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        if (fd < 0) return -1;
+
+        struct itimerspec spec;
+        spec.it_value.tv_sec = ms / 1000;
+        spec.it_value.tv_nsec = (ms % 1000) * 1000000L;
+        /* Zero it_value disarms the timer, so fire immediately instead. */
+        if (ms == 0) spec.it_value.tv_nsec = 1;
+        spec.it_interval.tv_sec = 0;
+        spec.it_interval.tv_nsec = 0;
+        if (repeat) spec.it_interval = spec.it_value;
+
+        struct epoll_event ev;
+        ev.events = EPOLLIN;
+        ev.data.fd = fd;
+        if (timerfd_settime(fd, 0, &spec, nullptr) != 0 ||
+            epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev) != 0) {
+            close(fd);
+
+            return -1;
+        }
+
+        Timer &t = timers[fd];
+        t.repeat = repeat;
+        t.callback = callback;
+
+        return fd;
+    }
+
+    void EventLoop::cancel_timer(int id) {
+        if (timers.erase(id) == 0) return;
+
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, id, nullptr);
+        close(id);
+    }
+
+    bool EventLoop::add_signal(int sig, std::function<void()> callback) {
+        if (sigismember(&signals, sig) != 1) {
+            sigset_t set;
+            sigemptyset(&set);
+            sigaddset(&set, sig);
+            if (pthread_sigmask(SIG_BLOCK, &set, nullptr) != 0) return false;
+
+            sigaddset(&signals, sig);
+            if (signalfd(signal_fd, &signals, 0) < 0) return false;
+        }
+
+        signal_callbacks[sig].push_back(callback);
+
+        return true;
+    }
+
+    void EventLoop::post(std::function<void()> callback) {
+        {
+            std::lock_guard<std::mutex> lock(posted_mutex);
+            posted.push_back(std::move(callback));
+        }
+
+        std::uint64_t one = 1;
+        write(wakeup_fd, &one, sizeof(one));
+    }
+
+    void EventLoop::dispatch_signals() {
+        struct signalfd_siginfo info;
+        while (read(signal_fd, &info, sizeof(info)) == sizeof(info)) {
+            auto found = signal_callbacks.find(info.ssi_signo);
+            if (found == std::end(signal_callbacks)) continue;
+
+            /* Copy them since callback may add another one. */
+            std::vector<std::function<void()>> callbacks = found->second;
+            for (auto itr = std::begin(callbacks); itr != std::end(callbacks);
+                 ++itr)
+                (*itr)();
+        }
+    }
+
+    void EventLoop::dispatch_posted() {
+        std::uint64_t count;
+        read(wakeup_fd, &count, sizeof(count));
+
+        std::vector<std::function<void()>> callbacks;
+        {
+            std::lock_guard<std::mutex> lock(posted_mutex);
+            callbacks.swap(posted);
+        }
+
+        for (auto itr = std::begin(callbacks); itr != std::end(callbacks);
+             ++itr)
+            (*itr)();
+    }
+
+    void EventLoop::dispatch_timer(int fd) {
+        auto found = timers.find(fd);
+        if (found == std::end(timers)) return;
+
+        std::uint64_t expirations;
+        if (read(fd, &expirations, sizeof(expirations)) !=
+            sizeof(expirations))
+            return;
+
+        /* Callback may cancel the timer, so keep it alive while calling. */
+        std::function<void()> callback = found->second.callback;
+        if (!found->second.repeat) cancel_timer(fd);
+
+        callback();
+    }
+
+    int EventLoop::run_once(int timeout_ms) {
+        struct epoll_event events[MAX_EVENTS];
+
+        int n;
+        do {
+            n = epoll_wait(epoll_fd, events, MAX_EVENTS, timeout_ms);
+        } while (n < 0 && errno == EINTR);
+
+        for (int i = 0; i < n; ++i) {
+            int fd = events[i].data.fd;
+
+            if (fd == signal_fd) {
+                dispatch_signals();
+            } else if (fd == wakeup_fd) {
+                dispatch_posted();
+            } else if (timers.count(fd) != 0) {
+                dispatch_timer(fd);
+            } else {
+                auto found = fd_callbacks.find(fd);
+                /* Removed by former callback. */
+                if (found == std::end(fd_callbacks)) continue;
+
+                std::function<void(std::uint32_t)> callback = found->second;
+                callback(events[i].events);
+            }
+        }
+
+        return n < 0 ? 0 : n;
+    }
+} // namespace Ked
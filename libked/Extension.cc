@@ -16,52 +16,317 @@
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <functional>
 #include <string>
 #include <iterator>
+#include <thread>
 #include <vector>
 
 #include <dlfcn.h>
+#include <fcntl.h>
+#include <unistd.h>
 
 #include <ked/Extension.hh>
+#include <ked/Profile.hh>
 #include <ked/Ui.hh>
 
+/* Maximum number of threads opening extensions at once. */
+#define MAX_LOADER_THREADS 8
+
 namespace Ked {
     namespace Extension {
-        static std::vector<void *> handles;
+        struct Loaded {
+            /* nullptr for built-in one. */
+            void *handle;
+            /* File name without directory and ".so", which commands and
+             * listeners of the extension are profiled as. */
+            std::string name;
+            /* Canonical path of the file, or empty for built-in one. */
+            std::string path;
+            Hooks hooks;
+        };
+
+        /* Extension loaded on demand. */
+        struct Autoload {
+            std::string path;
+            std::vector<std::string> commands;
+            bool loaded;
+        };
+
+        static std::vector<Loaded> handles;
+        static std::vector<Autoload> autoloads;
         static Ked::Ui *attached_ui;
+        static std::function<void(Ked::Ui &)> autoload_attached;
+
+        static std::string extension_name(std::string const &path) {
+            std::string name = path.substr(path.rfind('/') + 1);
+            if (name.size() > 3 && name.compare(name.size() - 3, 3, ".so") == 0)
+                name.resize(name.size() - 3);
+
+            return name;
+        }
+
+        /* Calls hook of the extension if defined, counting time spent. */
+        template <typename... Args>
+        static void call_hook(Loaded const &ext, char const *hook,
+                              void (*func)(Args &...), Args &... args) {
+            if (func == nullptr) return;
+
+            Profile::Owner owner(ext.name);
+            Profile::Phase phase(hook, ext.name);
+            Profile::Scope scope(Profile::site(hook));
+            (*func)(args...);
+        }
+
+        static void call_on_attach(Loaded const &ext) {
+            call_hook(ext, "extension_on_attach_ui", ext.hooks.on_attach_ui,
+                      *attached_ui);
+        }
+
+        static void call_on_detach(Loaded const &ext) {
+            call_hook(ext, "extension_on_detach_ui", ext.hooks.on_detach_ui,
+                      *attached_ui);
+        }
+
+        /* Returns path with symbolic links and relative components
+         * resolved, so that a file is known by one path however it is
+         * given. Paths without slash, which dlopen searches for, are left
+         * as they are. */
+        static std::string canonical_path(std::string const &path) {
+            if (path.find('/') == std::string::npos) return path;
+
+            char *resolved = realpath(path.c_str(), nullptr);
+            if (resolved == nullptr) return path;
+
+            std::string result(resolved);
+            std::free(resolved);
+
+            return result;
+        }
+
+        static bool is_loaded(std::string const &name,
+                              std::string const &path) {
+            for (auto itr = std::begin(handles); itr != std::end(handles);
+                 ++itr)
+                if (itr->name == name || itr->path == path) return true;
 
-        static void call_on_attach(void *handle) {
-            auto on_attach_func = (void (*)(Ked::Ui &))dlsym(handle, "extension_on_attach_ui");
-            if (on_attach_func != nullptr) (*on_attach_func)(*attached_ui);
+            return false;
         }
 
-        static void call_on_detach(void *handle) {
-            auto on_detach_func = (void (*)(Ked::Ui &))dlsym(handle, "extension_on_detach_ui");
-            if (on_detach_func != nullptr) (*on_detach_func)(*attached_ui);
+        /* Registers opened extension and calls its hooks. */
+        static void add_loaded(void *handle, std::string const &name,
+                               std::string const &path, Hooks const &hooks) {
+            /* A file opened again, say through a hard link, gives the same
+             * handle, whose hooks must not run twice. */
+            for (auto itr = std::begin(handles);
+                 handle != nullptr && itr != std::end(handles); ++itr) {
+                if (itr->handle == handle) {
+                    dlclose(handle);
+
+                    return;
+                }
+            }
+
+            handles.push_back({handle, name, path, hooks});
+            call_hook(handles.back(), "extension_on_load", hooks.on_load);
+
+            if (attached_ui != nullptr) call_on_attach(handles.back());
+        }
+
+        static Hooks find_hooks(void *handle) {
+            Hooks hooks;
+            hooks.on_load = (void (*)())dlsym(handle, "extension_on_load");
+            hooks.on_unload =
+                (void (*)())dlsym(handle, "extension_on_unload");
+            hooks.on_attach_ui =
+                (void (*)(Ui &))dlsym(handle, "extension_on_attach_ui");
+            hooks.on_detach_ui =
+                (void (*)(Ui &))dlsym(handle, "extension_on_detach_ui");
+
+            return hooks;
         }
 
         bool load(std::string const &path) {
-            void *handle = dlopen(path.c_str(), RTLD_LAZY);
+            void *handle;
+            {
+                Profile::Phase phase("dlopen", extension_name(path));
+                handle = dlopen(path.c_str(), RTLD_LAZY);
+            }
             if (handle == nullptr) return false;
-            handles.push_back(handle);
-            auto on_load_func =
-                (void (*)())dlsym(handle, "extension_on_load");
-            if (on_load_func != nullptr) (*on_load_func)();
-
-            if (attached_ui != nullptr) call_on_attach(handle);
+            add_loaded(handle, extension_name(path), canonical_path(path),
+                       find_hooks(handle));
 
             return true;
         }
 
+        void load_builtin(Builtin const &ext) {
+            add_loaded(nullptr, ext.name, "", ext.hooks);
+        }
+
+        /* Asks the kernel to start reading the file so that the loader,
+         * which takes a process-wide lock, spends less time waiting for the
+         * disk. */
+        static void prefetch(std::string const &path) {
+            int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd < 0) return;
+
+            posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+            close(fd);
+        }
+
+        /* Opens extensions of paths on loader threads, storing handles to
+         * opened, or errors to messages on failure. */
+        static void open_all(std::vector<std::string> const &paths,
+                             std::vector<void *> &opened,
+                             std::vector<std::string> &messages) {
+            for (auto itr = std::begin(paths); itr != std::end(paths); ++itr)
+                prefetch(*itr);
+
+            Profile::Phase opening("open extensions");
+            std::atomic<std::size_t> next(0);
+            auto open_next = [&]() {
+                std::size_t i;
+                while ((i = next++) < paths.size()) {
+                    Profile::Phase phase("dlopen", extension_name(paths[i]),
+                                         &opening);
+                    opened[i] = dlopen(paths[i].c_str(), RTLD_LAZY);
+                    /* dlerror is thread local. */
+                    if (opened[i] == nullptr) messages[i] = dlerror();
+                }
+            };
+
+            std::size_t n_threads =
+                std::min<std::size_t>(paths.size(), MAX_LOADER_THREADS);
+            std::vector<std::thread> loaders;
+            for (std::size_t i = 1; i < n_threads; ++i)
+                loaders.emplace_back(open_next);
+            open_next();
+            for (auto itr = std::begin(loaders); itr != std::end(loaders);
+                 ++itr)
+                itr->join();
+        }
+
+        bool load_all(std::vector<std::string> const &paths,
+                      std::vector<std::string> &errors) {
+            /* Duplicates are dropped before opening, so that loader threads
+             * don't open a file twice. */
+            std::vector<std::string> to_open;
+            std::vector<std::string> canonical;
+            for (auto itr = std::begin(paths); itr != std::end(paths); ++itr) {
+                std::string name = extension_name(*itr);
+                std::string path = canonical_path(*itr);
+                if (is_loaded(name, path)) continue;
+
+                bool given = false;
+                for (std::size_t i = 0; i < to_open.size(); ++i) {
+                    if (extension_name(to_open[i]) == name ||
+                        canonical[i] == path) {
+                        given = true;
+                        break;
+                    }
+                }
+                if (given) continue;
+
+                to_open.push_back(*itr);
+                canonical.push_back(path);
+            }
+
+            std::vector<void *> opened(to_open.size(), nullptr);
+            std::vector<std::string> messages(to_open.size());
+            open_all(to_open, opened, messages);
+
+            bool success = true;
+            for (std::size_t i = 0; i < to_open.size(); ++i) {
+                if (opened[i] == nullptr) {
+                    errors.push_back(messages[i]);
+                    success = false;
+
+                    continue;
+                }
+
+                add_loaded(opened[i], extension_name(to_open[i]), canonical[i],
+                           find_hooks(opened[i]));
+            }
+
+            return success;
+        }
+
+        /* Loads the extension unless done yet, and runs its command. */
+        static void run_autoloaded(std::size_t index, std::string name,
+                                   Ui &ui, Buffer &buf) {
+            /* Loading may declare more autoloads, so don't keep the
+             * reference. */
+            std::string path = autoloads[index].path;
+            if (!autoloads[index].loaded) {
+                autoloads[index].loaded = true;
+
+                /* Let the extension define the real ones. */
+                std::vector<std::string> const &commands =
+                    autoloads[index].commands;
+                for (auto itr = std::begin(commands);
+                     itr != std::end(commands); ++itr)
+                    ui.commands.erase(*itr);
+
+                if (!load(path)) {
+                    ui.command_failed("Cannot load " + path);
+
+                    return;
+                }
+                if (autoload_attached) autoload_attached(ui);
+            }
+
+            KeyHandling::EditorCommand const *command = ui.find_command(name);
+            if (command == nullptr) {
+                ui.command_failed(name + " is not defined by " + path);
+
+                return;
+            }
+
+            /* Copy it since the command may rebind keys. */
+            KeyHandling::EditorCommand f = *command;
+            f(ui, buf);
+        }
+
+        /* Adds commands that load the extension and then run the real
+         * ones. */
+        static void add_autoload_commands(std::size_t index) {
+            Autoload const &ext = autoloads[index];
+            /* Stubs run the commands of the extension. */
+            Profile::Owner owner(extension_name(ext.path));
+            for (auto itr = std::begin(ext.commands);
+                 itr != std::end(ext.commands); ++itr) {
+                std::string name = *itr;
+                /* The stub is replaced while running, so name is passed by
+                 * value. */
+                attached_ui->add_command(
+                    name, [index, name](Ui &ui, Buffer &buf) {
+                        run_autoloaded(index, name, ui, buf);
+                    });
+            }
+        }
+
+        void autoload(std::string const &path,
+                      std::vector<std::string> const &commands) {
+            autoloads.push_back({path, commands, false});
+
+            if (attached_ui != nullptr)
+                add_autoload_commands(autoloads.size() - 1);
+        }
+
+        void on_autoload_attached(std::function<void(Ked::Ui &)> callback) {
+            autoload_attached = callback;
+        }
+
         void unload_all() {
             for (auto itr = handles.begin(); itr != handles.end(); ++itr) {
                 call_on_detach(*itr);
 
-                auto on_unload_func =
-                    (void (*)())dlsym(*itr, "extension_on_unload");
-                if (on_unload_func != nullptr) (*on_unload_func)();
+                call_hook(*itr, "extension_on_unload", itr->hooks.on_unload);
 
-                dlclose(*itr);
+                if (itr->handle != nullptr) dlclose(itr->handle);
             }
         }
 
@@ -72,6 +337,9 @@ namespace Ked {
             for (auto itr = std::begin(handles); itr != std::end(handles); ++itr) {
                 call_on_attach(*itr);
             }
+
+            for (std::size_t i = 0; i < autoloads.size(); ++i)
+                if (!autoloads[i].loaded) add_autoload_commands(i);
         }
 
         void detach_ui(Ked::Ui *ui) {
@@ -18,15 +18,163 @@
 
 #include <map>
 #include <string>
+#include <vector>
+
+#include <ked/Face.hh>
 
 namespace Ked {
     namespace Face {
-        static std::map<std::string, std::string> face_map;
+        struct FaceEntry {
+            Attributes attrs;
+            /* Escape sequences to change to each face, indexed by its ID. */
+            std::vector<std::string> transitions;
+        };
+
+        static std::map<std::string, FaceId> face_ids;
+
+        static std::vector<FaceEntry> &faces() {
+            static std::vector<FaceEntry> entries(
+                1, FaceEntry{attributes(default_color(), default_color(), 0),
+                             std::vector<std::string>(1)});
+
+            return entries;
+        }
+
+        static bool color_equals(Color const &a, Color const &b) {
+            return a.type == b.type &&
+                   (a.type == COLOR_DEFAULT || a.value == b.value);
+        }
+
+        static void append_param(std::string &params, std::string const &p) {
+            if (!params.empty()) params += ';';
+            params += p;
+        }
+
+        static void append_color(std::string &params, Color const &color,
+                                 bool fg) {
+            std::string p = fg ? "3" : "4";
+
+            switch (color.type) {
+            case COLOR_DEFAULT:
+                p += "9";
+                break;
+            case COLOR_256:
+                p += "8;5;" + std::to_string(color.value);
+                break;
+            case COLOR_RGB:
+                p += "8;2;" + std::to_string(color.value >> 16 & 0xff) + ";" +
+                     std::to_string(color.value >> 8 & 0xff) + ";" +
+                     std::to_string(color.value & 0xff);
+                break;
+            }
 
-        void add(std::string const &name, std::string const &face) {
-            face_map[name] = face;
+            append_param(params, p);
         }
 
-        std::string &lookup(std::string const &name) { return face_map[name]; }
+        static std::string render_transition(Attributes const &from,
+                                             Attributes const &to) {
+            static unsigned int const flag_on[] = {1, 2, 3, 4, 7};
+
+            std::string params;
+            unsigned int on = to.flags & ~from.flags;
+            unsigned int off = from.flags & ~to.flags;
+
+            /* Bold and dim are turned off together. */
+            if (off & (BOLD | DIM)) {
+                append_param(params, "22");
+                on |= to.flags & (BOLD | DIM);
+            }
+            if (off & ITALIC) append_param(params, "23");
+            if (off & UNDERLINE) append_param(params, "24");
+            if (off & REVERSE) append_param(params, "27");
+            for (unsigned int i = 0; i < 5; ++i)
+                if (on & 1 << i)
+                    append_param(params, std::to_string(flag_on[i]));
+
+            if (!color_equals(from.fg, to.fg))
+                append_color(params, to.fg, true);
+            if (!color_equals(from.bg, to.bg))
+                append_color(params, to.bg, false);
+
+            if (params.empty()) return params;
+
+            return "\e[" + params + "m";
+        }
+
+        static void render_transitions(FaceId id) {
+            std::vector<FaceEntry> &entries = faces();
+
+            for (FaceId i = 0; i < entries.size(); ++i)
+                entries[i].transitions.resize(entries.size());
+
+            for (FaceId i = 0; i < entries.size(); ++i) {
+                entries[i].transitions[id] =
+                    render_transition(entries[i].attrs, entries[id].attrs);
+                entries[id].transitions[i] =
+                    render_transition(entries[id].attrs, entries[i].attrs);
+            }
+        }
+
+        Color default_color() { return Color{COLOR_DEFAULT, 0}; }
+
+        Color color_256(unsigned char index) { return Color{COLOR_256, index}; }
+
+        Color color_rgb(std::uint32_t rgb) {
+            return Color{COLOR_RGB, rgb & 0xffffff};
+        }
+
+        unsigned int flag_from_sgr(unsigned int code) {
+            switch (code) {
+            case 1:
+                return BOLD;
+            case 2:
+                return DIM;
+            case 3:
+                return ITALIC;
+            case 4:
+                return UNDERLINE;
+            case 7:
+                return REVERSE;
+            default:
+                return 0;
+            }
+        }
+
+        Attributes attributes(Color fg, Color bg, unsigned int flags) {
+            return Attributes{fg, bg, flags};
+        }
+
+        FaceId add(std::string const &name, Attributes const &attrs) {
+            FaceId face = id(name);
+
+            faces()[face].attrs = attrs;
+            render_transitions(face);
+
+            return face;
+        }
+
+        FaceId id(std::string const &name) {
+            /* Empty name is the face with no attributes. */
+            if (name.empty()) return FACE_ID_DEFAULT;
+
+            auto found = face_ids.find(name);
+            if (found != std::end(face_ids)) return found->second;
+
+            std::vector<FaceEntry> &entries = faces();
+            FaceId face = entries.size();
+            entries.push_back(
+                FaceEntry{attributes(default_color(), default_color(), 0),
+                          std::vector<std::string>()});
+            face_ids[name] = face;
+            render_transitions(face);
+
+            return face;
+        }
+
+        Attributes const &get(FaceId id) { return faces()[id].attrs; }
+
+        std::string const &transition(FaceId from, FaceId to) {
+            return faces()[from].transitions[to];
+        }
     } // namespace Face
 } // namespace Ked
@@ -0,0 +1,203 @@
+/*
+ * ked -- simple text editor with minimal dependency
+ * Copyright (C) 2019  Koki Fukuda
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <iterator>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <ked/Buffer.hh>
+#include <ked/Highlight.hh>
+
+namespace Ked {
+    namespace Highlight {
+        static std::map<std::string, Lexer> &grammars() {
+            static std::map<std::string, Lexer> result;
+
+            return result;
+        }
+
+        void add_grammar(std::string const &name, Lexer lexer) {
+            grammars()[name] = lexer;
+        }
+
+        Lexer const *grammar(std::string const &name) {
+            auto found = grammars().find(name);
+            if (found == std::end(grammars())) return nullptr;
+
+            return &found->second;
+        }
+
+        Highlighter::Highlighter(Lexer lexer)
+            : lexer(lexer), complete(false), dirty(false), first_dirty(0),
+              dirty_until(0), shift_from(1), shift_delta(0) {
+            lines.push_back({0, 0});
+        }
+
+        std::size_t Highlighter::line_start(std::size_t k) const {
+            return lines[k].start + (k >= shift_from ? shift_delta : 0);
+        }
+
+        void Highlighter::move_shift(std::size_t k) {
+            for (; shift_from < k; ++shift_from)
+                lines[shift_from].start += shift_delta;
+            for (; shift_from > k; --shift_from)
+                lines[shift_from - 1].start -= shift_delta;
+        }
+
+        std::size_t Highlighter::line_index(std::size_t pos) const {
+            /* The first line starts at 0, so the result is in lines. */
+            std::size_t low = 1;
+            std::size_t high = lines.size();
+            while (low < high) {
+                std::size_t mid = low + (high - low) / 2;
+                if (pos < line_start(mid))
+                    high = mid;
+                else
+                    low = mid + 1;
+            }
+
+            return low - 1;
+        }
+
+        bool Highlighter::lex_line(Buffer &buf, std::size_t k) {
+            std::size_t len = buf.buf_size - (buf.gap_end - buf.gap_start);
+            /* Lines up to this one get their own start, so that ones after
+             * it can be inserted or dropped with the shift kept. */
+            move_shift(k + 1);
+            std::size_t start = lines[k].start;
+            std::size_t end = start;
+            while (end < len && !buf.get_rune(end).is_lf()) ++end;
+
+            old_faces.clear();
+            for (std::size_t i = start; i < end; ++i)
+                old_faces.push_back(buf.get_rune(i).face);
+
+            State state = lexer(buf, start, end, lines[k].state);
+
+            /* Windows are redrawn only if the lexer changed the faces. */
+            for (std::size_t i = start; i < end; ++i) {
+                if (buf.get_rune(i).face != old_faces[i - start]) {
+                    ++buf.paint_version;
+                    break;
+                }
+            }
+
+            if (end == len) {
+                /* Checkpoints left after the last line are stale. */
+                lines.resize(k + 1);
+                complete = true;
+
+                return true;
+            }
+
+            std::size_t next = end + 1;
+            /* Stale checkpoints in this line are dropped; only the new line
+             * start is kept. */
+            std::size_t i = k + 1;
+            while (i < lines.size() && line_start(i) < next) ++i;
+            lines.erase(std::begin(lines) + k + 1, std::begin(lines) + i);
+
+            if (k + 1 == lines.size()) {
+                lines.push_back({next - shift_delta, state});
+                complete = false;
+
+                /* Everything known is lexed now. */
+                return true;
+            }
+
+            if (line_start(k + 1) != next) {
+                lines.insert(std::begin(lines) + k + 1,
+                             {next - shift_delta, state});
+
+                return false;
+            }
+
+            bool same = lines[k + 1].state == state;
+            lines[k + 1].state = state;
+
+            return same && next > dirty_until;
+        }
+
+        void Highlighter::text_changed(TextChangedEvent const &ev) {
+            long delta = (long)ev.end - (long)ev.old_end;
+            /* Maps position before the change to the one after. */
+            auto map = [&ev, delta](std::size_t pos) -> std::size_t {
+                if (pos >= ev.old_end) return pos + delta;
+                if (pos > ev.start) return ev.end;
+
+                return pos;
+            };
+
+            std::size_t until = ev.end;
+            if (dirty) {
+                /* The line waiting to be lexed has new state, so the state
+                 * must not be taken as converged until it is lexed. */
+                until = std::max(until, map(dirty_until));
+                until = std::max(until, map(line_start(first_dirty)));
+            }
+
+            /* Line starts in the old text of the range may be gone. */
+            std::size_t k = line_index(ev.start);
+            move_shift(k + 1);
+            std::size_t last = k + 1;
+            while (last < lines.size() && line_start(last) <= ev.old_end)
+                ++last;
+            lines.erase(std::begin(lines) + k + 1, std::begin(lines) + last);
+            /* Lines after k are shifted all at once. */
+            shift_delta += delta;
+
+            first_dirty = dirty ? std::min(first_dirty, k) : k;
+            dirty_until = until;
+            dirty = true;
+        }
+
+        bool Highlighter::update(Buffer &buf, std::size_t pos,
+                                 std::size_t n_lines, std::size_t budget) {
+            /* Lines past the target are left until they get visible. */
+            auto reached = [this, pos, n_lines](std::size_t k) {
+                return line_start(k) > pos && k >= line_index(pos) + n_lines;
+            };
+
+            while (dirty) {
+                if (reached(first_dirty)) return true;
+
+                if (budget == 0) return false;
+                --budget;
+
+                if (lex_line(buf, first_dirty))
+                    dirty = false;
+                else
+                    ++first_dirty;
+            }
+
+            while (!complete) {
+                std::size_t last = lines.size() - 1;
+                if (reached(last)) break;
+
+                if (budget == 0) return false;
+                --budget;
+
+                lex_line(buf, last);
+            }
+
+            return true;
+        }
+    } // namespace Highlight
+} // namespace Ked
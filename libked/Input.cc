@@ -0,0 +1,185 @@
+/*
+ * ked -- simple text editor with minimal dependency
+ * Copyright (C) 2019  Koki Fukuda
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <ked/Input.hh>
+#include <ked/Rune.hh>
+
+namespace Ked {
+    /* Markers that the terminal sends around pasted text if bracketed paste
+     * mode is enabled. */
+    static char const paste_start[] = "\e[200~";
+    static char const paste_end[] = "\e[201~";
+    static std::size_t const marker_size = sizeof(paste_start) - 1;
+
+    InputParser::InputParser()
+        : utf8_len(0), utf8_need(0), marker_len(0), in_paste(false) {
+        utf8_buf.fill(0);
+    }
+
+    void InputParser::push_key(unsigned char c, std::vector<InputEvent> &out) {
+        InputEvent ev;
+        ev.type = InputEvent::KEY;
+        ev.key = c;
+        ev.rune.fill(0);
+        out.push_back(ev);
+    }
+
+    void InputParser::feed_paste(unsigned char c,
+                                 std::vector<InputEvent> &out) {
+        if (c == (unsigned char)paste_end[marker_len]) {
+            ++marker_len;
+
+            if (marker_len == marker_size) {
+                InputEvent ev;
+                ev.type = InputEvent::PASTE;
+                ev.key = 0;
+                ev.rune.fill(0);
+                ev.text.swap(paste_text);
+                out.push_back(std::move(ev));
+
+                paste_text.clear();
+                marker_len = 0;
+                in_paste = false;
+            }
+
+            return;
+        }
+
+        /* Only ESC can start the marker, so the matched part is just a
+         * text. */
+        paste_text.append(paste_end, marker_len);
+        marker_len = 0;
+
+        if (c == (unsigned char)paste_end[0])
+            marker_len = 1;
+        else
+            paste_text.push_back(c);
+    }
+
+    void InputParser::feed_char(unsigned char c, std::vector<InputEvent> &out) {
+        if (utf8_need != 0) {
+            if ((c >> 6 & 0x3) == 0x2) {
+                utf8_buf[utf8_len++] = c;
+
+                if (utf8_len == utf8_need) {
+                    InputEvent ev;
+                    ev.type = InputEvent::RUNE;
+                    ev.key = 0;
+                    ev.rune = utf8_buf;
+                    out.push_back(ev);
+
+                    utf8_buf.fill(0);
+                    utf8_len = 0;
+                    utf8_need = 0;
+                }
+
+                return;
+            }
+
+            /* Broken sequence; drop it and treat this byte as a new one. */
+            utf8_buf.fill(0);
+            utf8_len = 0;
+            utf8_need = 0;
+        }
+
+        unsigned int n_byte;
+        if ((c >> 7 & 0x1) == 0)
+            n_byte = 1;
+        else if ((c >> 5 & 0x7) == 0x6)
+            n_byte = 2;
+        else if ((c >> 4 & 0xf) == 0xe)
+            n_byte = 3;
+        else if ((c >> 3 & 0x1f) == 0x1e)
+            n_byte = 4;
+        else
+            n_byte = 0;
+
+        if (n_byte == 1) {
+            push_key(c, out);
+        } else if (n_byte != 0) {
+            utf8_buf[0] = c;
+            utf8_len = 1;
+            utf8_need = n_byte;
+        }
+    }
+
+    void InputParser::feed(char const *buf, std::size_t len,
+                           std::vector<InputEvent> &out) {
+        for (std::size_t i = 0; i < len; ++i) {
+            unsigned char c = (unsigned char)buf[i];
+
+            if (in_paste) {
+                /* Most of pasted text contains no ESC, so copy the run at
+                 * once. */
+                if (marker_len == 0) {
+                    char const *esc = (char const *)std::memchr(
+                        buf + i, paste_end[0], len - i);
+                    std::size_t run =
+                        esc == nullptr ? len - i : esc - (buf + i);
+                    paste_text.append(buf + i, run);
+                    i += run;
+                    if (i >= len) break;
+                    c = (unsigned char)buf[i];
+                }
+
+                feed_paste(c, out);
+
+                continue;
+            }
+
+            if (utf8_need == 0 &&
+                c == (unsigned char)paste_start[marker_len]) {
+                ++marker_len;
+
+                if (marker_len == marker_size) {
+                    marker_len = 0;
+                    in_paste = true;
+                }
+
+                continue;
+            }
+
+            /* Held bytes are not a paste marker; they are keys. */
+            flush(out);
+
+            if (utf8_need == 0 && c == (unsigned char)paste_start[0]) {
+                marker_len = 1;
+
+                continue;
+            }
+
+            feed_char(c, out);
+        }
+    }
+
+    bool InputParser::pending() const { return !in_paste && marker_len != 0; }
+
+    void InputParser::flush(std::vector<InputEvent> &out) {
+        if (in_paste) return;
+
+        for (std::size_t i = 0; i < marker_len; ++i)
+            push_key(paste_start[i], out);
+        marker_len = 0;
+    }
+} // namespace Ked
@@ -0,0 +1,240 @@
+/*
+ * ked -- simple text editor with minimal dependency
+ * Copyright (C) 2019  Koki Fukuda
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <pthread.h>
+#include <signal.h>
+
+#include <ked/Buffer.hh>
+#include <ked/EventLoop.hh>
+#include <ked/Face.hh>
+#include <ked/Job.hh>
+
+namespace Ked {
+    std::string BufferSnapshot::text() const {
+        std::string result;
+        result.reserve(content.size());
+        for (auto itr = std::begin(content); itr != std::end(content);
+             ++itr) {
+            for (int i = 0; i < 4 && (i == 0 || itr->c[i] != 0); ++i)
+                result.push_back(itr->c[i]);
+        }
+
+        return result;
+    }
+
+    Job::Job(Buffer *buf, unsigned long version, JobWork work)
+        : buf(buf), version(version), cancel_requested(false), work(work) {}
+
+    bool Job::cancelled() const { return cancel_requested.load(); }
+
+    void Job::cancel() { cancel_requested.store(true); }
+
+    JobPool::JobPool(EventLoop &loop) : loop(loop), stopping(false) {}
+
+    JobPool::~JobPool() {
+        {
+            std::lock_guard<std::mutex> lock(queue_mutex);
+            stopping = true;
+            for (auto itr = std::begin(queue); itr != std::end(queue); ++itr)
+                itr->job->cancel();
+        }
+        queue_cond.notify_all();
+
+        for (auto itr = std::begin(workers); itr != std::end(workers); ++itr)
+            itr->join();
+    }
+
+    void JobPool::start_workers() {
+        unsigned int n = std::thread::hardware_concurrency();
+        /* Leave a core for the loop thread. */
+        n = n > 1 ? n - 1 : 1;
+        if (n > MAX_JOB_WORKERS) n = MAX_JOB_WORKERS;
+
+        for (unsigned int i = 0; i < n; ++i)
+            workers.emplace_back(&JobPool::run_worker, this);
+    }
+
+    void JobPool::run_worker() {
+        /* Signals are for signalfd of the loop. */
+        sigset_t set;
+        sigfillset(&set);
+        pthread_sigmask(SIG_BLOCK, &set, nullptr);
+
+        for (;;) {
+            Task task;
+            {
+                std::unique_lock<std::mutex> lock(queue_mutex);
+                queue_cond.wait(
+                    lock, [this]() { return stopping || !queue.empty(); });
+                if (stopping) return;
+
+                task = std::move(queue.front());
+                queue.pop_front();
+            }
+
+            std::function<void()> done;
+            if (!task.job->cancelled() &&
+                take_snapshot(*task.snapshot, *task.job))
+                done = task.job->work(task.snapshot->snapshot, *task.job);
+
+            std::shared_ptr<Job> job = task.job;
+            loop.post([this, job, done]() { finish(job, done); });
+        }
+    }
+
+    bool JobPool::take_snapshot(PendingSnapshot &pending, Job const &job) {
+        if (pending.buf == nullptr) return true;
+
+        std::lock_guard<std::mutex> lock(pending.mutex);
+        std::vector<AttrRune> &content = pending.snapshot.content;
+        /* A job cancelled in the middle leaves the rest to another one. */
+        while (!pending.copied) {
+            std::unique_lock<std::mutex> buf_lock;
+            {
+                std::lock_guard<std::mutex> copy_lock(copy_mutex);
+                /* The buffer may be deleted once its jobs are cancelled. */
+                if (job.cancelled()) return false;
+                buf_lock =
+                    std::unique_lock<std::mutex>(pending.buf->content_mutex);
+            }
+
+            /* The result of changed text is dropped in finish(), so copying
+             * it is not worth going on. */
+            Buffer const &buf = *pending.buf;
+            if (buf.version != pending.snapshot.version) return false;
+
+            /* The lock is released after each chunk so that an edit waits
+             * for a chunk at most. */
+            std::size_t gap = buf.gap_end - buf.gap_start;
+            std::size_t len = buf.buf_size - gap;
+            std::size_t end =
+                std::min(len, content.size() + SNAPSHOT_CHUNK_SIZE);
+            content.reserve(len);
+            for (std::size_t i = content.size(); i < end; ++i) {
+                AttrRune const &src =
+                    buf.content[i < buf.gap_start ? i : i + gap];
+                /* Faces are written by the loop thread without the lock. */
+                AttrRune r;
+                r.c = src.c;
+                r.display_width = src.display_width;
+                r.attrs = src.attrs;
+                r.face = FACE_ID_DEFAULT;
+                content.push_back(r);
+            }
+            pending.copied = end == len;
+        }
+
+        return true;
+    }
+
+    void JobPool::finish(std::shared_ptr<Job> job, std::function<void()> done) {
+        active.erase(std::remove(std::begin(active), std::end(active), job),
+                     std::end(active));
+
+        if (job->buf == nullptr) {
+            if (!job->cancelled() && done) done();
+
+            return;
+        }
+
+        bool buf_active = false;
+        for (auto itr = std::begin(active); itr != std::end(active); ++itr) {
+            if ((*itr)->buf == job->buf) {
+                buf_active = true;
+                break;
+            }
+        }
+        if (!buf_active) snapshots.erase(job->buf);
+
+        /* Buffer may be changed after the result is posted. */
+        if (job->cancelled() || job->buf->version != job->version) return;
+
+        if (done) done();
+    }
+
+    std::shared_ptr<Job> JobPool::submit(Buffer &buf, JobWork work) {
+        std::shared_ptr<PendingSnapshot> &snapshot = snapshots[&buf];
+        if (!snapshot || snapshot->snapshot.version != buf.version) {
+            snapshot = std::make_shared<PendingSnapshot>();
+            snapshot->buf = &buf;
+            snapshot->copied = false;
+            snapshot->snapshot.path = buf.path;
+            snapshot->snapshot.version = buf.version;
+        }
+
+        std::shared_ptr<Job> job =
+            std::make_shared<Job>(&buf, buf.version, work);
+        enqueue(job, snapshot);
+
+        return job;
+    }
+
+    std::shared_ptr<Job> JobPool::submit(JobWork work) {
+        static std::shared_ptr<PendingSnapshot> const empty = []() {
+            std::shared_ptr<PendingSnapshot> s =
+                std::make_shared<PendingSnapshot>();
+            s->buf = nullptr;
+            s->copied = true;
+            s->snapshot.version = 0;
+
+            return s;
+        }();
+
+        std::shared_ptr<Job> job = std::make_shared<Job>(nullptr, 0, work);
+        enqueue(job, empty);
+
+        return job;
+    }
+
+    void JobPool::enqueue(std::shared_ptr<Job> job,
+                          std::shared_ptr<PendingSnapshot> snapshot) {
+        active.push_back(job);
+
+        if (workers.empty()) start_workers();
+
+        {
+            std::lock_guard<std::mutex> lock(queue_mutex);
+            queue.push_back({job, snapshot});
+        }
+        queue_cond.notify_one();
+    }
+
+    void JobPool::cancel(Buffer *buf) {
+        for (auto itr = std::begin(active); itr != std::end(active); ++itr) {
+            if ((*itr)->buf == buf) (*itr)->cancel();
+        }
+
+        snapshots.erase(buf);
+
+        /* A worker which has seen its job alive has locked the buffer by
+         * now, which delays deleting the buffer until it is copied. */
+        std::lock_guard<std::mutex> lock(copy_mutex);
+    }
+} // namespace Ked
@@ -0,0 +1,236 @@
+/*
+ * ked -- simple text editor with minimal dependency
+ * Copyright (C) 2019  Koki Fukuda
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <ked/Buffer.hh>
+#include <ked/Journal.hh>
+
+namespace Ked {
+    namespace {
+        /* Header of journal, which is followed by records. Each record is
+         * varints of pos, removed runes and length of text, the text, and
+         * checksum of them all. */
+        struct JournalHeader {
+            char magic[8];
+            /* Size and modification time of the file edits apply to. */
+            std::uint64_t file_size;
+            std::int64_t mtime_sec;
+            std::int64_t mtime_nsec;
+        };
+    } // namespace
+
+    static char const journal_magic[8] = {'K', 'E', 'D', 'J',
+                                          'R', 'N', '0', '1'};
+
+    static void put_varint(std::string &out, std::uint64_t n) {
+        while (n >= 0x80) {
+            out += (char)(n | 0x80);
+            n >>= 7;
+        }
+        out += (char)n;
+    }
+
+    static bool get_varint(char const *&p, char const *end, std::uint64_t *n) {
+        *n = 0;
+        for (unsigned int shift = 0; p < end && shift < 64; shift += 7) {
+            unsigned char c = *p++;
+            *n |= (std::uint64_t)(c & 0x7f) << shift;
+            if ((c & 0x80) == 0) return true;
+        }
+
+        return false;
+    }
+
+    /* FNV-1a hash of the record. */
+    static std::uint32_t checksum(char const *p, std::size_t len) {
+        std::uint32_t hash = 0x811c9dc5;
+        for (std::size_t i = 0; i < len; ++i) {
+            hash ^= (unsigned char)p[i];
+            hash *= 0x01000193;
+        }
+
+        return hash;
+    }
+
+    Journal::Journal(int fd, std::string const &path) : fd(fd), path(path) {}
+
+    Journal::~Journal() {
+        flush();
+        close(fd);
+    }
+
+    Journal *Journal::open(std::string const &path) {
+        for (;;) {
+            int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+            if (fd < 0) return nullptr;
+
+            if (flock(fd, LOCK_EX | LOCK_NB) != 0) {
+                int err = errno;
+                close(fd);
+                errno = err;
+
+                return nullptr;
+            }
+
+            /* The session which had it locked may have deleted it before
+             * exiting, in which case the one now at path is opened again. */
+            struct stat locked;
+            struct stat current;
+            if (fstat(fd, &locked) == 0 && stat(path.c_str(), &current) == 0 &&
+                locked.st_dev == current.st_dev &&
+                locked.st_ino == current.st_ino)
+                return new Journal(fd, path);
+
+            close(fd);
+        }
+    }
+
+    std::vector<JournalRecord> Journal::read(struct timespec const &mtime,
+                                             std::size_t file_size,
+                                             std::size_t *end) const {
+        std::vector<JournalRecord> records;
+        if (end != nullptr) *end = 0;
+
+        std::string data;
+        char chunk[65536];
+        for (;;) {
+            ssize_t n = pread(fd, chunk, sizeof(chunk), data.size());
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) break;
+            data.append(chunk, n);
+        }
+
+        JournalHeader header;
+        if (data.size() < sizeof(header)) return records;
+        std::memcpy(&header, data.data(), sizeof(header));
+        if (std::memcmp(header.magic, journal_magic, sizeof(journal_magic)) !=
+                0 ||
+            header.file_size != file_size || header.mtime_sec != mtime.tv_sec ||
+            header.mtime_nsec != mtime.tv_nsec)
+            return records;
+
+        char const *p = data.data() + sizeof(header);
+        char const *data_end = data.data() + data.size();
+        while (p < data_end) {
+            char const *start = p;
+            std::uint64_t pos;
+            std::uint64_t removed;
+            std::uint64_t len;
+            std::uint32_t sum;
+            if (!get_varint(p, data_end, &pos) ||
+                !get_varint(p, data_end, &removed) ||
+                !get_varint(p, data_end, &len) ||
+                (std::uint64_t)(data_end - p) < len + sizeof(sum))
+                break;
+
+            std::memcpy(&sum, p + len, sizeof(sum));
+            if (sum != checksum(start, p + len - start)) break;
+
+            records.push_back({pos, removed, std::string(p, len)});
+            p += len + sizeof(sum);
+            if (end != nullptr) *end = p - data.data();
+        }
+
+        return records;
+    }
+
+    void Journal::record(Buffer const &buf, std::size_t pos,
+                         std::size_t removed, std::size_t inserted) {
+        std::string text;
+        for (std::size_t i = pos; i < pos + inserted; ++i) {
+            AttrRune const &r = buf.get_rune(i);
+            text += r.c[0];
+            for (std::size_t j = 1; j < r.c.size(); ++j) {
+                if ((r.c[j] >> 6 & 0x3) != 0x2) break;
+                text += r.c[j];
+            }
+        }
+
+        std::size_t start = pending.size();
+        put_varint(pending, pos);
+        put_varint(pending, removed);
+        put_varint(pending, text.size());
+        pending += text;
+
+        std::uint32_t sum =
+            checksum(pending.data() + start, pending.size() - start);
+        pending.append((char const *)&sum, sizeof(sum));
+
+        if (pending.size() >= JOURNAL_FLUSH_SIZE) flush();
+    }
+
+    bool Journal::dirty() const { return !pending.empty(); }
+
+    bool Journal::flush() {
+        if (pending.empty()) return true;
+
+        std::size_t off = 0;
+        while (off < pending.size()) {
+            ssize_t n = write(fd, pending.data() + off, pending.size() - off);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                break;
+            }
+            off += n;
+        }
+
+        bool success = off == pending.size() && fdatasync(fd) == 0;
+        pending.clear();
+
+        return success;
+    }
+
+    bool Journal::reset(Buffer const &buf) {
+        pending.clear();
+
+        JournalHeader header;
+        std::memset(&header, 0, sizeof(header));
+        std::memcpy(header.magic, journal_magic, sizeof(journal_magic));
+        header.file_size = buf.file_size;
+        header.mtime_sec = buf.file_mtime.tv_sec;
+        header.mtime_nsec = buf.file_mtime.tv_nsec;
+
+        /* The header is synced with the first records, as a journal
+         * without them has nothing to recover anyway. */
+        return ftruncate(fd, 0) == 0 && lseek(fd, 0, SEEK_SET) == 0 &&
+               write(fd, &header, sizeof(header)) == sizeof(header);
+    }
+
+    bool Journal::truncate(std::size_t end) {
+        pending.clear();
+
+        return ftruncate(fd, end) == 0 &&
+               lseek(fd, end, SEEK_SET) == (off_t)end;
+    }
+
+    void Journal::remove() {
+        pending.clear();
+        unlink(path.c_str());
+    }
+} // namespace Ked
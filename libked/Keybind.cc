@@ -0,0 +1,161 @@
+/*
+ * ked -- simple text editor with minimal dependency
+ * Copyright (C) 2019  Koki Fukuda
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <iterator>
+#include <string>
+
+#include <ked/Keybind.hh>
+#include <ked/Profile.hh>
+
+namespace Ked {
+    namespace KeyHandling {
+        static unsigned long current_keymap_version;
+
+        unsigned long keymap_version() { return current_keymap_version; }
+
+        void keymap_changed() { ++current_keymap_version; }
+
+        Keybind::Keybind() : states(1) {
+            states[0].next.fill(0);
+            states[0].site = nullptr;
+        }
+
+        std::string Keybind::compile_key(std::string const &key) {
+            std::string result;
+            for (auto itr = std::begin(key); itr != std::end(key); ++itr) {
+                if (*itr == '^' && itr != std::end(key) - 1) {
+                    result.push_back(*(++itr) - '@');
+                } else {
+                    result.push_back(*itr);
+                }
+            }
+
+            return result;
+        }
+
+        void Keybind::add(std::string const &key, EditorCommand func) {
+            std::string seq = compile_key(key);
+
+            unsigned int state = 0;
+            for (auto itr = std::begin(seq); itr != std::end(seq); ++itr) {
+                unsigned char c = *itr;
+                if (states[state].next[c] == 0) {
+                    states[state].next[c] = states.size();
+                    states.emplace_back();
+                    states.back().next.fill(0);
+                    states.back().site = nullptr;
+                }
+                state = states[state].next[c];
+            }
+
+            states[state].func = func;
+            states[state].site = Profile::site(key);
+
+            keymap_changed();
+        }
+
+        void Keybind::merge_state(unsigned int state, Keybind const &other,
+                                  unsigned int other_state) {
+            State const &from = other.states[other_state];
+            if (from.func) {
+                states[state].func = from.func;
+                states[state].site = from.site;
+            }
+
+            for (unsigned int c = 0; c < 256; ++c) {
+                if (from.next[c] == 0) continue;
+
+                /* Longer sequence of other hides the command bound to its
+                 * prefix, which would otherwise run before the rest is
+                 * typed. */
+                if (!from.func) {
+                    states[state].func = nullptr;
+                    states[state].site = nullptr;
+                }
+
+                if (states[state].next[c] == 0) {
+                    /* Reference to states may be invalidated here. */
+                    unsigned int created = states.size();
+                    states.emplace_back();
+                    states.back().next.fill(0);
+                    states.back().site = nullptr;
+                    states[state].next[c] = created;
+                }
+                merge_state(states[state].next[c], other, from.next[c]);
+            }
+        }
+
+        void Keybind::merge(Keybind const &other) {
+            merge_state(0, other, 0);
+
+            keymap_changed();
+        }
+
+        void Keybind::clear() {
+            states.resize(1);
+            states[0].next.fill(0);
+            states[0].func = nullptr;
+            states[0].site = nullptr;
+
+            keymap_changed();
+        }
+
+        bool Keybind::empty() const {
+            return states.size() == 1 && !states[0].func;
+        }
+
+        unsigned int Keybind::advance(unsigned int state,
+                                      unsigned char c) const {
+            return states[state].next[c];
+        }
+
+        EditorCommand const *Keybind::command(unsigned int state) const {
+            if (!states[state].func) return nullptr;
+
+            return &states[state].func;
+        }
+
+        KeyBindState Keybind::handle(unsigned int &state, unsigned char c,
+                                     Ui &ui, Buffer &buf) {
+            unsigned int next = advance(state, c);
+            if (next == 0) {
+                bool first = state == 0;
+                state = 0;
+
+                /* Unknown sequence is dropped, but single key is left for
+                 * the caller. */
+                return first ? KEYBIND_NOT_HANDLED : KEYBIND_HANDLED;
+            }
+
+            EditorCommand const *func = command(next);
+            if (func == nullptr) {
+                state = next;
+
+                return KEYBIND_WAIT;
+            }
+
+            state = 0;
+            /* Copy it since the command may rebind keys. */
+            EditorCommand f = *func;
+            Profile::Scope scope(states[next].site);
+            f(ui, buf);
+
+            return KEYBIND_HANDLED;
+        }
+    } // namespace KeyHandling
+} // namespace Ked
@@ -0,0 +1,245 @@
+/*
+ * ked -- simple text editor with minimal dependency
+ * Copyright (C) 2019  Koki Fukuda
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <iterator>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <time.h>
+
+#include <ked/Profile.hh>
+
+namespace Ked {
+    namespace Profile {
+        struct PhaseRecord {
+            std::string name;
+            unsigned int depth;
+            std::uint64_t start_ns;
+            std::uint64_t end_ns;
+        };
+
+        static bool profile_enabled = false;
+        static std::string owner = "ked";
+
+        static std::map<std::pair<std::string, std::string>, Site> &sites() {
+            static std::map<std::pair<std::string, std::string>, Site> result;
+
+            return result;
+        }
+
+        bool enabled() { return profile_enabled; }
+
+        void set_enabled(bool enable) { profile_enabled = enable; }
+
+        Site *site(std::string const &name) {
+            auto key = std::make_pair(owner, name);
+            auto found = sites().find(key);
+            if (found != std::end(sites())) return &found->second;
+
+            Site &s = sites()[key];
+            s.owner = owner;
+            s.name = name;
+            s.count = 0;
+            s.total_ns = 0;
+            s.max_ns = 0;
+            s.samples.fill(0);
+            s.next_sample = 0;
+
+            return &s;
+        }
+
+        std::string const &current_owner() { return owner; }
+
+        Owner::Owner(std::string const &name) : prev(owner) { owner = name; }
+
+        Owner::~Owner() { owner = prev; }
+
+        Scope::Scope(Site *site) : site(profile_enabled ? site : nullptr) {
+            if (this->site != nullptr) clock_gettime(CLOCK_MONOTONIC, &start);
+        }
+
+        Scope::~Scope() {
+            if (site == nullptr) return;
+
+            struct timespec end;
+            clock_gettime(CLOCK_MONOTONIC, &end);
+            std::uint64_t ns = (end.tv_sec - start.tv_sec) * 1000000000ULL +
+                               end.tv_nsec - start.tv_nsec;
+
+            ++site->count;
+            site->total_ns += ns;
+            site->max_ns = std::max(site->max_ns, ns);
+            site->samples[site->next_sample] =
+                ns > UINT32_MAX ? UINT32_MAX : (std::uint32_t)ns;
+            site->next_sample = (site->next_sample + 1) % PROFILE_SAMPLES;
+        }
+
+        /* Returns duration at ratio among sorted samples. */
+        static double percentile(std::vector<std::uint32_t> const &sorted,
+                                 double ratio) {
+            if (sorted.empty()) return 0;
+
+            return sorted[(std::size_t)(ratio * (sorted.size() - 1) + 0.5)];
+        }
+
+        static std::uint64_t now_ns() {
+            struct timespec t;
+            clock_gettime(CLOCK_MONOTONIC, &t);
+
+            return t.tv_sec * 1000000000ULL + t.tv_nsec;
+        }
+
+        static std::atomic<bool> startup_tracing(false);
+        static std::uint64_t startup_origin;
+        static std::uint64_t first_paint_ns;
+        /* Phases are recorded by extension loaders too. */
+        static std::mutex phases_mutex;
+        static std::vector<PhaseRecord> phases;
+        /* Number of phases alive on the thread. */
+        static thread_local unsigned int phase_depth;
+
+        void start_startup_trace() {
+            startup_origin = now_ns();
+            first_paint_ns = 0;
+            startup_tracing = true;
+        }
+
+        bool tracing_startup() { return startup_tracing; }
+
+        void startup_painted() {
+            if (!startup_tracing) return;
+
+            first_paint_ns = now_ns() - startup_origin;
+            startup_tracing = false;
+        }
+
+        Phase::Phase(char const *name, std::string const &subject,
+                     Phase const *parent)
+            : record(-1), depth(0), innermost(parent == nullptr) {
+            if (!startup_tracing) return;
+
+            depth = innermost ? phase_depth++ : parent->depth + 1;
+
+            std::string full = name;
+            if (!subject.empty()) full += " " + subject;
+
+            std::lock_guard<std::mutex> lock(phases_mutex);
+            record = phases.size();
+            phases.push_back(
+                PhaseRecord{full, depth, now_ns() - startup_origin, 0});
+        }
+
+        Phase::~Phase() {
+            if (record < 0) return;
+
+            std::uint64_t end = now_ns() - startup_origin;
+            {
+                std::lock_guard<std::mutex> lock(phases_mutex);
+                phases[record].end_ns = end;
+            }
+            if (innermost) phase_depth = depth;
+        }
+
+        std::string startup_report() {
+            std::lock_guard<std::mutex> lock(phases_mutex);
+
+            std::vector<PhaseRecord> sorted = phases;
+            std::stable_sort(std::begin(sorted), std::end(sorted),
+                             [](PhaseRecord const &a, PhaseRecord const &b) {
+                                 return a.start_ns < b.start_ns;
+                             });
+
+            std::string result;
+            char line[256];
+            if (first_paint_ns != 0)
+                std::snprintf(line, sizeof(line),
+                              "time to first paint: %.3f ms\n\n",
+                              first_paint_ns / 1e6);
+            else
+                std::snprintf(line, sizeof(line),
+                              "time to first paint: not painted\n\n");
+            result += line;
+
+            std::snprintf(line, sizeof(line), "%10s %10s  %s\n",
+                          "start ms", "time ms", "phase");
+            result += line;
+
+            for (auto itr = std::begin(sorted); itr != std::end(sorted);
+                 ++itr) {
+                std::string name =
+                    std::string(itr->depth * 2, ' ') + itr->name;
+                /* Phase still running has no end yet. */
+                std::uint64_t end = std::max(itr->end_ns, itr->start_ns);
+                std::snprintf(line, sizeof(line), "%10.3f %10.3f  %s\n",
+                              itr->start_ns / 1e6,
+                              (end - itr->start_ns) / 1e6, name.c_str());
+                result += line;
+            }
+
+            return result;
+        }
+
+        std::string report() {
+            std::vector<Site const *> list;
+            for (auto itr = std::begin(sites()); itr != std::end(sites());
+                 ++itr) {
+                if (itr->second.count != 0) list.push_back(&itr->second);
+            }
+            std::sort(std::begin(list), std::end(list),
+                      [](Site const *a, Site const *b) {
+                          return a->total_ns > b->total_ns;
+                      });
+
+            std::string result;
+            char line[256];
+            std::snprintf(line, sizeof(line),
+                          "%-12s %-24s %8s %10s %9s %9s %9s\n", "extension",
+                          "name", "count", "total ms", "p50 us", "p99 us",
+                          "max us");
+            result += line;
+
+            for (auto itr = std::begin(list); itr != std::end(list); ++itr) {
+                Site const &s = **itr;
+
+                std::size_t n =
+                    std::min<unsigned long>(s.count, PROFILE_SAMPLES);
+                std::vector<std::uint32_t> sorted(std::begin(s.samples),
+                                                  std::begin(s.samples) + n);
+                std::sort(std::begin(sorted), std::end(sorted));
+
+                std::snprintf(line, sizeof(line),
+                              "%-12s %-24s %8lu %10.3f %9.1f %9.1f %9.1f\n",
+                              s.owner.c_str(), s.name.c_str(), s.count,
+                              s.total_ns / 1e6,
+                              percentile(sorted, 0.5) / 1e3,
+                              percentile(sorted, 0.99) / 1e3,
+                              s.max_ns / 1e3);
+                result += line;
+            }
+
+            return result;
+        }
+    } // namespace Profile
+} // namespace Ked
@@ -22,6 +22,7 @@
 
 #include <ked/Rune.hh>
 #include <ked/Terminal.hh>
+#include <ked/Unicode.hh>
 
 namespace Ked {
 
@@ -41,13 +42,13 @@ namespace Ked {
         std::copy(std::begin(r.c), std::end(r.c), std::begin(c));
         display_width = r.display_width;
         attrs = r.attrs;
-        face_name = r.face_name;
+        face = r.face;
 
         return r;
     }
 
     bool AttrRune::operator==(AttrRune const &r) const {
-        return r.c == c && r.face_name == face_name;
+        return r.c == c && r.face == face;
     }
 
     bool AttrRune::operator!=(AttrRune const &r) const {
@@ -55,17 +56,7 @@ namespace Ked {
     }
 
     void AttrRune::calculate_width() {
-        if ((c[0] >> 7 & 1) == 0) {
-            unsigned char ch = c[0];
-
-            if (ch == '\t')
-                display_width = 8;
-            else if (ch <= 0x1f)
-                display_width = 2;
-            else
-                display_width = 1;
-        } else
-            display_width = 2;
+        display_width = Unicode::width(Unicode::decode(c));
     }
 
     void AttrRune::print(Terminal &term) const {
@@ -0,0 +1,306 @@
+/*
+ * ked -- simple text editor with minimal dependency
+ * Copyright (C) 2019  Koki Fukuda
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include <dirent.h>
+#include <stdio.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <ked/Buffer.hh>
+#include <ked/Session.hh>
+#include <ked/Ui.hh>
+
+/* Longest string read from session file. */
+#define MAX_SESSION_STRING 65536
+
+namespace Ked {
+    namespace Session {
+        namespace {
+            /* Buffer as saved in session file. */
+            struct Entry {
+                std::string name;
+                std::string path;
+                /* File name of the image in images directory, or empty if
+                 * none. */
+                std::string image;
+                std::uint64_t point;
+                std::uint64_t visible_start_point;
+                std::uint64_t scroll_x;
+                bool truncate_lines;
+            };
+        } // namespace
+
+        static char const session_magic[8] = {'K', 'E', 'D', 'S',
+                                              'E', 'S', '0', '1'};
+
+        static bool make_directory(std::string const &path) {
+            return mkdir(path.c_str(), 0700) == 0 || errno == EEXIST;
+        }
+
+        std::string const &directory() {
+            static std::string dir;
+            if (!dir.empty()) return dir;
+
+            std::string cache;
+            char const *env = std::getenv("XDG_CACHE_HOME");
+            if (env != nullptr && env[0] == '/') {
+                cache = env;
+            } else {
+                env = std::getenv("HOME");
+                if (env == nullptr || env[0] != '/') return dir;
+
+                cache = std::string(env) + "/.cache";
+            }
+
+            if (make_directory(cache) && make_directory(cache + "/ked") &&
+                make_directory(cache + "/ked/images") &&
+                make_directory(cache + "/ked/journals"))
+                dir = cache + "/ked";
+
+            return dir;
+        }
+
+        /* Returns path from the root, so that it is found from anywhere. */
+        static std::string absolute_path(std::string const &path) {
+            char *real = realpath(path.c_str(), nullptr);
+            if (real != nullptr) {
+                std::string result(real);
+                std::free(real);
+
+                return result;
+            }
+            if (path[0] == '/') return path;
+
+            char *cwd = getcwd(nullptr, 0);
+            if (cwd == nullptr) return path;
+
+            std::string result = std::string(cwd) + "/" + path;
+            std::free(cwd);
+
+            return result;
+        }
+
+        /* Names file of the path by FNV-1a hash of it. */
+        static std::string file_name(std::string const &path,
+                                     char const *suffix) {
+            std::uint64_t hash = 0xcbf29ce484222325ULL;
+            for (auto itr = std::begin(path); itr != std::end(path); ++itr) {
+                hash ^= (unsigned char)*itr;
+                hash *= 0x100000001b3ULL;
+            }
+
+            char name[17];
+            std::snprintf(name, sizeof(name), "%016llx",
+                          (unsigned long long)hash);
+
+            return name + std::string(suffix);
+        }
+
+        std::string journal_path(std::string const &file) {
+            std::string const &dir = directory();
+            if (dir.empty()) return "";
+
+            return dir + "/journals/" +
+                   file_name(absolute_path(file), ".journal");
+        }
+
+        /* Deletes images no entry refers to. */
+        static void remove_unused_images(std::string const &dir,
+                                         std::vector<Entry> const &entries) {
+            DIR *images = opendir(dir.c_str());
+            if (images == nullptr) return;
+
+            struct dirent *ent;
+            while ((ent = readdir(images)) != nullptr) {
+                std::string name = ent->d_name;
+                if (name == "." || name == "..") continue;
+
+                bool used = false;
+                for (auto itr = std::begin(entries); itr != std::end(entries);
+                     ++itr) {
+                    if (itr->image == name) {
+                        used = true;
+                        break;
+                    }
+                }
+                if (!used) unlink((dir + "/" + name).c_str());
+            }
+
+            closedir(images);
+        }
+
+        static void put_u64(std::ofstream &out, std::uint64_t n) {
+            out.write((char const *)&n, sizeof(n));
+        }
+
+        static void put_string(std::ofstream &out, std::string const &s) {
+            put_u64(out, s.size());
+            out.write(s.data(), s.size());
+        }
+
+        static bool get_u64(std::ifstream &in, std::uint64_t *n) {
+            return (bool)in.read((char *)n, sizeof(*n));
+        }
+
+        static bool get_string(std::ifstream &in, std::string *s) {
+            std::uint64_t len;
+            if (!get_u64(in, &len) || len > MAX_SESSION_STRING) return false;
+
+            s->resize(len);
+
+            return len == 0 || (bool)in.read(&(*s)[0], len);
+        }
+
+        static bool get_entry(std::ifstream &in, Entry *entry) {
+            std::uint64_t truncate;
+            if (!get_string(in, &entry->name) ||
+                !get_string(in, &entry->path) ||
+                !get_string(in, &entry->image) ||
+                !get_u64(in, &entry->point) ||
+                !get_u64(in, &entry->visible_start_point) ||
+                !get_u64(in, &entry->scroll_x) || !get_u64(in, &truncate))
+                return false;
+            entry->truncate_lines = truncate != 0;
+
+            /* Image must be in images directory. */
+            return entry->image.find('/') == std::string::npos;
+        }
+
+        bool save(Ui &ui, bool write_images) {
+            std::string const &dir = directory();
+            if (dir.empty()) return false;
+
+            std::vector<Entry> entries;
+            std::uint64_t current = UINT64_MAX;
+            std::vector<Buffer *> const &buffers = ui.buffer_list();
+            for (auto itr = std::begin(buffers); itr != std::end(buffers);
+                 ++itr) {
+                Buffer *buf = *itr;
+                if (buf->path.empty()) continue;
+
+                if (buf == ui.current_buffer) current = entries.size();
+
+                Entry entry;
+                entry.name = buf->buf_name;
+                entry.path = absolute_path(buf->path);
+                entry.point = buf->point;
+                entry.visible_start_point = buf->visible_start_point;
+                entry.scroll_x = buf->scroll_x;
+                entry.truncate_lines = buf->truncate_lines;
+                /* Image written before is referred even if not written now,
+                 * and checked when restored. */
+                if (!buf->modified && buf->file_size >= MIN_IMAGE_FILE_SIZE) {
+                    entry.image = file_name(entry.path, ".img");
+                    if (write_images)
+                        buf->write_image(dir + "/images/" + entry.image);
+                }
+                entries.push_back(entry);
+            }
+            if (write_images) remove_unused_images(dir + "/images", entries);
+
+            std::string path = dir + "/session";
+            std::string tmp_path = path + ".tmp";
+            {
+                std::ofstream out(tmp_path, std::ios::binary);
+                out.write(session_magic, sizeof(session_magic));
+                put_u64(out, entries.size());
+                put_u64(out, current);
+                for (auto itr = std::begin(entries); itr != std::end(entries);
+                     ++itr) {
+                    put_string(out, itr->name);
+                    put_string(out, itr->path);
+                    put_string(out, itr->image);
+                    put_u64(out, itr->point);
+                    put_u64(out, itr->visible_start_point);
+                    put_u64(out, itr->scroll_x);
+                    put_u64(out, itr->truncate_lines);
+                }
+
+                out.close();
+                if (!out) {
+                    std::remove(tmp_path.c_str());
+
+                    return false;
+                }
+            }
+
+            return std::rename(tmp_path.c_str(), path.c_str()) == 0;
+        }
+
+        bool restore(Ui &ui) {
+            std::string const &dir = directory();
+            if (dir.empty()) return false;
+
+            std::ifstream in(dir + "/session", std::ios::binary);
+            char magic[sizeof(session_magic)];
+            std::uint64_t n_entries;
+            std::uint64_t current;
+            if (!in.read(magic, sizeof(magic)) ||
+                std::memcmp(magic, session_magic, sizeof(magic)) != 0 ||
+                !get_u64(in, &n_entries) || !get_u64(in, &current))
+                return false;
+
+            Buffer *first = nullptr;
+            Buffer *selected = nullptr;
+            Entry entry;
+            for (std::uint64_t i = 0; i < n_entries && get_entry(in, &entry);
+                 ++i) {
+                if (ui.buffer_find(entry.name) != nullptr) continue;
+
+                Buffer *buf =
+                    entry.image.empty()
+                        ? new Buffer(entry.name, entry.path)
+                        : new Buffer(entry.name, entry.path,
+                                     dir + "/images/" + entry.image);
+
+                /* File may be changed since, so keep them in the text. */
+                std::size_t len =
+                    buf->buf_size - (buf->gap_end - buf->gap_start);
+                buf->point = buf->cluster_boundary(
+                    std::min<std::uint64_t>(entry.point, len), false);
+                buf->visible_start_point = buf->line_start(
+                    std::min<std::uint64_t>(entry.visible_start_point, len));
+                buf->truncate_lines = entry.truncate_lines;
+                buf->scroll_x = entry.scroll_x;
+
+                ui.buffer_add(buf);
+                if (first == nullptr) first = buf;
+                if (i == current) selected = buf;
+            }
+
+            if (selected == nullptr) selected = first;
+            if (selected == nullptr) return false;
+
+            ui.buffer_show(selected->buf_name);
+            ui.buffer_switch(selected->buf_name);
+
+            return true;
+        }
+    } // namespace Session
+} // namespace Ked
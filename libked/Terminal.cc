@@ -16,8 +16,11 @@
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <cerrno>
 #include <string>
 
+#include <fcntl.h>
+#include <poll.h>
 #include <sys/ioctl.h>
 #include <termios.h>
 #include <unistd.h>
@@ -25,18 +28,32 @@
 #include <ked/Terminal.hh>
 
 namespace Ked {
-    Terminal::Terminal() : io_buffer_off(0) {
-        struct winsize w;
-        ioctl(0, TIOCGWINSZ, &w);
-        width = (std::size_t)w.ws_col;
-        height = (std::size_t)w.ws_row;
+    Terminal::Terminal() : Terminal(0, STDOUT_FILENO) {}
+
+    Terminal::Terminal(int in_fd, int out_fd)
+        : io_buffer_off(0), orig_termios(nullptr), in_fd(in_fd),
+          out_fd(out_fd), closed(false), width(0), height(0) {
+        update_size();
+
+        setup();
+    }
+
+    Terminal::~Terminal() {
+        restore();
 
-        /* Save cursor, switch to alternate screen, and clear screen. */
-        put_str("\e[?1049h");
+        delete orig_termios;
+    }
+
+    void Terminal::setup() {
+        /* Save cursor, switch to alternate screen, and clear screen. Also
+         * enable bracketed paste. */
+        put_str("\e[?1049h\e[?2004h");
         flush_buffer();
 
-        orig_termios = new termios;
-        tcgetattr(0, orig_termios);
+        if (orig_termios == nullptr) {
+            orig_termios = new termios;
+            tcgetattr(in_fd, orig_termios);
+        }
 
         termios new_termios = *orig_termios;
 
@@ -48,19 +65,39 @@ namespace Ked {
         new_termios.c_cc[VMIN] = 1;
         new_termios.c_cc[VTIME] = 0;
 
-        tcsetattr(0, TCSADRAIN, &new_termios);
+        tcsetattr(in_fd, TCSADRAIN, &new_termios);
+
+        /* Input is read in chunks, so reading must not block once available
+         * bytes are consumed. */
+        orig_fd_flags = fcntl(in_fd, F_GETFL) & ~O_NONBLOCK;
+        fcntl(in_fd, F_SETFL, orig_fd_flags | O_NONBLOCK);
     }
 
-    Terminal::~Terminal() {
-        tcsetattr(0, TCSADRAIN, orig_termios);
-        delete orig_termios;
+    void Terminal::restore() {
+        fcntl(in_fd, F_SETFL, orig_fd_flags);
+        tcsetattr(in_fd, TCSADRAIN, orig_termios);
 
-        /* Clear screen and switch to normal screen, and restore cursor
-         * position. */
-        put_str("\e[?1049l");
+        /* Disable bracketed paste, clear screen and switch to normal screen,
+         * and restore cursor position. */
+        put_str("\e[?2004l\e[?1049l");
         flush_buffer();
     }
 
+    bool Terminal::update_size() {
+        struct winsize w;
+        if (ioctl(in_fd, TIOCGWINSZ, &w) != 0) return false;
+        if (w.ws_col == width && w.ws_row == height) return false;
+
+        width = (std::size_t)w.ws_col;
+        height = (std::size_t)w.ws_row;
+
+        return true;
+    }
+
+    int Terminal::input_fd() const { return in_fd; }
+
+    bool Terminal::input_closed() const { return closed; }
+
     void Terminal::put_char(char c) {
         if (io_buffer_off >= 4096) flush_buffer();
         io_buffer[io_buffer_off++] = c;
@@ -92,11 +129,45 @@ namespace Ked {
 
     char Terminal::get_char() {
         char buf[1];
-        read(0, buf, 1);
+        read_input(buf, 1, -1);
 
         return *buf;
     }
 
+    std::size_t Terminal::read_input(char *buf, std::size_t len,
+                                     int timeout_ms) {
+        std::size_t off = 0;
+        while (off < len) {
+            ssize_t n = read(in_fd, buf + off, len - off);
+            if (n > 0) {
+                off += n;
+                continue;
+            }
+
+            if (n == 0) {
+                closed = true;
+                break;
+            }
+            if (errno == EINTR) continue;
+            /* Hung up terminal fails with EIO. */
+            if (errno != EAGAIN) {
+                closed = true;
+                break;
+            }
+            /* Return whatever has arrived so far. */
+            if (off != 0) break;
+
+            struct pollfd pfd;
+            pfd.fd = in_fd;
+            pfd.events = POLLIN;
+            int res = poll(&pfd, 1, timeout_ms);
+            if (res == 0) break;
+            if (res < 0 && errno != EINTR) break;
+        }
+
+        return off;
+    }
+
     void Terminal::move_cursor(unsigned int x, unsigned int y) {
         put_str("\e[");
         put_str(std::to_string(y));
@@ -106,7 +177,24 @@ namespace Ked {
     }
 
     void Terminal::flush_buffer() {
-        write(STDOUT_FILENO, io_buffer, io_buffer_off);
+        /* Output usually shares the file description with input, so it may
+         * be nonblocking as well. */
+        std::size_t off = 0;
+        while (off < io_buffer_off) {
+            ssize_t n = write(out_fd, io_buffer + off, io_buffer_off - off);
+            if (n >= 0) {
+                off += n;
+                continue;
+            }
+
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN) break;
+
+            struct pollfd pfd;
+            pfd.fd = out_fd;
+            pfd.events = POLLOUT;
+            poll(&pfd, 1, -1);
+        }
         io_buffer_off = 0;
     }
 
@@ -16,219 +16,217 @@
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
 #include <array>
+#include <cerrno>
 #include <cstring>
 #include <functional>
 #include <iterator>
+#include <memory>
 #include <mutex>
 #include <string>
 #include <vector>
 
+#include <signal.h>
+#include <sys/epoll.h>
+
 #include <ked/Buffer.hh>
+#include <ked/Input.hh>
+#include <ked/Journal.hh>
+#include <ked/Profile.hh>
 #include <ked/Rune.hh>
+#include <ked/Session.hh>
 #include <ked/Ui.hh>
+#include <ked/Window.hh>
 
 namespace Ked {
     namespace KeyHandling {
-        Keybind::~Keybind() {
-            for (auto itr = std::begin(binding); itr != std::end(binding);
-                 ++itr) {
-                delete *itr;
-            }
-        }
-
-        char *Keybind::compile_key(std::string const &key) {
-            std::size_t len = key.size();
-
-            for (auto itr = std::begin(key); itr != std::end(key); ++itr) {
-                if (*itr == '^' && itr != std::end(key) - 1) --len;
-            }
-
-            char *result = new char[len + 1];
-            std::size_t r_i = 0;
-            result[len] = 0;
-            for (auto itr = std::begin(key); itr != std::end(key); ++itr) {
-                if (*itr == '^' && itr != std::end(key) - 1) {
-                    result[r_i] = *(++itr) - '@';
-                } else {
-                    result[r_i] = *itr;
-                }
-                ++r_i;
-            }
-
-            return result;
-        }
-
-        void Keybind::add(std::string const &key, EditorCommand func) {
-            char *seq = compile_key(key);
-
-            for (auto itr = std::begin(binding); itr != std::end(binding);
-                 ++itr) {
-                int cmp = (*itr)->key.compare(seq);
-                if (cmp == 0) {
-                    (*itr)->func = func;
-                    delete[] seq;
-
-                    return;
-                } else if (cmp > 0) {
-                    BindingElement *e = new BindingElement;
-                    e->key = std::string(seq);
-                    e->func = func;
-                    binding.insert(itr, e);
-
-                    delete[] seq;
-
-                    return;
-                }
-            }
-            BindingElement *e = new BindingElement;
-            e->key = std::string(seq);
-            e->func = func;
-            binding.insert(std::end(binding), e);
-            delete[] seq;
-        }
-
-        int Keybind::compare_key(std::string const &key,
-                                 std::vector<char> const &seq) {
-            std::size_t len = seq.size() > key.size() ? key.size() : seq.size();
-            for (std::size_t i = 0; i < len; ++i) {
-                int cmp = seq[i] - key[i];
-                if (cmp != 0) return cmp;
-            }
-            if (seq.size() == key.size())
-                return 0;
-            else if (seq.size() < key.size())
-                return -key[len];
-            else
-                return seq[len];
-        }
-
-        int Keybind::compare_key(std::string const &key,
-                                 std::vector<char> const &seq, std::size_t n) {
-            char *str = new char[seq.size() + 1];
-            str[seq.size()] = 0;
-            for (std::size_t i = 0; i < seq.size(); ++i)
-                str[i] = seq[i];
-
-            int cmp = std::strncmp(key.c_str(), str, n);
-            delete[] str;
-
-            return cmp;
-        }
-
-        KeyBindState Keybind::handle(std::vector<char> const &seq, Ui &ui,
-                                     Buffer &buf) {
-            for (auto itr = std::begin(binding); itr != std::end(binding);
-                 ++itr) {
-                if (compare_key((*itr)->key, seq, seq.size()) == 0) {
-                    int cmp = compare_key((*itr)->key, seq);
-                    if (cmp == 0) {
-                        ((*itr)->func)(ui, buf);
-
-                        return KEYBIND_HANDLED;
-                    }
-
-                    return KEYBIND_WAIT;
-                }
-            }
-
-            if (seq.size() != 1) return KEYBIND_HANDLED;
-
-            return KEYBIND_NOT_HANDLED;
-        }
-
-        static std::vector<char> key_buf;
+        static unsigned int key_state;
+        /* Keymap the pending sequence is looked up in. */
+        static Keybind *key_keybind;
 
         void handle_key(Ui &ui, unsigned char c) {
-            key_buf.push_back(c);
+            /* Keymap is resolved only when a sequence starts, since states
+             * are meaningful only for the keymap they came from. */
+            if (key_state == 0) key_keybind = &ui.current_keybind();
 
-            switch (ui.global_keybind.handle(key_buf, ui, *ui.current_buffer)) {
-            case KEYBIND_NOT_HANDLED:
+            if (key_keybind->handle(key_state, c, ui, *ui.current_buffer) ==
+                KEYBIND_NOT_HANDLED)
                 ui.current_buffer->insert(c);
-                // fall through
-            case KEYBIND_HANDLED:
-                key_buf.clear();
-                break;
-            case KEYBIND_WAIT:
-                break;
-            }
         }
 
         void handle_rune(Ui &ui, Rune &r) {
-            key_buf.clear();
+            key_state = 0;
             ui.current_buffer->insert(r);
         }
 
+        /* Inserts pasted text as is, never looking up keybindings. */
+        void handle_paste(Ui &ui, std::string const &text) {
+            key_state = 0;
+            ui.current_buffer->insert_utf8(text.data(), text.size());
+        }
+
     } // namespace KeyHandling
 
+    Ui::LayoutNode::~LayoutNode() { delete window; }
+
     Ui::Ui(Terminal *term)
-        : editor_exited(false), maybe_next_x(term->width),
-          maybe_next_y(term->height), term(term), current_buffer(nullptr) {
+        : editor_exited(false), suspended(false),
+          divider_face(Face::id("WindowDivider")), maybe_next_x(term->width),
+          maybe_next_y(term->height), current_face(FACE_ID_DEFAULT),
+          input_buffer(INPUT_BUFFER_SIZE), escape_timer(-1),
+          resolved(nullptr), resolved_buffer(nullptr), resolved_version(0),
+          highlight_timer(-1), journal_timer(-1), recording_macro(false),
+          replaying_macro(false),
+          macro_failed(false), term(term), current_buffer(nullptr),
+          current_window(nullptr), jobs(event_loop) {
+        events.on_text_changed(
+            [this](TextChangedEvent const &ev) { jobs.cancel(ev.buf); });
+        events.on_text_changed([this](TextChangedEvent const &ev) {
+            auto found = highlighters.find(ev.buf);
+            if (found != std::end(highlighters))
+                found->second.text_changed(ev);
+        });
+
         init_system_buffers();
         display_buffer.resize(term->width * term->height);
+
+        stop_process = []() { kill(0, SIGTSTP); };
+
+        event_loop.add_signal(SIGCONT, [this]() { resume(); });
+        event_loop.add_signal(SIGWINCH, [this]() { handle_resize(); });
     }
 
     Ui::~Ui() {
-        for (auto itr = std::begin(buffers); itr != std::end(buffers); ++itr)
+        /* Windows leave their buffers on deletion. */
+        layout_root.reset();
+
+        for (auto itr = std::begin(buffers); itr != std::end(buffers); ++itr) {
+            jobs.cancel(*itr);
             delete *itr;
+        }
+    }
+
+    void Ui::use_face(Face::FaceId face) {
+        if (face == current_face) return;
+
+        term->put_str(Face::transition(current_face, face));
+        current_face = face;
     }
 
     /* Draws char to the terminal if needed. */
-    void Ui::draw_char(unsigned char c, std::string const &face_name,
-                       unsigned int x, unsigned int y) {
-        if (x > term->width || y > term->height ||
-            (display_buffer[(y - 1) * term->width + x - 1].c[0] == c &&
-             face_name ==
-                 display_buffer[(y - 1) * term->width + x - 1].face_name) ||
-            c == '\n')
-            return;
+    void Ui::draw_char(unsigned char c, Face::FaceId face, unsigned int x,
+                       unsigned int y) {
+        if (x > term->width || y > term->height || c == '\n') return;
 
-        if (face_name != current_face_name) {
-            term->put_str(Face::lookup(face_name));
+        Cell &cell = display_buffer[(y - 1) * term->width + x - 1];
+        if (cell.c[0] == c && cell.c[1] == 0 && cell.tail.empty() &&
+            cell.face == face)
+            return;
 
-            current_face_name = face_name;
-        }
+        use_face(face);
 
         if (x != maybe_next_x || y != maybe_next_y) term->move_cursor(x, y);
         term->put_char(c);
-        display_buffer[(y - 1) * term->width + x - 1].c[0] = c;
-        display_buffer[(y - 1) * term->width + x - 1].face_name = face_name;
-        for (int i = 1; i < 4; ++i)
-            display_buffer[(y - 1) * term->width + x - 1].c[i] = 0;
+        cell.c.fill(0);
+        cell.c[0] = c;
+        cell.tail.clear();
+        cell.face = face;
 
         maybe_next_x = x + 1;
         maybe_next_y = y;
     }
 
     /* Draws AttrRune with its attrubutes to the termianl if needed. */
-    void Ui::draw_rune(AttrRune const &r, std::string const &default_face,
+    void Ui::draw_rune(AttrRune const &r, Face::FaceId default_face,
                        unsigned int x, unsigned int y) {
-        std::string face_name = r.face_name;
-        if (face_name.empty()) {
-            face_name = default_face;
-        }
+        draw_cell(r, std::string(), default_face, r.display_width, x, y);
+    }
 
-        if (x > term->width || y > term->height ||
-            (display_buffer[(y - 1) * term->width + x - 1].c == r.c &&
-             face_name ==
-                 display_buffer[(y - 1) * term->width + x - 1].face_name) ||
-            r.c[0] == '\n')
-            return;
+    void Ui::draw_cell(AttrRune const &r, std::string const &tail,
+                       Face::FaceId default_face, unsigned int width,
+                       unsigned int x, unsigned int y) {
+        Face::FaceId face = r.face == FACE_ID_DEFAULT ? default_face : r.face;
 
-        if (face_name != current_face_name) {
-            term->put_str(Face::lookup(face_name));
+        if (x > term->width || y > term->height || r.c[0] == '\n') return;
 
-            current_face_name = face_name;
-        }
+        Cell &cell = display_buffer[(y - 1) * term->width + x - 1];
+        if (cell.c == r.c && cell.tail == tail && cell.face == face) return;
+
+        use_face(face);
 
         if (x != maybe_next_x || y != maybe_next_y) term->move_cursor(x, y);
+        /* Combining characters with nothing to combine with. */
+        if (r.display_width == 0) term->put_char(' ');
         r.print(*term);
-        display_buffer[(y - 1) * term->width + x - 1] = r;
+        term->put_str(tail);
+        cell.c = r.c;
+        cell.tail = tail;
+        cell.face = face;
 
-        maybe_next_x = x + r.display_width;
+        maybe_next_x = x + width;
         maybe_next_y = y;
     }
 
+    void Ui::draw_cluster(Buffer &buf, std::size_t start, std::size_t end,
+                          unsigned int width, unsigned int x, unsigned int y) {
+        std::string tail;
+        for (std::size_t i = start + 1; i < end; ++i) {
+            AttrRune *r = buf.get_rune_ptr(i);
+            std::size_t n = 1;
+            for (; n < 4; ++n)
+                if ((r->c[n] >> 6 & 0x3) != 0x2) break;
+            tail.append((char const *)r->c.data(), n);
+        }
+        draw_cell(*buf.get_rune_ptr(start), tail, buf.default_face, width,
+                  x, y);
+
+        for (unsigned int i = x + 1; i < x + width; ++i)
+            invalidate_point(i, y);
+    }
+
+    unsigned int Ui::draw_truncated_line(Buffer &buf, std::size_t start,
+                                         Buffer::LineLayout &layout,
+                                         unsigned int y) {
+        unsigned int x = (unsigned int)buf.display_range_x_start;
+        unsigned int width;
+        std::size_t next;
+
+        /* Jump to the left edge using the column index. */
+        std::size_t line_end = start + layout.length;
+        std::size_t column;
+        std::size_t i =
+            start + buf.offset_at(start, layout, buf.scroll_x, &column);
+        if (column < buf.scroll_x) {
+            /* Wide character across the left edge. */
+            next = buf.cluster_end(i, &width);
+            for (; column + width > buf.scroll_x; --width) {
+                draw_char(' ', buf.default_face, x, y);
+                ++x;
+            }
+            i = next;
+        }
+
+        while (i < line_end) {
+            next = buf.cluster_end(i, &width);
+            if (x + width >= buf.display_range_x_end) break;
+
+            draw_cluster(buf, i, next, width, x, y);
+
+            x += width;
+            i = next;
+        }
+
+        if (i < line_end) {
+            for (; x + 1 < buf.display_range_x_end; ++x)
+                draw_char(' ', buf.default_face, x, y);
+            draw_char('$', buf.default_face, x, y);
+            ++x;
+        }
+
+        return x;
+    }
+
     /* Make next drawing in the position to be redrawn. */
     void Ui::invalidate_point(unsigned int x, unsigned int y) {
         if (x > term->width || y >= term->height) return;
@@ -237,121 +235,556 @@ namespace Ked {
         display_buffer[(y - 1) * term->width + x - 1].c[0] = '\n';
     }
 
+    void Ui::invalidate() {
+        for (auto itr = std::begin(display_buffer);
+             itr != std::end(display_buffer); ++itr) {
+            itr->c.fill(0);
+            itr->c[0] = '\n';
+        }
+
+        for (auto itr = std::begin(windows); itr != std::end(windows); ++itr)
+            (*itr)->mark_dirty();
+
+        term->put_str("\e[0m");
+        current_face = FACE_ID_DEFAULT;
+        maybe_next_x = 0;
+        maybe_next_y = 0;
+    }
+
+    void Ui::show_in_window(Buffer *buf) {
+        if (current_window == nullptr) {
+            layout_root.reset(new LayoutNode());
+            layout_root->window = new Window(buf);
+            windows.clear();
+            collect_windows(*layout_root);
+            current_window = layout_root->window;
+        } else {
+            current_window->set_buffer(buf);
+        }
+
+        current_window->activate();
+    }
+
+    void Ui::select_window(Window *win) {
+        current_window = win;
+        current_buffer = win->buffer();
+        win->activate();
+    }
+
     void Ui::buffer_show(std::string const &name) {
-        for (auto itr = std::begin(buffers); itr != std::end(buffers); ++itr) {
-            if ((*itr)->buf_name == name) {
-                displayed_buffers.push_back(*itr);
-                break;
-            }
+        Buffer *buf = buffer_find(name);
+        if (buf != nullptr) {
+            if (name.compare(0, 9, "__system_") == 0)
+                displayed_buffers.push_back(buf);
+            else
+                show_in_window(buf);
         }
+
+        layout();
     }
 
     void Ui::buffer_switch(std::string const &name) {
-        for (auto itr = std::begin(buffers); itr != std::end(buffers); ++itr) {
-            if ((*itr)->buf_name == name) {
-                current_buffer = *itr;
-                break;
+        Buffer *buf = buffer_find(name);
+        if (buf == nullptr) return;
+
+        if (current_window != nullptr && current_window->buffer() == buf) {
+            select_window(current_window);
+
+            return;
+        }
+        for (auto itr = std::begin(windows); itr != std::end(windows); ++itr) {
+            if ((*itr)->buffer() == buf) {
+                select_window(*itr);
+
+                return;
             }
         }
+
+        current_buffer = buf;
+    }
+
+    Buffer *Ui::buffer_find(std::string const &name) {
+        for (auto itr = std::begin(buffers); itr != std::end(buffers); ++itr) {
+            if ((*itr)->buf_name == name) return *itr;
+        }
+
+        return nullptr;
+    }
+
+    void Ui::buffer_select(std::string const &name) {
+        Buffer *buf = buffer_find(name);
+        if (buf == nullptr || buf == current_buffer) return;
+
+        show_in_window(buf);
+        current_buffer = buf;
+
+        layout();
+        invalidate();
+    }
+
+    void Ui::buffer_load(std::vector<std::string> const &paths) {
+        /* Buffers loaded early wait here for the ones before them. */
+        auto loaded =
+            std::make_shared<std::vector<Buffer *>>(paths.size(), nullptr);
+        auto next = std::make_shared<std::size_t>(0);
+
+        for (std::size_t i = 0; i < paths.size(); ++i) {
+            std::string path = paths[i];
+            jobs.submit([this, path, i, loaded, next](BufferSnapshot const &,
+                                                      Job const &) {
+                Buffer *buf = new Buffer(path, path);
+
+                return std::function<void()>([this, buf, i, loaded, next]() {
+                    (*loaded)[i] = buf;
+                    while (*next < loaded->size() &&
+                           (*loaded)[*next] != nullptr)
+                        buffer_add((*loaded)[(*next)++]);
+                });
+            });
+        }
+    }
+
+    void Ui::buffer_cycle(int count) {
+        std::vector<Buffer *> candidates;
+        for (auto itr = std::begin(buffers); itr != std::end(buffers); ++itr)
+            if ((*itr)->buf_name.compare(0, 9, "__system_") != 0)
+                candidates.push_back(*itr);
+        if (candidates.empty()) return;
+
+        int n = candidates.size();
+        int index =
+            std::find(std::begin(candidates), std::end(candidates),
+                      current_buffer) -
+            std::begin(candidates);
+        if (index == n) index = 0;
+        index = ((index + count) % n + n) % n;
+
+        buffer_select(candidates[index]->buf_name);
+    }
+
+    bool Ui::buffer_remove(Buffer *buf) {
+        if (buf == current_buffer ||
+            std::find(std::begin(displayed_buffers),
+                      std::end(displayed_buffers),
+                      buf) != std::end(displayed_buffers))
+            return false;
+        for (auto itr = std::begin(windows); itr != std::end(windows); ++itr)
+            if ((*itr)->buffer() == buf) return false;
+
+        auto found = std::find(std::begin(buffers), std::end(buffers), buf);
+        if (found == std::end(buffers)) return false;
+        buffers.erase(found);
+
+        highlighters.erase(buf);
+        jobs.cancel(buf);
+        if (resolved_buffer == buf) resolved = nullptr;
+        delete buf;
+
+        return true;
+    }
+
+    std::vector<Buffer *> const &Ui::buffer_list() const { return buffers; }
+
+    bool Ui::split_window(bool side_by_side) {
+        if (current_window == nullptr) return false;
+
+        LayoutNode *node = find_node(*layout_root, current_window);
+        if (side_by_side ? node->x_end - node->x_start < MIN_SPLIT_WIDTH
+                         : node->y_end - node->y_start < MIN_SPLIT_HEIGHT)
+            return false;
+
+        /* New window starts with the viewport of the current one. */
+        current_window->activate();
+        Window *win = new Window(current_window->buffer());
+
+        node->first.reset(new LayoutNode());
+        node->first->window = node->window;
+        node->first->parent = node;
+        node->second.reset(new LayoutNode());
+        node->second->window = win;
+        node->second->parent = node;
+        node->window = nullptr;
+        node->side_by_side = side_by_side;
+
+        windows.clear();
+        collect_windows(*layout_root);
+        layout();
+
+        return true;
+    }
+
+    bool Ui::delete_window() {
+        if (current_window == nullptr || layout_root->window != nullptr)
+            return false;
+
+        LayoutNode *node = find_node(*layout_root, current_window);
+        LayoutNode *parent = node->parent;
+        std::unique_ptr<LayoutNode> sibling = std::move(
+            parent->first.get() == node ? parent->second : parent->first);
+
+        /* Parent takes over the sibling, which drops node and its
+         * window. */
+        parent->window = sibling->window;
+        sibling->window = nullptr;
+        parent->side_by_side = sibling->side_by_side;
+        parent->first = std::move(sibling->first);
+        parent->second = std::move(sibling->second);
+        if (parent->first != nullptr) parent->first->parent = parent;
+        if (parent->second != nullptr) parent->second->parent = parent;
+
+        windows.clear();
+        collect_windows(*layout_root);
+
+        LayoutNode *next = parent;
+        while (next->window == nullptr) next = next->first.get();
+        select_window(next->window);
+        layout();
+
+        return true;
+    }
+
+    void Ui::delete_other_windows() {
+        if (current_window == nullptr || layout_root->window != nullptr)
+            return;
+
+        /* Keep the window out of the tree being deleted. */
+        find_node(*layout_root, current_window)->window = nullptr;
+        std::unique_ptr<LayoutNode> root(new LayoutNode());
+        root->window = current_window;
+        layout_root = std::move(root);
+
+        windows.clear();
+        collect_windows(*layout_root);
+        select_window(current_window);
+        layout();
+    }
+
+    void Ui::other_window(int count) {
+        if (windows.empty()) return;
+
+        int n = windows.size();
+        int index = std::find(std::begin(windows), std::end(windows),
+                              current_window) -
+                    std::begin(windows);
+        if (index == n) index = 0;
+        index = ((index + count) % n + n) % n;
+
+        select_window(windows[index]);
+    }
+
+    void Ui::collect_windows(LayoutNode &node) {
+        if (node.window != nullptr) {
+            windows.push_back(node.window);
+
+            return;
+        }
+
+        collect_windows(*node.first);
+        collect_windows(*node.second);
+    }
+
+    Ui::LayoutNode *Ui::find_node(LayoutNode &node, Window *win) {
+        if (node.window != nullptr) return node.window == win ? &node : nullptr;
+
+        LayoutNode *found = find_node(*node.first, win);
+
+        return found != nullptr ? found : find_node(*node.second, win);
     }
 
     void Ui::buffer_add(Buffer *buf) {
         buffers.push_back(buf);
 
-        for (auto itr = std::begin(on_buffer_entry_changed_listener);
-             itr != std::end(on_buffer_entry_changed_listener); ++itr) {
-            (*itr)(buffers);
+        buf->events = &events;
+        events.buffer_added(buf);
+
+        if (!buf->path.empty() && buf->journal == nullptr) start_journal(buf);
+    }
+
+    void Ui::start_journal(Buffer *buf) {
+        std::string path = Session::journal_path(buf->path);
+        if (path.empty()) return;
+
+        Journal *journal = Journal::open(path);
+        if (journal == nullptr) {
+            if (errno == EWOULDBLOCK)
+                write_message(buf->buf_name + " is edited in another session;"
+                                              " edits are not journaled");
+
+            return;
+        }
+
+        std::size_t end;
+        std::vector<JournalRecord> records =
+            journal->read(buf->file_mtime, buf->file_size, &end);
+        /* Recovered edits are kept on the disk as they are, so that they
+         * survive another crash right after this. */
+        if (records.empty() ? !journal->reset(*buf)
+                            : !journal->truncate(end)) {
+            delete journal;
+
+            return;
+        }
+        if (records.empty()) {
+            buf->journal = journal;
+
+            return;
+        }
+
+        buf->hold_updates();
+        for (auto itr = std::begin(records); itr != std::end(records); ++itr)
+            buf->replace(itr->pos, itr->removed, itr->text.data(),
+                         itr->text.size());
+        buf->release_updates();
+        /* Edits after them are appended. */
+        buf->journal = journal;
+
+        write_message("Recovered " + std::to_string(records.size()) +
+                      " unsaved edits of " + buf->buf_name);
+    }
+
+    void Ui::flush_journals() {
+        for (auto itr = std::begin(buffers); itr != std::end(buffers); ++itr)
+            if ((*itr)->journal != nullptr) (*itr)->journal->flush();
+    }
+
+    void Ui::schedule_journal_flush() {
+        if (journal_timer >= 0) return;
+
+        for (auto itr = std::begin(buffers); itr != std::end(buffers); ++itr) {
+            if ((*itr)->journal != nullptr && (*itr)->journal->dirty()) {
+                journal_timer = event_loop.add_timer(
+                    JOURNAL_FLUSH_INTERVAL, false, [this]() {
+                        journal_timer = -1;
+                        flush_journals();
+                    });
+
+                return;
+            }
         }
     }
 
     void Ui::init_system_buffers() {
         Buffer *header = new Buffer("__system_header__");
-        header->display_range_x_start = 1;
-        header->display_range_x_end = term->width;
-        header->display_range_y_start = 1;
-        header->display_range_y_end = 2;
+        buffer_add(header);
+        buffer_show("__system_header__");
         header->insert('K');
         header->insert('e');
         header->insert('d');
-        buffer_add(header);
-        buffer_show("__system_header__");
 
         Buffer *footer = new Buffer("__system_footer__");
-        footer->display_range_x_start = 1;
-        footer->display_range_x_end = term->width + 1;
-        footer->display_range_y_start = term->height;
-        footer->display_range_y_end = term->height + 1;
         buffer_add(footer);
         buffer_show("__system_footer__");
     }
 
-    void Ui::exit_editor() { editor_exited = true; }
+    void Ui::layout() {
+        for (auto itr = std::begin(displayed_buffers);
+             itr != std::end(displayed_buffers); ++itr) {
+            Buffer *buf = *itr;
+            if (buf->buf_name == "__system_header__")
+                buf->set_display_range(1, term->width, 1, 2);
+            else if (buf->buf_name == "__system_footer__")
+                buf->set_display_range(1, term->width + 1, term->height,
+                                       term->height + 1);
+            else
+                buf->set_display_range(1, term->width, 2, term->height);
+        }
+
+        if (layout_root != nullptr) {
+            layout_node(*layout_root, 1, term->width + 1, 2, term->height);
+            current_window->activate();
+        }
+    }
+
+    void Ui::layout_node(LayoutNode &node, unsigned int x_start,
+                         unsigned int x_end, unsigned int y_start,
+                         unsigned int y_end) {
+        node.x_start = x_start;
+        node.x_end = x_end;
+        node.y_start = y_start;
+        node.y_end = y_end;
+
+        if (node.window != nullptr) {
+            /* The last column is the divider, which is left blank at the
+             * right edge of the screen. Windows above others have a divider
+             * row too. */
+            unsigned int text_x_end = std::max(x_start, x_end - 1);
+            unsigned int text_y_end =
+                y_end < term->height ? std::max(y_start, y_end - 1) : y_end;
+            node.window->set_display_range(x_start, text_x_end, y_start,
+                                           text_y_end);
+
+            return;
+        }
+
+        if (node.side_by_side) {
+            unsigned int mid = x_start + (x_end - x_start) / 2;
+            layout_node(*node.first, x_start, mid, y_start, y_end);
+            layout_node(*node.second, mid, x_end, y_start, y_end);
+        } else {
+            unsigned int mid = y_start + (y_end - y_start) / 2;
+            layout_node(*node.first, x_start, x_end, y_start, mid);
+            layout_node(*node.second, x_start, x_end, mid, y_end);
+        }
+    }
+
+    void Ui::handle_resize() {
+        /* The size is taken again on resume. */
+        if (suspended) return;
 
-    void Ui::redraw_editor() {
         std::lock_guard<std::mutex> lock(display_buffer_mutex);
 
-        unsigned int x = 1;
-        unsigned int y = 1;
+        if (!term->update_size()) return;
 
-        size_t i;
-        AttrRune *c;
-        for (size_t b = 0; b < displayed_buffers.size(); ++b) {
-            Buffer *buf = displayed_buffers[b];
+        display_buffer.clear();
+        display_buffer.resize(term->width * term->height);
+        invalidate();
+        term->put_str("\e[2J");
 
-            x = (unsigned int)buf->display_range_x_start;
-            y = (unsigned int)buf->display_range_y_start;
-            i = buf->visible_start_point;
-            while (i < buf->buf_size - (buf->gap_end - buf->gap_start)) {
-                if (y >= buf->display_range_y_end) break;
+        layout();
+    }
 
-                c = buf->get_rune_ptr(i);
+    void Ui::set_terminal(Terminal *new_term) {
+        std::lock_guard<std::mutex> lock(display_buffer_mutex);
 
-                if (c->is_lf()) {
-                    for (unsigned int j = x; j <= term->width; ++j)
-                        draw_char(' ', buf->default_face_name, j, y);
+        term = new_term;
+        display_buffer.clear();
+        display_buffer.resize(term->width * term->height);
+        invalidate();
 
-                    ++y;
+        layout();
+    }
+
+    void Ui::exit_editor() { editor_exited = true; }
+
+    void Ui::suspend() {
+        flush_journals();
+        /* Process on another terminal, such as the daemon, is not stopped
+         * by the terminal, so keys to the shell would be read. */
+        event_loop.remove_fd(term->input_fd());
+        suspended = true;
+        term->restore();
+        stop_process();
+    }
+
+    void Ui::resume() {
+        term->setup();
+        if (suspended) {
+            suspended = false;
+            watch_input();
+        }
+
+        /* The shell has drawn over the screen meanwhile. */
+        std::lock_guard<std::mutex> lock(display_buffer_mutex);
+        term->update_size();
+        display_buffer.clear();
+        display_buffer.resize(term->width * term->height);
+        invalidate();
 
-                    x = 1;
-                } else {
-                    draw_rune(*c, buf->default_face_name, x, y);
-
-                    for (unsigned int j = x + 1; j < x + c->display_width; ++j)
-                        invalidate_point(j, y);
-
-                    x += c->display_width;
-
-                    if (i + 1 <
-                        buf->buf_size - (buf->gap_end - buf->gap_start)) {
-                        AttrRune *next_rune = buf->get_rune_ptr(i + 1);
-                        if (!next_rune->is_lf() &&
-                            x + next_rune->display_width >=
-                                buf->display_range_x_end) {
-                            if (x + next_rune->display_width ==
-                                buf->display_range_x_end) {
-                                draw_char('\\', buf->default_face_name, x, y);
-                            } else {
-                                draw_char(' ', buf->default_face_name, x, y);
-                                ++x;
-                                draw_char('\\', buf->default_face_name, x, y);
-                            }
-
-                            x = buf->display_range_x_start;
-                            ++y;
-                        }
+        layout();
+    }
+
+    void Ui::draw_buffer(Buffer &buf, unsigned int right) {
+        unsigned int x = (unsigned int)buf.display_range_x_start;
+        unsigned int y = (unsigned int)buf.display_range_y_start;
+        std::size_t len = buf.buf_size - (buf.gap_end - buf.gap_start);
+        std::size_t i = buf.visible_start_point;
+        std::size_t start = buf.line_start(i);
+        std::size_t next;
+        unsigned int width;
+        while (y < buf.display_range_y_end) {
+            Buffer::LineLayout &layout = buf.line_layout(start);
+            std::size_t row = buf.row_of(start, layout, i - start);
+
+            if (buf.truncate_lines) {
+                x = draw_truncated_line(buf, start, layout, y);
+            } else {
+                for (;;) {
+                    std::size_t row_end =
+                        start + buf.row_end(start, layout, row);
+                    while (i < row_end) {
+                        next = buf.cluster_end(i, &width);
+                        draw_cluster(buf, i, next, width, x, y);
+
+                        x += width;
+                        i = next;
                     }
-                }
 
-                ++i;
-            }
+                    if (row_end == start + layout.length) break;
+
+                    /* The row continues on the next one. */
+                    for (; x + 1 < buf.display_range_x_end; ++x)
+                        draw_char(' ', buf.default_face, x, y);
+                    draw_char('\\', buf.default_face, x, y);
+                    for (unsigned int j = x + 1; j <= right; ++j)
+                        draw_char(' ', buf.default_face, j, y);
 
-            for (unsigned int j = y; j < buf->display_range_y_end; j++) {
-                for (unsigned int k = x; k <= term->width; k++)
-                    draw_char(' ', buf->default_face_name, k, j);
-                x = buf->display_range_x_start;
+                    x = buf.display_range_x_start;
+                    ++y;
+                    ++row;
+                    if (y >= buf.display_range_y_end) break;
+                }
             }
+
+            if (y >= buf.display_range_y_end || start + layout.length >= len)
+                break;
+
+            for (unsigned int j = x; j <= right; ++j)
+                draw_char(' ', buf.default_face, j, y);
+
+            x = buf.display_range_x_start;
+            ++y;
+
+            start += layout.length + 1;
+            i = start;
+        }
+
+        for (unsigned int j = y; j < buf.display_range_y_end; j++) {
+            for (unsigned int k = x; k <= right; k++)
+                draw_char(' ', buf.default_face, k, j);
+            x = buf.display_range_x_start;
+        }
+    }
+
+    void Ui::draw_dividers(LayoutNode const &node) {
+        Buffer &buf = *node.window->buffer();
+        unsigned int x = node.x_end - 1;
+        bool below = node.y_end < term->height;
+        unsigned int y_end = below ? node.y_end - 1 : node.y_end;
+
+        for (unsigned int y = node.y_start; y < y_end; ++y) {
+            if (x < term->width)
+                draw_char('|', divider_face, x, y);
+            else
+                draw_char(' ', buf.default_face, x, y);
         }
 
+        if (below) {
+            for (unsigned int k = node.x_start; k < node.x_end; ++k)
+                draw_char('-', divider_face, k, node.y_end - 1);
+        }
+    }
+
+    void Ui::redraw_editor() {
+        std::lock_guard<std::mutex> lock(display_buffer_mutex);
+
+        for (auto itr = std::begin(displayed_buffers);
+             itr != std::end(displayed_buffers); ++itr)
+            draw_buffer(**itr, term->width);
+
+        /* Each window is drawn with its own viewport, and only when it may
+         * have changed since the last time. */
+        for (auto itr = std::begin(windows); itr != std::end(windows); ++itr) {
+            Window *win = *itr;
+            win->activate();
+            if (!win->needs_redraw()) continue;
+
+            draw_buffer(*win->buffer(),
+                        win->buffer()->display_range_x_end - 1);
+            draw_dividers(*find_node(*layout_root, win));
+            win->mark_drawn();
+        }
+        if (current_window != nullptr) current_window->activate();
+
         term->move_cursor(current_buffer->display_range_x_start +
                               current_buffer->cursor_x - 1,
                           current_buffer->display_range_y_start +
@@ -374,67 +807,309 @@ namespace Ked {
         }
         if (footer == nullptr) return;
 
+        /* Replace the previous message. */
+        footer->clear();
         Ked::String str(msg);
         for (auto itr = std::begin(str.str); itr != std::end(str.str); ++itr)
             footer->insert(*itr);
     }
 
+    void Ui::command_failed(std::string const &msg) {
+        if (replaying_macro) macro_failed = true;
+
+        write_message(msg);
+    }
+
     void Ui::add_global_keybind(std::string const &key,
                                 KeyHandling::EditorCommand func) {
         global_keybind.add(key, func);
     }
 
-    void Ui::add_buffer_entry_change_listener(
-        std::function<void(std::vector<Buffer *> &)> listener) {
-        on_buffer_entry_changed_listener.push_back(listener);
+    void Ui::add_mode_keybind(std::string const &mode, std::string const &key,
+                              KeyHandling::EditorCommand func) {
+        mode_keybinds[mode].add(key, func);
     }
 
-    void Ui::main_loop() {
-        if (current_buffer == nullptr)
-            current_buffer = buffers[buffers.size() - 1];
+    void Ui::add_command(std::string const &name,
+                         KeyHandling::EditorCommand func) {
+        commands[name] = func;
+        command_owners[name] = Profile::current_owner();
+    }
+
+    std::string Ui::command_owner(std::string const &name) const {
+        auto found = command_owners.find(name);
+        if (found == std::end(command_owners))
+            return Profile::current_owner();
+
+        return found->second;
+    }
+
+    KeyHandling::EditorCommand const *
+    Ui::find_command(std::string const &name) const {
+        auto found = commands.find(name);
+        if (found == std::end(commands)) return nullptr;
+
+        return &found->second;
+    }
+
+    KeyHandling::Keybind &Ui::current_keybind() {
+        if (resolved != nullptr && resolved_buffer == current_buffer &&
+            resolved_version == KeyHandling::keymap_version())
+            return *resolved;
+
+        KeyHandling::Keybind *mode = nullptr;
+        auto found = mode_keybinds.find(current_buffer->mode());
+        if (found != std::end(mode_keybinds) && !found->second.empty())
+            mode = &found->second;
+
+        if (mode == nullptr && current_buffer->keybind.empty()) {
+            resolved = &global_keybind;
+        } else {
+            /* Merge from the lowest layer so that higher ones override. */
+            resolved_keybind.clear();
+            resolved_keybind.merge(global_keybind);
+            if (mode != nullptr) resolved_keybind.merge(*mode);
+            resolved_keybind.merge(current_buffer->keybind);
+            resolved = &resolved_keybind;
+        }
+
+        resolved_buffer = current_buffer;
+        /* Merging changes version too, so take it at last. */
+        resolved_version = KeyHandling::keymap_version();
+
+        return *resolved;
+    }
 
-        Rune buf;
-        unsigned int n_byte;
-        bool broken;
-        for (;;) {
+    void Ui::dispatch_event(InputEvent &ev) {
+        /* Drawing leaves other windows' viewports in shared buffers. */
+        if (current_window != nullptr) current_window->activate();
+
+        switch (ev.type) {
+        case InputEvent::KEY:
+            KeyHandling::handle_key(*this, ev.key);
+            break;
+        case InputEvent::RUNE:
+            KeyHandling::handle_rune(*this, ev.rune);
+            break;
+        case InputEvent::PASTE:
+            KeyHandling::handle_paste(*this, ev.text);
+            break;
+        }
+    }
+
+    void Ui::dispatch_input() {
+        for (auto itr = std::begin(input_events);
+             itr != std::end(input_events); ++itr) {
             if (editor_exited) break;
 
-            redraw_editor();
-
-            unsigned char c = (unsigned char)term->get_char();
-            if ((c >> 7 & 0x1) == 0)
-                n_byte = 1;
-            else if ((c >> 5 & 0x7) == 0x6)
-                n_byte = 2;
-            else if ((c >> 4 & 0xf) == 0xe)
-                n_byte = 3;
-            else if ((c >> 3 & 0x1f) == 0x1e)
-                n_byte = 4;
-            else {
-                n_byte = 0;
+            if (recording_macro) macro_pending.push_back(*itr);
+
+            dispatch_event(*itr);
+
+            /* Sequence is done; keep it unless it stopped recording. */
+            if (recording_macro && KeyHandling::key_state == 0) {
+                macro.insert(std::end(macro), std::begin(macro_pending),
+                             std::end(macro_pending));
+                macro_pending.clear();
             }
+        }
+        input_events.clear();
+    }
 
-            if (n_byte == 1)
-                KeyHandling::handle_key(*this, c);
-            else if (1 < n_byte && n_byte <= 4) {
-                buf[0] = c;
+    bool Ui::set_grammar(Buffer &buf, std::string const &name) {
+        highlighters.erase(&buf);
+        if (name.empty()) return true;
 
-                broken = 0;
-                for (--n_byte; n_byte > 0; --n_byte) {
-                    c = (unsigned char)term->get_char();
-                    if ((c >> 6 & 0x3) != 0x2) {
-                        broken = 1;
+        Highlight::Lexer const *lexer = Highlight::grammar(name);
+        if (lexer == nullptr) return false;
 
-                        break;
-                    }
+        highlighters.emplace(&buf, Highlight::Highlighter(*lexer));
 
-                    buf[sizeof(Rune) - n_byte - 1] = c;
-                }
+        return true;
+    }
+
+    void Ui::highlight() {
+        bool done = true;
+        auto update = [this, &done](Buffer &buf) {
+            auto found = highlighters.find(&buf);
+            if (found == std::end(highlighters)) return;
+
+            std::size_t height =
+                buf.display_range_y_end - buf.display_range_y_start;
+            if (!found->second.update(buf, buf.visible_start_point,
+                                      height + HIGHLIGHT_LOOKAHEAD,
+                                      HIGHLIGHT_BUDGET))
+                done = false;
+        };
+
+        for (auto itr = std::begin(displayed_buffers);
+             itr != std::end(displayed_buffers); ++itr)
+            update(**itr);
+        for (auto itr = std::begin(windows); itr != std::end(windows); ++itr) {
+            (*itr)->activate();
+            update(*(*itr)->buffer());
+        }
+        if (current_window != nullptr) current_window->activate();
+
+        /* Wake the loop up again so that input is not blocked by a long
+         * work. */
+        if (!done && highlight_timer < 0)
+            highlight_timer = event_loop.add_timer(
+                0, false, [this]() { highlight_timer = -1; });
+    }
+
+    void Ui::start_macro() {
+        if (replaying_macro) return;
+
+        macro.clear();
+        macro_pending.clear();
+        recording_macro = true;
+        write_message("Defining keyboard macro...");
+    }
+
+    void Ui::stop_macro() {
+        if (!recording_macro) {
+            command_failed("Not defining keyboard macro");
+
+            return;
+        }
+
+        recording_macro = false;
+        macro_pending.clear();
+        write_message("Keyboard macro defined");
+    }
 
-                if (!broken) KeyHandling::handle_rune(*this, buf);
-                buf.fill(0);
+    bool Ui::replay_macro(std::size_t times) {
+        if (recording_macro || replaying_macro) {
+            command_failed("Keyboard macro cannot be replayed here");
+
+            return false;
+        }
+        if (macro.empty()) {
+            command_failed("No keyboard macro defined");
+
+            return false;
+        }
+
+        /* Cursor positions and listeners are caught up once at the end, and
+         * nothing is drawn until the command returns to the main loop. */
+        std::vector<Buffer *> held = buffers;
+        for (auto itr = std::begin(held); itr != std::end(held); ++itr)
+            (*itr)->hold_updates();
+
+        replaying_macro = true;
+        macro_failed = false;
+        /* Macro may be replaced by the commands in it. */
+        std::vector<InputEvent> events = macro;
+        for (std::size_t n = 0; times == 0 || n < times; ++n) {
+            Buffer *buf = current_buffer;
+            std::size_t point = buf->point;
+            std::size_t size = buf->buf_size - (buf->gap_end - buf->gap_start);
+
+            KeyHandling::key_state = 0;
+            for (auto itr = std::begin(events); itr != std::end(events);
+                 ++itr) {
+                if (macro_failed || editor_exited) break;
+
+                dispatch_event(*itr);
+            }
+            if (macro_failed || editor_exited) break;
+
+            /* Repeating forever would hang the editor. */
+            if (times == 0 && current_buffer == buf && buf->point == point &&
+                buf->buf_size - (buf->gap_end - buf->gap_start) == size)
+                break;
+        }
+        KeyHandling::key_state = 0;
+        replaying_macro = false;
+
+        for (auto itr = std::begin(held); itr != std::end(held); ++itr)
+            (*itr)->release_updates();
+
+        return !macro_failed;
+    }
+
+    void Ui::handle_input(std::uint32_t events) {
+        std::size_t len =
+            term->read_input(input_buffer.data(), input_buffer.size(), 0);
+
+        /* Hung up descriptor stays ready, so the loop would never sleep
+         * again. Input arrived before it is applied first. */
+        if ((events & (EPOLLHUP | EPOLLERR)) != 0 || term->input_closed()) {
+            if (len != 0) {
+                input_parser.feed(input_buffer.data(), len, input_events);
+                dispatch_input();
             }
+            flush_journals();
+            exit_editor();
+
+            return;
+        }
+        if (len == 0) return;
+
+        if (escape_timer >= 0) {
+            event_loop.cancel_timer(escape_timer);
+            escape_timer = -1;
         }
+
+        /* Apply everything arrived so far before next redraw. */
+        input_parser.feed(input_buffer.data(), len, input_events);
+        dispatch_input();
+
+        /* Lone ESC is held by the parser as it may start paste marker; wait
+         * only for a while for the rest. */
+        if (input_parser.pending()) {
+            escape_timer =
+                event_loop.add_timer(ESCAPE_TIMEOUT, false, [this]() {
+                    escape_timer = -1;
+                    input_parser.flush(input_events);
+                    dispatch_input();
+                });
+        }
+    }
+
+    void Ui::update_screen() {
+        Profile::Phase phase("update screen");
+        {
+            Profile::Phase delivering("deliver events");
+            events.deliver();
+        }
+        {
+            Profile::Phase highlighting("highlight");
+            highlight();
+        }
+        Profile::Phase redrawing("redraw_editor");
+        redraw_editor();
+    }
+
+    void Ui::watch_input() {
+        event_loop.add_fd(term->input_fd(), EPOLLIN,
+                          [this](std::uint32_t events) {
+                              handle_input(events);
+                          });
+    }
+
+    void Ui::main_loop() {
+        if (current_buffer == nullptr)
+            current_buffer = buffers[buffers.size() - 1];
+
+        editor_exited = false;
+        suspended = false;
+        int input_fd = term->input_fd();
+        watch_input();
+
+        while (!editor_exited) {
+            if (!suspended) {
+                update_screen();
+                Profile::startup_painted();
+            }
+            schedule_journal_flush();
+
+            event_loop.run_once(-1);
+        }
+        flush_journals();
+
+        event_loop.remove_fd(input_fd);
     }
 
 } // namespace Ked
@@ -0,0 +1,397 @@
+/*
+ * ked -- simple text editor with minimal dependency
+ * Copyright (C) 2019  Koki Fukuda
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+
+#include <ked/Rune.hh>
+#include <ked/Unicode.hh>
+
+#include "unicode_data.hh"
+
+namespace Ked {
+    namespace Unicode {
+        /* Width of every code point is looked up from two-level table built
+         * at compile time. The first level maps each block of 256 code
+         * points to a block in the second level, which holds 2-bit width of
+         * each code point. Blocks whose code points all have the same width
+         * share one of the first three blocks. */
+        namespace {
+            constexpr char32_t max_code_point = 0x10ffff;
+            constexpr unsigned int block_bits = 8;
+            constexpr std::size_t block_size = 1 << block_bits;
+            constexpr std::size_t n_blocks =
+                (max_code_point + 1) >> block_bits;
+            /* Bytes a block occupies in the second level. */
+            constexpr std::size_t block_bytes = block_size / 4;
+
+            template <typename T, std::size_t N>
+            constexpr std::size_t lower_bound(T const (&ranges)[N],
+                                              char32_t c) {
+                std::size_t lo = 0;
+                std::size_t hi = N;
+                while (lo < hi) {
+                    std::size_t mid = (lo + hi) / 2;
+                    if (ranges[mid].last < c)
+                        lo = mid + 1;
+                    else
+                        hi = mid;
+                }
+
+                return lo;
+            }
+
+            template <std::size_t N>
+            constexpr bool contains(Range const (&ranges)[N], char32_t c) {
+                std::size_t i = lower_bound(ranges, c);
+
+                return i < N && ranges[i].first <= c;
+            }
+
+            /* Returns number of code points in [first..last] contained in
+             * ranges. */
+            template <std::size_t N>
+            constexpr std::size_t coverage(Range const (&ranges)[N],
+                                           char32_t first, char32_t last) {
+                std::size_t n = 0;
+                for (std::size_t i = lower_bound(ranges, first);
+                     i < N && ranges[i].first <= last; ++i) {
+                    char32_t f = ranges[i].first < first ? first
+                                                         : ranges[i].first;
+                    char32_t l = ranges[i].last > last ? last : ranges[i].last;
+                    n += l - f + 1;
+                }
+
+                return n;
+            }
+
+            constexpr unsigned char table_width(char32_t c) {
+                if (contains(zero_width_ranges, c)) return 0;
+                if (contains(wide_ranges, c)) return 2;
+
+                return 1;
+            }
+
+            /* Returns the width shared by whole block, or 3 if it varies. */
+            constexpr unsigned char block_width(std::size_t block) {
+                char32_t first = block << block_bits;
+                char32_t last = first + block_size - 1;
+
+                std::size_t zero = coverage(zero_width_ranges, first, last);
+                std::size_t wide = coverage(wide_ranges, first, last);
+
+                if (zero == block_size) return 0;
+                if (wide == block_size) return 2;
+                if (zero == 0 && wide == 0) return 1;
+
+                return 3;
+            }
+
+            constexpr std::size_t count_mixed_blocks() {
+                std::size_t n = 0;
+                for (std::size_t b = 0; b < n_blocks; ++b)
+                    if (block_width(b) == 3) ++n;
+
+                return n;
+            }
+
+            constexpr std::size_t n_stage2_blocks = 3 + count_mixed_blocks();
+
+            struct WidthTable {
+                std::array<std::uint16_t, n_blocks> stage1;
+                std::array<std::uint8_t, n_stage2_blocks * block_bytes> stage2;
+            };
+
+            constexpr std::uint8_t fill_byte(unsigned char w) {
+                return w | w << 2 | w << 4 | w << 6;
+            }
+
+            constexpr WidthTable build_width_table() {
+                WidthTable t{};
+
+                /* Uniform blocks: 0 is width 1, 1 is width 2 and 2 is width
+                 * 0. */
+                for (std::size_t i = 0; i < block_bytes; ++i) {
+                    t.stage2[i] = fill_byte(1);
+                    t.stage2[block_bytes + i] = fill_byte(2);
+                    t.stage2[block_bytes * 2 + i] = fill_byte(0);
+                }
+
+                std::size_t next = 3;
+                for (std::size_t b = 0; b < n_blocks; ++b) {
+                    switch (block_width(b)) {
+                    case 1:
+                        t.stage1[b] = 0;
+                        break;
+                    case 2:
+                        t.stage1[b] = 1;
+                        break;
+                    case 0:
+                        t.stage1[b] = 2;
+                        break;
+                    default:
+                        t.stage1[b] = next;
+                        for (std::size_t i = 0; i < block_size; ++i) {
+                            char32_t c = (b << block_bits) + i;
+                            t.stage2[next * block_bytes + i / 4] |=
+                                table_width(c) << (i % 4 * 2);
+                        }
+                        ++next;
+                        break;
+                    }
+                }
+
+                return t;
+            }
+
+            constexpr WidthTable width_table = build_width_table();
+
+            /* Width of ASCII characters as print_char draws them. */
+            constexpr std::array<unsigned char, 128> build_ascii_width() {
+                std::array<unsigned char, 128> t{};
+                for (std::size_t i = 0; i < 128; ++i) {
+                    if (i == '\t')
+                        t[i] = 8;
+                    else if (i <= 0x1f)
+                        t[i] = 2;
+                    else
+                        t[i] = 1;
+                }
+
+                return t;
+            }
+
+            constexpr std::array<unsigned char, 128> ascii_width =
+                build_ascii_width();
+
+            /* Grapheme break property uses the same layout with 4 bits per
+             * code point. The first GB_EXTENDED_PICTOGRAPHIC + 1 blocks are
+             * uniform blocks of each property. */
+            constexpr std::size_t n_properties = GB_EXTENDED_PICTOGRAPHIC + 1;
+            constexpr std::size_t property_block_bytes = block_size / 2;
+
+            /* Returns the property shared by whole block, or -1 if it
+             * varies. */
+            constexpr int property_block(std::size_t block) {
+                char32_t first = block << block_bits;
+                char32_t last = first + block_size - 1;
+
+                std::size_t i = lower_bound(grapheme_break_ranges, first);
+                if (i == std::size(grapheme_break_ranges) ||
+                    grapheme_break_ranges[i].first > last)
+                    return GB_OTHER;
+                if (grapheme_break_ranges[i].first <= first &&
+                    grapheme_break_ranges[i].last >= last)
+                    return grapheme_break_ranges[i].prop;
+
+                return -1;
+            }
+
+            constexpr std::size_t count_mixed_property_blocks() {
+                std::size_t n = 0;
+                for (std::size_t b = 0; b < n_blocks; ++b)
+                    if (property_block(b) < 0) ++n;
+
+                return n;
+            }
+
+            constexpr std::size_t n_property_stage2_blocks =
+                n_properties + count_mixed_property_blocks();
+
+            struct PropertyTable {
+                std::array<std::uint16_t, n_blocks> stage1;
+                std::array<std::uint8_t, n_property_stage2_blocks *
+                                             property_block_bytes>
+                    stage2;
+            };
+
+            constexpr GraphemeBreak table_grapheme_break(char32_t c) {
+                std::size_t i = lower_bound(grapheme_break_ranges, c);
+                if (i < std::size(grapheme_break_ranges) &&
+                    grapheme_break_ranges[i].first <= c)
+                    return grapheme_break_ranges[i].prop;
+
+                return GB_OTHER;
+            }
+
+            constexpr PropertyTable build_property_table() {
+                PropertyTable t{};
+
+                for (std::size_t p = 0; p < n_properties; ++p)
+                    for (std::size_t i = 0; i < property_block_bytes; ++i)
+                        t.stage2[p * property_block_bytes + i] = p | p << 4;
+
+                std::size_t next = n_properties;
+                for (std::size_t b = 0; b < n_blocks; ++b) {
+                    int prop = property_block(b);
+                    if (prop >= 0) {
+                        t.stage1[b] = prop;
+
+                        continue;
+                    }
+
+                    t.stage1[b] = next;
+                    for (std::size_t i = 0; i < block_size; ++i) {
+                        char32_t c = (b << block_bits) + i;
+                        t.stage2[next * property_block_bytes + i / 2] |=
+                            table_grapheme_break(c) << (i % 2 * 4);
+                    }
+                    ++next;
+                }
+
+                return t;
+            }
+
+            constexpr PropertyTable grapheme_break_table =
+                build_property_table();
+
+            constexpr char32_t hangul_syllable_first = 0xac00;
+            constexpr char32_t hangul_syllable_last = 0xd7a3;
+            constexpr char32_t hangul_t_count = 28;
+        } // namespace
+
+        char32_t decode(Rune const &r) {
+            unsigned char c = r[0];
+            if (c < 0x80) return c;
+
+            std::size_t len;
+            char32_t result;
+            if ((c >> 5) == 0x6) {
+                len = 2;
+                result = c & 0x1f;
+            } else if ((c >> 4) == 0xe) {
+                len = 3;
+                result = c & 0x0f;
+            } else if ((c >> 3) == 0x1e) {
+                len = 4;
+                result = c & 0x07;
+            } else {
+                return replacement_character;
+            }
+
+            for (std::size_t i = 1; i < len; ++i) {
+                if ((r[i] >> 6) != 0x2) return replacement_character;
+                result = result << 6 | (r[i] & 0x3f);
+            }
+
+            if (result > max_code_point) return replacement_character;
+
+            return result;
+        }
+
+        unsigned char width(char32_t c) {
+            if (c < 0x80) return ascii_width[c];
+            if (c > max_code_point) return 1;
+
+            std::size_t block = width_table.stage1[c >> block_bits];
+            std::size_t i = c & (block_size - 1);
+
+            return width_table.stage2[block * block_bytes + i / 4] >>
+                       (i % 4 * 2) &
+                   0x3;
+        }
+
+        GraphemeBreak grapheme_break(char32_t c) {
+            if (c < 0x80) {
+                if (c == '\r') return GB_CR;
+                if (c == '\n') return GB_LF;
+                if (c <= 0x1f || c == 0x7f) return GB_CONTROL;
+
+                return GB_OTHER;
+            }
+            if (c > max_code_point) return GB_OTHER;
+
+            if (hangul_syllable_first <= c && c <= hangul_syllable_last)
+                return (c - hangul_syllable_first) % hangul_t_count == 0
+                           ? GB_LV
+                           : GB_LVT;
+
+            std::size_t block = grapheme_break_table.stage1[c >> block_bits];
+            std::size_t i = c & (block_size - 1);
+
+            return (GraphemeBreak)(grapheme_break_table
+                                           .stage2[block *
+                                                       property_block_bytes +
+                                                   i / 2] >>
+                                       (i % 2 * 4) &
+                                   0xf);
+        }
+
+        void grapheme_begin(GraphemeState &state, GraphemeBreak first) {
+            state.prev = first;
+            state.pictographic = first == GB_EXTENDED_PICTOGRAPHIC;
+            state.odd_regional_indicator = first == GB_REGIONAL_INDICATOR;
+        }
+
+        static bool is_control(GraphemeBreak p) {
+            return p == GB_CR || p == GB_LF || p == GB_CONTROL;
+        }
+
+        bool grapheme_break_before(GraphemeState &state, GraphemeBreak next) {
+            GraphemeBreak prev = state.prev;
+
+            /* Rules are numbered as in UAX #29. */
+            bool boundary;
+            if (prev == GB_CR && next == GB_LF)
+                boundary = false; /* GB3 */
+            else if (is_control(prev) || is_control(next))
+                boundary = true; /* GB4, GB5 */
+            else if (prev == GB_L && (next == GB_L || next == GB_V ||
+                                      next == GB_LV || next == GB_LVT))
+                boundary = false; /* GB6 */
+            else if ((prev == GB_LV || prev == GB_V) &&
+                     (next == GB_V || next == GB_T))
+                boundary = false; /* GB7 */
+            else if ((prev == GB_LVT || prev == GB_T) && next == GB_T)
+                boundary = false; /* GB8 */
+            else if (next == GB_EXTEND || next == GB_ZWJ ||
+                     next == GB_SPACING_MARK || prev == GB_PREPEND)
+                boundary = false; /* GB9, GB9a, GB9b */
+            else if (prev == GB_ZWJ && next == GB_EXTENDED_PICTOGRAPHIC &&
+                     state.pictographic)
+                boundary = false; /* GB11 */
+            else if (prev == GB_REGIONAL_INDICATOR &&
+                     next == GB_REGIONAL_INDICATOR &&
+                     state.odd_regional_indicator)
+                boundary = false; /* GB12, GB13 */
+            else
+                boundary = true; /* GB999 */
+
+            if (boundary) {
+                grapheme_begin(state, next);
+
+                return true;
+            }
+
+            if (next == GB_EXTENDED_PICTOGRAPHIC)
+                state.pictographic = true;
+            else if (next != GB_EXTEND && next != GB_ZWJ)
+                state.pictographic = false;
+            else if (prev == GB_ZWJ)
+                state.pictographic = false;
+
+            state.odd_regional_indicator =
+                next == GB_REGIONAL_INDICATOR && !state.odd_regional_indicator;
+            state.prev = next;
+
+            return false;
+        }
+    } // namespace Unicode
+} // namespace Ked
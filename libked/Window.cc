@@ -0,0 +1,83 @@
+/*
+ * ked -- simple text editor with minimal dependency
+ * Copyright (C) 2019  Koki Fukuda
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <cstddef>
+
+#include <ked/Buffer.hh>
+#include <ked/Window.hh>
+
+namespace Ked {
+    Window::Window(Buffer *buf) : buf(buf), drawn_valid(false) {
+        buf->add_view(view);
+    }
+
+    Window::~Window() { buf->remove_view(view); }
+
+    Buffer *Window::buffer() const { return buf; }
+
+    void Window::set_buffer(Buffer *new_buf) {
+        if (new_buf == buf) return;
+
+        buf->remove_view(view);
+        buf = new_buf;
+        buf->add_view(view);
+        drawn_valid = false;
+    }
+
+    void Window::activate() { buf->use_view(view); }
+
+    void Window::set_display_range(std::size_t x_start, std::size_t x_end,
+                                   std::size_t y_start, std::size_t y_end) {
+        activate();
+        buf->set_display_range(x_start, x_end, y_start, y_end);
+        drawn_valid = false;
+    }
+
+    bool Window::needs_redraw() const {
+        /* Cursor is placed apart from drawing, so moving it alone does not
+         * need redraw unless it scrolls. */
+        return !drawn_valid || drawn.buf != buf ||
+               drawn.version != buf->version ||
+               drawn.paint_version != buf->paint_version ||
+               drawn.default_face != buf->default_face ||
+               drawn.visible_start_point != buf->visible_start_point ||
+               drawn.scroll_x != buf->scroll_x ||
+               drawn.truncate_lines != buf->truncate_lines ||
+               drawn.display_range_x_start != buf->display_range_x_start ||
+               drawn.display_range_x_end != buf->display_range_x_end ||
+               drawn.display_range_y_start != buf->display_range_y_start ||
+               drawn.display_range_y_end != buf->display_range_y_end;
+    }
+
+    void Window::mark_drawn() {
+        drawn.buf = buf;
+        drawn.version = buf->version;
+        drawn.paint_version = buf->paint_version;
+        drawn.default_face = buf->default_face;
+        drawn.visible_start_point = buf->visible_start_point;
+        drawn.scroll_x = buf->scroll_x;
+        drawn.truncate_lines = buf->truncate_lines;
+        drawn.display_range_x_start = buf->display_range_x_start;
+        drawn.display_range_x_end = buf->display_range_x_end;
+        drawn.display_range_y_start = buf->display_range_y_start;
+        drawn.display_range_y_end = buf->display_range_y_end;
+        drawn_valid = true;
+    }
+
+    void Window::mark_dirty() { drawn_valid = false; }
+} // namespace Ked
@@ -16,19 +16,50 @@
 
 #include <algorithm>
 #include <array>
+#include <cerrno>
+#include <cstdint>
 #include <cstdio>
+#include <cstring>
 #include <fstream>
 #include <iostream>
+#include <string>
 #include <unistd.h>
 #include <vector>
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
 #include <ked/Buffer.hh>
 #include <ked/Rune.hh>
+#include <ked/Unicode.hh>
 
 #include "libked.hh"
 
+/* Image starts with ImageHeader padded to this size, so that runes after it
+ * are aligned to pages. */
+#define IMAGE_HEADER_SIZE 4096
+/* Runes copied to write image at once. */
+#define IMAGE_WRITE_CHUNK 65536
+
 namespace Ked {
     namespace IO {
+        /* Header of image, which is followed by gap_size runes of gap and
+         * n_runes runes of text. */
+        struct ImageHeader {
+            char magic[8];
+            std::uint32_t rune_size;
+            std::uint32_t lend;
+            /* Size and modification time of the file the text is of. */
+            std::uint64_t file_size;
+            std::int64_t mtime_sec;
+            std::int64_t mtime_nsec;
+            std::uint64_t gap_size;
+            std::uint64_t n_runes;
+        };
+
+        static char const image_magic[8] = {'K', 'E', 'D', 'I',
+                                            'M', 'G', '0', '1'};
 
         /* Converts given buffer's line ending character to lf, and returnes
          * converted buffer. This function may allocate new buffer to store
@@ -77,47 +108,97 @@ namespace Ked {
             return result;
         }
 
-        /* Converts char array to an array of AttrRune. */
-        static AttrRune *convert_to_rune_array(char *buf, size_t *len,
-                                               size_t gap_size) {
-            size_t n_rune = 0;
-            for (size_t i = 0; i < *len; ++i) {
+        std::size_t count_runes(char const *buf, std::size_t len) {
+            std::size_t n_rune = 0;
+            for (std::size_t i = 0; i < len; ++i) {
                 if (buf[i] >> 7 == 0 || (buf[i] >> 6 & 0x3) == 0x3) ++n_rune;
             }
 
-            AttrRune *result = new AttrRune[n_rune + gap_size];
+            return n_rune;
+        }
 
-            size_t res_i = gap_size;
-            std::array<char, 4> rune_buf;
-            rune_buf.fill(0);
-            int rune_i = 0;
-            for (size_t i = 0; i < *len; ++i) {
-                if (buf[i] >> 7 == 0 || (buf[i] >> 6 & 0x3) == 0x3) {
-                    if (rune_i != 0) {
-                        // FIXME: check if the rune is valid or not.
-                        std::copy(std::begin(rune_buf), std::end(rune_buf),
-                                  std::begin(result[res_i].c));
-                        rune_buf.fill(0);
-                        rune_i = 0;
-                        ++res_i;
-                    }
+        static inline void set_ascii(AttrRune &r, unsigned char c) {
+            r.c[0] = c;
+            r.c[1] = 0;
+            r.c[2] = 0;
+            r.c[3] = 0;
+            r.display_width = Unicode::width(c);
+            r.attrs = 0;
+            r.face = FACE_ID_DEFAULT;
+        }
+
+        std::size_t decode_utf8(char const *buf, std::size_t len,
+                                AttrRune *out) {
+            std::size_t res_i = 0;
+            std::size_t i = 0;
+            while (i < len) {
+                /* Most of text is a run of ASCII characters; check 8 bytes
+                 * at once and skip decoding for them. */
+                while (i + 8 <= len) {
+                    std::uint64_t chunk;
+                    std::memcpy(&chunk, buf + i, sizeof(chunk));
+                    if ((chunk & 0x8080808080808080ULL) != 0) break;
+
+                    for (std::size_t j = 0; j < 8; ++j)
+                        set_ascii(out[res_i + j], buf[i + j]);
+                    res_i += 8;
+                    i += 8;
+                }
+                if (i >= len) break;
+
+                unsigned char c = buf[i++];
+                if (c < 0x80) {
+                    set_ascii(out[res_i++], c);
+
+                    continue;
+                }
 
-                    rune_buf[rune_i] = buf[i];
-                    ++rune_i;
-                } else if (1 <= rune_i && rune_i < (int)sizeof(rune_buf) &&
-                           (buf[i] >> 6 & 0x3) == 0x2) {
-                    rune_buf[rune_i] = buf[i];
-                    ++rune_i;
+                // FIXME: broken utf-8 buffer.
+                if ((c >> 6 & 0x3) != 0x3) continue;
+
+                /* Decode the code point while copying the bytes so that
+                 * width is known without decoding the rune again. */
+                AttrRune &r = out[res_i++];
+                r.c.fill(0);
+                r.c[0] = c;
+
+                std::size_t need;
+                char32_t code_point;
+                if ((c >> 5) == 0x6) {
+                    need = 2;
+                    code_point = c & 0x1f;
+                } else if ((c >> 4) == 0xe) {
+                    need = 3;
+                    code_point = c & 0x0f;
                 } else {
-                    // FIXME: broken utf-8 buffer.
+                    need = (c >> 3) == 0x1e ? 4 : 0;
+                    code_point = c & 0x07;
+                }
+
+                std::size_t n = 1;
+                while (n < r.c.size() && i < len &&
+                       ((unsigned char)buf[i] >> 6 & 0x3) == 0x2) {
+                    r.c[n++] = buf[i];
+                    code_point = code_point << 6 | (buf[i] & 0x3f);
+                    ++i;
                 }
+                if (n != need) code_point = Unicode::replacement_character;
+
+                r.display_width = Unicode::width(code_point);
+                r.attrs = 0;
+                r.face = FACE_ID_DEFAULT;
             }
-            if (rune_i != 0)
-                std::copy(std::begin(rune_buf), std::end(rune_buf),
-                          std::begin(result[res_i].c));
 
-            for (size_t i = 0; i < n_rune; ++i)
-                result[gap_size + i].calculate_width();
+            return res_i;
+        }
+
+        /* Converts char array to an array of AttrRune. */
+        static AttrRune *convert_to_rune_array(char *buf, size_t *len,
+                                               size_t gap_size) {
+            size_t n_rune = count_runes(buf, *len);
+
+            AttrRune *result = new AttrRune[n_rune + gap_size];
+            decode_utf8(buf, *len, result + gap_size);
 
             *len = n_rune + gap_size;
 
@@ -217,6 +298,147 @@ namespace Ked {
             return result;
         }
 
+        /* Reads header of image fd and returns true if it holds the text of
+         * the file of mtime and size as a whole. */
+        static bool read_image_header(int fd, struct timespec const &mtime,
+                                      std::size_t file_size,
+                                      ImageHeader *header) {
+            struct stat stat_buf;
+            if (pread(fd, header, sizeof(*header), 0) != sizeof(*header) ||
+                fstat(fd, &stat_buf) != 0)
+                return false;
+
+            return std::memcmp(header->magic, image_magic,
+                               sizeof(image_magic)) == 0 &&
+                   header->rune_size == sizeof(AttrRune) &&
+                   header->lend <= LEND_CRLF &&
+                   header->file_size == file_size &&
+                   header->mtime_sec == mtime.tv_sec &&
+                   header->mtime_nsec == mtime.tv_nsec &&
+                   (std::uint64_t)stat_buf.st_size ==
+                       IMAGE_HEADER_SIZE +
+                           (header->gap_size + header->n_runes) *
+                               sizeof(AttrRune);
+        }
+
+        AttrRune *map_image(std::string const &path,
+                            struct timespec const &mtime,
+                            std::size_t file_size, std::size_t *len,
+                            std::size_t *gap_size, enum LineEnding *lend,
+                            void **mapping, std::size_t *mapping_size) {
+            int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd < 0) return nullptr;
+
+            ImageHeader header;
+            std::size_t size = 0;
+            void *m = MAP_FAILED;
+            if (read_image_header(fd, mtime, file_size, &header)) {
+                size = IMAGE_HEADER_SIZE +
+                       (header.gap_size + header.n_runes) * sizeof(AttrRune);
+                /* Private mapping lets the text be edited in place, copying
+                 * only pages written. */
+                m = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE,
+                         fd, 0);
+            }
+            close(fd);
+            if (m == MAP_FAILED) return nullptr;
+
+            *len = header.gap_size + header.n_runes;
+            *gap_size = header.gap_size;
+            *lend = (enum LineEnding)header.lend;
+            *mapping = m;
+            *mapping_size = size;
+
+            return (AttrRune *)((char *)m + IMAGE_HEADER_SIZE);
+        }
+
+        static bool write_all(int fd, void const *buf, std::size_t len) {
+            char const *p = (char const *)buf;
+            while (len > 0) {
+                ssize_t n = write(fd, p, len);
+                if (n < 0) {
+                    if (errno == EINTR) continue;
+
+                    return false;
+                }
+                p += n;
+                len -= n;
+            }
+
+            return true;
+        }
+
+        bool write_image(Buffer const &buf, std::string const &path) {
+            std::size_t n_runes = buf.buf_size - (buf.gap_end - buf.gap_start);
+
+            ImageHeader header;
+            int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd >= 0) {
+                bool up_to_date = read_image_header(fd, buf.file_mtime,
+                                                    buf.file_size, &header) &&
+                                  header.n_runes == n_runes;
+                close(fd);
+                if (up_to_date) return true;
+            }
+
+            std::memset(&header, 0, sizeof(header));
+            std::memcpy(header.magic, image_magic, sizeof(image_magic));
+            header.rune_size = sizeof(AttrRune);
+            header.lend = buf.lend;
+            header.file_size = buf.file_size;
+            header.mtime_sec = buf.file_mtime.tv_sec;
+            header.mtime_nsec = buf.file_mtime.tv_nsec;
+            header.gap_size = INIT_GAP_SIZE;
+            header.n_runes = n_runes;
+
+            /* Image may be mapped by buffers, which must keep the old one
+             * rather than seeing it rewritten. */
+            std::string tmp_path = path + ".tmp";
+            fd = open(tmp_path.c_str(),
+                      O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+            if (fd < 0) return false;
+
+            std::vector<char> head(IMAGE_HEADER_SIZE, 0);
+            std::memcpy(head.data(), &header, sizeof(header));
+            bool success = write_all(fd, head.data(), head.size()) &&
+                           lseek(fd, INIT_GAP_SIZE * sizeof(AttrRune),
+                                 SEEK_CUR) >= 0;
+
+            /* Faces are given by highlighters of the next session, whose
+             * face IDs may differ. */
+            std::vector<AttrRune> chunk(IMAGE_WRITE_CHUNK);
+            std::size_t p = 0;
+            while (success && p < buf.buf_size) {
+                if (p == buf.gap_start) p = buf.gap_end;
+                std::size_t end = p < buf.gap_start ? buf.gap_start
+                                                    : buf.buf_size;
+                std::size_t n = std::min<std::size_t>(end - p, chunk.size());
+                for (std::size_t i = 0; i < n; ++i) {
+                    chunk[i] = buf.content[p + i];
+                    chunk[i].face = FACE_ID_DEFAULT;
+                }
+
+                success = write_all(fd, chunk.data(), n * sizeof(AttrRune));
+                p += n;
+            }
+
+            /* Gap is left as a hole, which stays so at the end if there is
+             * no text. */
+            success = success &&
+                      ftruncate(fd, IMAGE_HEADER_SIZE +
+                                        (INIT_GAP_SIZE + n_runes) *
+                                            sizeof(AttrRune)) == 0;
+            if (close(fd) != 0) success = false;
+
+            if (!success || rename(tmp_path.c_str(), path.c_str()) != 0) {
+                unlink(tmp_path.c_str());
+
+                return false;
+            }
+
+            return true;
+        }
+
         bool save_buffer_utf8(Buffer const &buf) {
             if (buf.path == "") return 0;
 
@@ -19,7 +19,9 @@
 #ifndef LIBKED_HH
 #define LIBKED_HH
 
+#include <ctime>
 #include <fstream>
+#include <string>
 
 #include <ked/Buffer.hh>
 #include <ked/Rune.hh>
@@ -38,6 +40,29 @@ namespace Ked {
         AttrRune *create_content_buffer_stdin(size_t gap_size, size_t *len,
                                               enum LineEnding *lend);
 
+        /* Counts characters in UTF-8 buf. */
+        std::size_t count_runes(char const *buf, std::size_t len);
+
+        /* Decodes UTF-8 buf into out, which must have room for
+         * count_runes(buf, len) runes, and calculates their width. Returns
+         * the number of runes written. */
+        std::size_t decode_utf8(char const *buf, std::size_t len,
+                                AttrRune *out);
+
+        /* Maps image at path if it holds the text of the file of mtime and
+         * file_size, and returns the runes with gap at the start. Length of
+         * the array, the gap, line ending and the mapping are stored to the
+         * pointers. Returns nullptr if the image is missing or stale. */
+        AttrRune *map_image(std::string const &path,
+                            struct timespec const &mtime,
+                            std::size_t file_size, std::size_t *len,
+                            std::size_t *gap_size, enum LineEnding *lend,
+                            void **mapping, std::size_t *mapping_size);
+
+        /* Writes the text of buf to image at path, recording file_mtime and
+         * file_size of buf. Image already holding it is kept. */
+        bool write_image(Buffer const &buf, std::string const &path);
+
         /* Saves buffer as UTF-8 text file. */
         bool save_buffer_utf8(Buffer const &buf);
 
@@ -0,0 +1,822 @@
+/*
+ * ked -- simple text editor with minimal dependency
+ * Copyright (C) 2019  Koki Fukuda
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef LIBKED_UNICODE_DATA_HH
+#define LIBKED_UNICODE_DATA_HH
+
+#include <ked/Unicode.hh>
+
+/* Code point ranges derived from Unicode 14.0.0 character database. Each
+ * table is sorted and has no overlap. Unassigned code points surrounded by
+ * the same class are merged into the range, and unassigned ones in CJK
+ * ideograph blocks are taken as wide as EastAsianWidth.txt defaults. */
+
+namespace Ked {
+    namespace Unicode {
+        struct Range {
+            char32_t first;
+            char32_t last;
+        };
+
+        struct PropertyRange {
+            char32_t first;
+            char32_t last;
+            GraphemeBreak prop;
+        };
+
+        /* East_Asian_Width is W or F. */
+        constexpr Range wide_ranges[] = {
+            {0x1100, 0x115f}, {0x231a, 0x231b}, {0x2329, 0x232a},
+            {0x23e9, 0x23ec}, {0x23f0, 0x23f0}, {0x23f3, 0x23f3},
+            {0x25fd, 0x25fe}, {0x2614, 0x2615}, {0x2648, 0x2653},
+            {0x267f, 0x267f}, {0x2693, 0x2693}, {0x26a1, 0x26a1},
+            {0x26aa, 0x26ab}, {0x26bd, 0x26be}, {0x26c4, 0x26c5},
+            {0x26ce, 0x26ce}, {0x26d4, 0x26d4}, {0x26ea, 0x26ea},
+            {0x26f2, 0x26f3}, {0x26f5, 0x26f5}, {0x26fa, 0x26fa},
+            {0x26fd, 0x26fd}, {0x2705, 0x2705}, {0x270a, 0x270b},
+            {0x2728, 0x2728}, {0x274c, 0x274c}, {0x274e, 0x274e},
+            {0x2753, 0x2755}, {0x2757, 0x2757}, {0x2795, 0x2797},
+            {0x27b0, 0x27b0}, {0x27bf, 0x27bf}, {0x2b1b, 0x2b1c},
+            {0x2b50, 0x2b50}, {0x2b55, 0x2b55}, {0x2e80, 0x3029},
+            {0x302e, 0x303e}, {0x3041, 0x3096}, {0x309b, 0x3247},
+            {0x3250, 0x4dbf}, {0x4e00, 0xa4c6}, {0xa960, 0xa97c},
+            {0xac00, 0xd7a3}, {0xf900, 0xfaff}, {0xfe10, 0xfe19},
+            {0xfe30, 0xfe6b}, {0xff01, 0xff60}, {0xffe0, 0xffe6},
+            {0x16fe0, 0x16fe3}, {0x16ff0, 0x1b2fb}, {0x1f004, 0x1f004},
+            {0x1f0cf, 0x1f0cf}, {0x1f18e, 0x1f18e}, {0x1f191, 0x1f19a},
+            {0x1f200, 0x1f320}, {0x1f32d, 0x1f335}, {0x1f337, 0x1f37c},
+            {0x1f37e, 0x1f393}, {0x1f3a0, 0x1f3ca}, {0x1f3cf, 0x1f3d3},
+            {0x1f3e0, 0x1f3f0}, {0x1f3f4, 0x1f3f4}, {0x1f3f8, 0x1f43e},
+            {0x1f440, 0x1f440}, {0x1f442, 0x1f4fc}, {0x1f4ff, 0x1f53d},
+            {0x1f54b, 0x1f54e}, {0x1f550, 0x1f567}, {0x1f57a, 0x1f57a},
+            {0x1f595, 0x1f596}, {0x1f5a4, 0x1f5a4}, {0x1f5fb, 0x1f64f},
+            {0x1f680, 0x1f6c5}, {0x1f6cc, 0x1f6cc}, {0x1f6d0, 0x1f6d2},
+            {0x1f6d5, 0x1f6df}, {0x1f6eb, 0x1f6ec}, {0x1f6f4, 0x1f6fc},
+            {0x1f7e0, 0x1f7f0}, {0x1f90c, 0x1f93a}, {0x1f93c, 0x1f945},
+            {0x1f947, 0x1f9ff}, {0x1fa70, 0x1faf6}, {0x20000, 0x3fffd},
+        };
+
+        /* General_Category is Mn, Me or Cf (except U+00AD), or Hangul
+         * medial vowel and final consonant. */
+        constexpr Range zero_width_ranges[] = {
+            {0x0300, 0x036f}, {0x0483, 0x0489}, {0x0591, 0x05bd},
+            {0x05bf, 0x05bf}, {0x05c1, 0x05c2}, {0x05c4, 0x05c5},
+            {0x05c7, 0x05c7}, {0x0600, 0x0605}, {0x0610, 0x061a},
+            {0x061c, 0x061c}, {0x064b, 0x065f}, {0x0670, 0x0670},
+            {0x06d6, 0x06dd}, {0x06df, 0x06e4}, {0x06e7, 0x06e8},
+            {0x06ea, 0x06ed}, {0x070f, 0x070f}, {0x0711, 0x0711},
+            {0x0730, 0x074a}, {0x07a6, 0x07b0}, {0x07eb, 0x07f3},
+            {0x07fd, 0x07fd}, {0x0816, 0x0819}, {0x081b, 0x0823},
+            {0x0825, 0x0827}, {0x0829, 0x082d}, {0x0859, 0x085b},
+            {0x0890, 0x089f}, {0x08ca, 0x0902}, {0x093a, 0x093a},
+            {0x093c, 0x093c}, {0x0941, 0x0948}, {0x094d, 0x094d},
+            {0x0951, 0x0957}, {0x0962, 0x0963}, {0x0981, 0x0981},
+            {0x09bc, 0x09bc}, {0x09c1, 0x09c4}, {0x09cd, 0x09cd},
+            {0x09e2, 0x09e3}, {0x09fe, 0x0a02}, {0x0a3c, 0x0a3c},
+            {0x0a41, 0x0a51}, {0x0a70, 0x0a71}, {0x0a75, 0x0a75},
+            {0x0a81, 0x0a82}, {0x0abc, 0x0abc}, {0x0ac1, 0x0ac8},
+            {0x0acd, 0x0acd}, {0x0ae2, 0x0ae3}, {0x0afa, 0x0b01},
+            {0x0b3c, 0x0b3c}, {0x0b3f, 0x0b3f}, {0x0b41, 0x0b44},
+            {0x0b4d, 0x0b56}, {0x0b62, 0x0b63}, {0x0b82, 0x0b82},
+            {0x0bc0, 0x0bc0}, {0x0bcd, 0x0bcd}, {0x0c00, 0x0c00},
+            {0x0c04, 0x0c04}, {0x0c3c, 0x0c3c}, {0x0c3e, 0x0c40},
+            {0x0c46, 0x0c56}, {0x0c62, 0x0c63}, {0x0c81, 0x0c81},
+            {0x0cbc, 0x0cbc}, {0x0cbf, 0x0cbf}, {0x0cc6, 0x0cc6},
+            {0x0ccc, 0x0ccd}, {0x0ce2, 0x0ce3}, {0x0d00, 0x0d01},
+            {0x0d3b, 0x0d3c}, {0x0d41, 0x0d44}, {0x0d4d, 0x0d4d},
+            {0x0d62, 0x0d63}, {0x0d81, 0x0d81}, {0x0dca, 0x0dca},
+            {0x0dd2, 0x0dd6}, {0x0e31, 0x0e31}, {0x0e34, 0x0e3a},
+            {0x0e47, 0x0e4e}, {0x0eb1, 0x0eb1}, {0x0eb4, 0x0ebc},
+            {0x0ec8, 0x0ecd}, {0x0f18, 0x0f19}, {0x0f35, 0x0f35},
+            {0x0f37, 0x0f37}, {0x0f39, 0x0f39}, {0x0f71, 0x0f7e},
+            {0x0f80, 0x0f84}, {0x0f86, 0x0f87}, {0x0f8d, 0x0fbc},
+            {0x0fc6, 0x0fc6}, {0x102d, 0x1030}, {0x1032, 0x1037},
+            {0x1039, 0x103a}, {0x103d, 0x103e}, {0x1058, 0x1059},
+            {0x105e, 0x1060}, {0x1071, 0x1074}, {0x1082, 0x1082},
+            {0x1085, 0x1086}, {0x108d, 0x108d}, {0x109d, 0x109d},
+            {0x1160, 0x11ff}, {0x135d, 0x135f}, {0x1712, 0x1714},
+            {0x1732, 0x1733}, {0x1752, 0x1753}, {0x1772, 0x1773},
+            {0x17b4, 0x17b5}, {0x17b7, 0x17bd}, {0x17c6, 0x17c6},
+            {0x17c9, 0x17d3}, {0x17dd, 0x17dd}, {0x180b, 0x180f},
+            {0x1885, 0x1886}, {0x18a9, 0x18a9}, {0x1920, 0x1922},
+            {0x1927, 0x1928}, {0x1932, 0x1932}, {0x1939, 0x193b},
+            {0x1a17, 0x1a18}, {0x1a1b, 0x1a1b}, {0x1a56, 0x1a56},
+            {0x1a58, 0x1a60}, {0x1a62, 0x1a62}, {0x1a65, 0x1a6c},
+            {0x1a73, 0x1a7f}, {0x1ab0, 0x1b03}, {0x1b34, 0x1b34},
+            {0x1b36, 0x1b3a}, {0x1b3c, 0x1b3c}, {0x1b42, 0x1b42},
+            {0x1b6b, 0x1b73}, {0x1b80, 0x1b81}, {0x1ba2, 0x1ba5},
+            {0x1ba8, 0x1ba9}, {0x1bab, 0x1bad}, {0x1be6, 0x1be6},
+            {0x1be8, 0x1be9}, {0x1bed, 0x1bed}, {0x1bef, 0x1bf1},
+            {0x1c2c, 0x1c33}, {0x1c36, 0x1c37}, {0x1cd0, 0x1cd2},
+            {0x1cd4, 0x1ce0}, {0x1ce2, 0x1ce8}, {0x1ced, 0x1ced},
+            {0x1cf4, 0x1cf4}, {0x1cf8, 0x1cf9}, {0x1dc0, 0x1dff},
+            {0x200b, 0x200f}, {0x202a, 0x202e}, {0x2060, 0x206f},
+            {0x20d0, 0x20f0}, {0x2cef, 0x2cf1}, {0x2d7f, 0x2d7f},
+            {0x2de0, 0x2dff}, {0x302a, 0x302d}, {0x3099, 0x309a},
+            {0xa66f, 0xa672}, {0xa674, 0xa67d}, {0xa69e, 0xa69f},
+            {0xa6f0, 0xa6f1}, {0xa802, 0xa802}, {0xa806, 0xa806},
+            {0xa80b, 0xa80b}, {0xa825, 0xa826}, {0xa82c, 0xa82c},
+            {0xa8c4, 0xa8c5}, {0xa8e0, 0xa8f1}, {0xa8ff, 0xa8ff},
+            {0xa926, 0xa92d}, {0xa947, 0xa951}, {0xa980, 0xa982},
+            {0xa9b3, 0xa9b3}, {0xa9b6, 0xa9b9}, {0xa9bc, 0xa9bd},
+            {0xa9e5, 0xa9e5}, {0xaa29, 0xaa2e}, {0xaa31, 0xaa32},
+            {0xaa35, 0xaa36}, {0xaa43, 0xaa43}, {0xaa4c, 0xaa4c},
+            {0xaa7c, 0xaa7c}, {0xaab0, 0xaab0}, {0xaab2, 0xaab4},
+            {0xaab7, 0xaab8}, {0xaabe, 0xaabf}, {0xaac1, 0xaac1},
+            {0xaaec, 0xaaed}, {0xaaf6, 0xaaf6}, {0xabe5, 0xabe5},
+            {0xabe8, 0xabe8}, {0xabed, 0xabed}, {0xd7b0, 0xd7fb},
+            {0xfb1e, 0xfb1e}, {0xfe00, 0xfe0f}, {0xfe20, 0xfe2f},
+            {0xfeff, 0xfeff}, {0xfff9, 0xfffb}, {0x101fd, 0x101fd},
+            {0x102e0, 0x102e0}, {0x10376, 0x1037a}, {0x10a01, 0x10a0f},
+            {0x10a38, 0x10a3f}, {0x10ae5, 0x10ae6}, {0x10d24, 0x10d27},
+            {0x10eab, 0x10eac}, {0x10f46, 0x10f50}, {0x10f82, 0x10f85},
+            {0x11001, 0x11001}, {0x11038, 0x11046}, {0x11070, 0x11070},
+            {0x11073, 0x11074}, {0x1107f, 0x11081}, {0x110b3, 0x110b6},
+            {0x110b9, 0x110ba}, {0x110bd, 0x110bd}, {0x110c2, 0x110cd},
+            {0x11100, 0x11102}, {0x11127, 0x1112b}, {0x1112d, 0x11134},
+            {0x11173, 0x11173}, {0x11180, 0x11181}, {0x111b6, 0x111be},
+            {0x111c9, 0x111cc}, {0x111cf, 0x111cf}, {0x1122f, 0x11231},
+            {0x11234, 0x11234}, {0x11236, 0x11237}, {0x1123e, 0x1123e},
+            {0x112df, 0x112df}, {0x112e3, 0x112ea}, {0x11300, 0x11301},
+            {0x1133b, 0x1133c}, {0x11340, 0x11340}, {0x11366, 0x11374},
+            {0x11438, 0x1143f}, {0x11442, 0x11444}, {0x11446, 0x11446},
+            {0x1145e, 0x1145e}, {0x114b3, 0x114b8}, {0x114ba, 0x114ba},
+            {0x114bf, 0x114c0}, {0x114c2, 0x114c3}, {0x115b2, 0x115b5},
+            {0x115bc, 0x115bd}, {0x115bf, 0x115c0}, {0x115dc, 0x115dd},
+            {0x11633, 0x1163a}, {0x1163d, 0x1163d}, {0x1163f, 0x11640},
+            {0x116ab, 0x116ab}, {0x116ad, 0x116ad}, {0x116b0, 0x116b5},
+            {0x116b7, 0x116b7}, {0x1171d, 0x1171f}, {0x11722, 0x11725},
+            {0x11727, 0x1172b}, {0x1182f, 0x11837}, {0x11839, 0x1183a},
+            {0x1193b, 0x1193c}, {0x1193e, 0x1193e}, {0x11943, 0x11943},
+            {0x119d4, 0x119db}, {0x119e0, 0x119e0}, {0x11a01, 0x11a0a},
+            {0x11a33, 0x11a38}, {0x11a3b, 0x11a3e}, {0x11a47, 0x11a47},
+            {0x11a51, 0x11a56}, {0x11a59, 0x11a5b}, {0x11a8a, 0x11a96},
+            {0x11a98, 0x11a99}, {0x11c30, 0x11c3d}, {0x11c3f, 0x11c3f},
+            {0x11c92, 0x11ca7}, {0x11caa, 0x11cb0}, {0x11cb2, 0x11cb3},
+            {0x11cb5, 0x11cb6}, {0x11d31, 0x11d45}, {0x11d47, 0x11d47},
+            {0x11d90, 0x11d91}, {0x11d95, 0x11d95}, {0x11d97, 0x11d97},
+            {0x11ef3, 0x11ef4}, {0x13430, 0x13438}, {0x16af0, 0x16af4},
+            {0x16b30, 0x16b36}, {0x16f4f, 0x16f4f}, {0x16f8f, 0x16f92},
+            {0x16fe4, 0x16fe4}, {0x1bc9d, 0x1bc9e}, {0x1bca0, 0x1cf46},
+            {0x1d167, 0x1d169}, {0x1d173, 0x1d182}, {0x1d185, 0x1d18b},
+            {0x1d1aa, 0x1d1ad}, {0x1d242, 0x1d244}, {0x1da00, 0x1da36},
+            {0x1da3b, 0x1da6c}, {0x1da75, 0x1da75}, {0x1da84, 0x1da84},
+            {0x1da9b, 0x1daaf}, {0x1e000, 0x1e02a}, {0x1e130, 0x1e136},
+            {0x1e2ae, 0x1e2ae}, {0x1e2ec, 0x1e2ef}, {0x1e8d0, 0x1e8d6},
+            {0x1e944, 0x1e94a}, {0xe0001, 0xe01ef},
+        };
+
+        /* Grapheme_Cluster_Break property, with Extended_Pictographic code
+         * points (all of them are Other in GCB) as its own value. ASCII and
+         * Hangul syllables are left out since they are computed. */
+        constexpr PropertyRange grapheme_break_ranges[] = {
+            {0x0080, 0x009f, GB_CONTROL},
+            {0x00a9, 0x00a9, GB_EXTENDED_PICTOGRAPHIC},
+            {0x00ad, 0x00ad, GB_CONTROL},
+            {0x00ae, 0x00ae, GB_EXTENDED_PICTOGRAPHIC},
+            {0x0300, 0x036f, GB_EXTEND},
+            {0x0483, 0x0489, GB_EXTEND},
+            {0x0591, 0x05bd, GB_EXTEND},
+            {0x05bf, 0x05bf, GB_EXTEND},
+            {0x05c1, 0x05c2, GB_EXTEND},
+            {0x05c4, 0x05c5, GB_EXTEND},
+            {0x05c7, 0x05c7, GB_EXTEND},
+            {0x0600, 0x0605, GB_PREPEND},
+            {0x0610, 0x061a, GB_EXTEND},
+            {0x061c, 0x061c, GB_CONTROL},
+            {0x064b, 0x065f, GB_EXTEND},
+            {0x0670, 0x0670, GB_EXTEND},
+            {0x06d6, 0x06dc, GB_EXTEND},
+            {0x06dd, 0x06dd, GB_PREPEND},
+            {0x06df, 0x06e4, GB_EXTEND},
+            {0x06e7, 0x06e8, GB_EXTEND},
+            {0x06ea, 0x06ed, GB_EXTEND},
+            {0x070f, 0x070f, GB_PREPEND},
+            {0x0711, 0x0711, GB_EXTEND},
+            {0x0730, 0x074a, GB_EXTEND},
+            {0x07a6, 0x07b0, GB_EXTEND},
+            {0x07eb, 0x07f3, GB_EXTEND},
+            {0x07fd, 0x07fd, GB_EXTEND},
+            {0x0816, 0x0819, GB_EXTEND},
+            {0x081b, 0x0823, GB_EXTEND},
+            {0x0825, 0x0827, GB_EXTEND},
+            {0x0829, 0x082d, GB_EXTEND},
+            {0x0859, 0x085b, GB_EXTEND},
+            {0x0890, 0x0891, GB_PREPEND},
+            {0x0898, 0x089f, GB_EXTEND},
+            {0x08ca, 0x08e1, GB_EXTEND},
+            {0x08e2, 0x08e2, GB_PREPEND},
+            {0x08e3, 0x0902, GB_EXTEND},
+            {0x0903, 0x0903, GB_SPACING_MARK},
+            {0x093a, 0x093a, GB_EXTEND},
+            {0x093b, 0x093b, GB_SPACING_MARK},
+            {0x093c, 0x093c, GB_EXTEND},
+            {0x093e, 0x0940, GB_SPACING_MARK},
+            {0x0941, 0x0948, GB_EXTEND},
+            {0x0949, 0x094c, GB_SPACING_MARK},
+            {0x094d, 0x094d, GB_EXTEND},
+            {0x094e, 0x094f, GB_SPACING_MARK},
+            {0x0951, 0x0957, GB_EXTEND},
+            {0x0962, 0x0963, GB_EXTEND},
+            {0x0981, 0x0981, GB_EXTEND},
+            {0x0982, 0x0983, GB_SPACING_MARK},
+            {0x09bc, 0x09bc, GB_EXTEND},
+            {0x09be, 0x09be, GB_EXTEND},
+            {0x09bf, 0x09c0, GB_SPACING_MARK},
+            {0x09c1, 0x09c4, GB_EXTEND},
+            {0x09c7, 0x09c8, GB_SPACING_MARK},
+            {0x09cb, 0x09cc, GB_SPACING_MARK},
+            {0x09cd, 0x09cd, GB_EXTEND},
+            {0x09d7, 0x09d7, GB_EXTEND},
+            {0x09e2, 0x09e3, GB_EXTEND},
+            {0x09fe, 0x09fe, GB_EXTEND},
+            {0x0a01, 0x0a02, GB_EXTEND},
+            {0x0a03, 0x0a03, GB_SPACING_MARK},
+            {0x0a3c, 0x0a3c, GB_EXTEND},
+            {0x0a3e, 0x0a40, GB_SPACING_MARK},
+            {0x0a41, 0x0a42, GB_EXTEND},
+            {0x0a47, 0x0a48, GB_EXTEND},
+            {0x0a4b, 0x0a4d, GB_EXTEND},
+            {0x0a51, 0x0a51, GB_EXTEND},
+            {0x0a70, 0x0a71, GB_EXTEND},
+            {0x0a75, 0x0a75, GB_EXTEND},
+            {0x0a81, 0x0a82, GB_EXTEND},
+            {0x0a83, 0x0a83, GB_SPACING_MARK},
+            {0x0abc, 0x0abc, GB_EXTEND},
+            {0x0abe, 0x0ac0, GB_SPACING_MARK},
+            {0x0ac1, 0x0ac5, GB_EXTEND},
+            {0x0ac7, 0x0ac8, GB_EXTEND},
+            {0x0ac9, 0x0ac9, GB_SPACING_MARK},
+            {0x0acb, 0x0acc, GB_SPACING_MARK},
+            {0x0acd, 0x0acd, GB_EXTEND},
+            {0x0ae2, 0x0ae3, GB_EXTEND},
+            {0x0afa, 0x0aff, GB_EXTEND},
+            {0x0b01, 0x0b01, GB_EXTEND},
+            {0x0b02, 0x0b03, GB_SPACING_MARK},
+            {0x0b3c, 0x0b3c, GB_EXTEND},
+            {0x0b3e, 0x0b3f, GB_EXTEND},
+            {0x0b40, 0x0b40, GB_SPACING_MARK},
+            {0x0b41, 0x0b44, GB_EXTEND},
+            {0x0b47, 0x0b48, GB_SPACING_MARK},
+            {0x0b4b, 0x0b4c, GB_SPACING_MARK},
+            {0x0b4d, 0x0b4d, GB_EXTEND},
+            {0x0b55, 0x0b57, GB_EXTEND},
+            {0x0b62, 0x0b63, GB_EXTEND},
+            {0x0b82, 0x0b82, GB_EXTEND},
+            {0x0bbe, 0x0bbe, GB_EXTEND},
+            {0x0bbf, 0x0bbf, GB_SPACING_MARK},
+            {0x0bc0, 0x0bc0, GB_EXTEND},
+            {0x0bc1, 0x0bc2, GB_SPACING_MARK},
+            {0x0bc6, 0x0bc8, GB_SPACING_MARK},
+            {0x0bca, 0x0bcc, GB_SPACING_MARK},
+            {0x0bcd, 0x0bcd, GB_EXTEND},
+            {0x0bd7, 0x0bd7, GB_EXTEND},
+            {0x0c00, 0x0c00, GB_EXTEND},
+            {0x0c01, 0x0c03, GB_SPACING_MARK},
+            {0x0c04, 0x0c04, GB_EXTEND},
+            {0x0c3c, 0x0c3c, GB_EXTEND},
+            {0x0c3e, 0x0c40, GB_EXTEND},
+            {0x0c41, 0x0c44, GB_SPACING_MARK},
+            {0x0c46, 0x0c48, GB_EXTEND},
+            {0x0c4a, 0x0c4d, GB_EXTEND},
+            {0x0c55, 0x0c56, GB_EXTEND},
+            {0x0c62, 0x0c63, GB_EXTEND},
+            {0x0c81, 0x0c81, GB_EXTEND},
+            {0x0c82, 0x0c83, GB_SPACING_MARK},
+            {0x0cbc, 0x0cbc, GB_EXTEND},
+            {0x0cbe, 0x0cbe, GB_SPACING_MARK},
+            {0x0cbf, 0x0cbf, GB_EXTEND},
+            {0x0cc0, 0x0cc1, GB_SPACING_MARK},
+            {0x0cc2, 0x0cc2, GB_EXTEND},
+            {0x0cc3, 0x0cc4, GB_SPACING_MARK},
+            {0x0cc6, 0x0cc6, GB_EXTEND},
+            {0x0cc7, 0x0cc8, GB_SPACING_MARK},
+            {0x0cca, 0x0ccb, GB_SPACING_MARK},
+            {0x0ccc, 0x0ccd, GB_EXTEND},
+            {0x0cd5, 0x0cd6, GB_EXTEND},
+            {0x0ce2, 0x0ce3, GB_EXTEND},
+            {0x0d00, 0x0d01, GB_EXTEND},
+            {0x0d02, 0x0d03, GB_SPACING_MARK},
+            {0x0d3b, 0x0d3c, GB_EXTEND},
+            {0x0d3e, 0x0d3e, GB_EXTEND},
+            {0x0d3f, 0x0d40, GB_SPACING_MARK},
+            {0x0d41, 0x0d44, GB_EXTEND},
+            {0x0d46, 0x0d48, GB_SPACING_MARK},
+            {0x0d4a, 0x0d4c, GB_SPACING_MARK},
+            {0x0d4d, 0x0d4d, GB_EXTEND},
+            {0x0d4e, 0x0d4e, GB_PREPEND},
+            {0x0d57, 0x0d57, GB_EXTEND},
+            {0x0d62, 0x0d63, GB_EXTEND},
+            {0x0d81, 0x0d81, GB_EXTEND},
+            {0x0d82, 0x0d83, GB_SPACING_MARK},
+            {0x0dca, 0x0dca, GB_EXTEND},
+            {0x0dcf, 0x0dcf, GB_EXTEND},
+            {0x0dd0, 0x0dd1, GB_SPACING_MARK},
+            {0x0dd2, 0x0dd4, GB_EXTEND},
+            {0x0dd6, 0x0dd6, GB_EXTEND},
+            {0x0dd8, 0x0dde, GB_SPACING_MARK},
+            {0x0ddf, 0x0ddf, GB_EXTEND},
+            {0x0df2, 0x0df3, GB_SPACING_MARK},
+            {0x0e31, 0x0e31, GB_EXTEND},
+            {0x0e33, 0x0e33, GB_SPACING_MARK},
+            {0x0e34, 0x0e3a, GB_EXTEND},
+            {0x0e47, 0x0e4e, GB_EXTEND},
+            {0x0eb1, 0x0eb1, GB_EXTEND},
+            {0x0eb3, 0x0eb3, GB_SPACING_MARK},
+            {0x0eb4, 0x0ebc, GB_EXTEND},
+            {0x0ec8, 0x0ecd, GB_EXTEND},
+            {0x0f18, 0x0f19, GB_EXTEND},
+            {0x0f35, 0x0f35, GB_EXTEND},
+            {0x0f37, 0x0f37, GB_EXTEND},
+            {0x0f39, 0x0f39, GB_EXTEND},
+            {0x0f3e, 0x0f3f, GB_SPACING_MARK},
+            {0x0f71, 0x0f7e, GB_EXTEND},
+            {0x0f7f, 0x0f7f, GB_SPACING_MARK},
+            {0x0f80, 0x0f84, GB_EXTEND},
+            {0x0f86, 0x0f87, GB_EXTEND},
+            {0x0f8d, 0x0f97, GB_EXTEND},
+            {0x0f99, 0x0fbc, GB_EXTEND},
+            {0x0fc6, 0x0fc6, GB_EXTEND},
+            {0x102d, 0x1030, GB_EXTEND},
+            {0x1031, 0x1031, GB_SPACING_MARK},
+            {0x1032, 0x1037, GB_EXTEND},
+            {0x1039, 0x103a, GB_EXTEND},
+            {0x103b, 0x103c, GB_SPACING_MARK},
+            {0x103d, 0x103e, GB_EXTEND},
+            {0x1056, 0x1057, GB_SPACING_MARK},
+            {0x1058, 0x1059, GB_EXTEND},
+            {0x105e, 0x1060, GB_EXTEND},
+            {0x1071, 0x1074, GB_EXTEND},
+            {0x1082, 0x1082, GB_EXTEND},
+            {0x1084, 0x1084, GB_SPACING_MARK},
+            {0x1085, 0x1086, GB_EXTEND},
+            {0x108d, 0x108d, GB_EXTEND},
+            {0x109d, 0x109d, GB_EXTEND},
+            {0x1100, 0x115f, GB_L},
+            {0x1160, 0x11a7, GB_V},
+            {0x11a8, 0x11ff, GB_T},
+            {0x135d, 0x135f, GB_EXTEND},
+            {0x1712, 0x1714, GB_EXTEND},
+            {0x1715, 0x1715, GB_SPACING_MARK},
+            {0x1732, 0x1733, GB_EXTEND},
+            {0x1734, 0x1734, GB_SPACING_MARK},
+            {0x1752, 0x1753, GB_EXTEND},
+            {0x1772, 0x1773, GB_EXTEND},
+            {0x17b4, 0x17b5, GB_EXTEND},
+            {0x17b6, 0x17b6, GB_SPACING_MARK},
+            {0x17b7, 0x17bd, GB_EXTEND},
+            {0x17be, 0x17c5, GB_SPACING_MARK},
+            {0x17c6, 0x17c6, GB_EXTEND},
+            {0x17c7, 0x17c8, GB_SPACING_MARK},
+            {0x17c9, 0x17d3, GB_EXTEND},
+            {0x17dd, 0x17dd, GB_EXTEND},
+            {0x180b, 0x180d, GB_EXTEND},
+            {0x180e, 0x180e, GB_CONTROL},
+            {0x180f, 0x180f, GB_EXTEND},
+            {0x1885, 0x1886, GB_EXTEND},
+            {0x18a9, 0x18a9, GB_EXTEND},
+            {0x1920, 0x1922, GB_EXTEND},
+            {0x1923, 0x1926, GB_SPACING_MARK},
+            {0x1927, 0x1928, GB_EXTEND},
+            {0x1929, 0x192b, GB_SPACING_MARK},
+            {0x1930, 0x1931, GB_SPACING_MARK},
+            {0x1932, 0x1932, GB_EXTEND},
+            {0x1933, 0x1938, GB_SPACING_MARK},
+            {0x1939, 0x193b, GB_EXTEND},
+            {0x1a17, 0x1a18, GB_EXTEND},
+            {0x1a19, 0x1a1a, GB_SPACING_MARK},
+            {0x1a1b, 0x1a1b, GB_EXTEND},
+            {0x1a55, 0x1a55, GB_SPACING_MARK},
+            {0x1a56, 0x1a56, GB_EXTEND},
+            {0x1a57, 0x1a57, GB_SPACING_MARK},
+            {0x1a58, 0x1a5e, GB_EXTEND},
+            {0x1a60, 0x1a60, GB_EXTEND},
+            {0x1a62, 0x1a62, GB_EXTEND},
+            {0x1a65, 0x1a6c, GB_EXTEND},
+            {0x1a6d, 0x1a72, GB_SPACING_MARK},
+            {0x1a73, 0x1a7c, GB_EXTEND},
+            {0x1a7f, 0x1a7f, GB_EXTEND},
+            {0x1ab0, 0x1ace, GB_EXTEND},
+            {0x1b00, 0x1b03, GB_EXTEND},
+            {0x1b04, 0x1b04, GB_SPACING_MARK},
+            {0x1b34, 0x1b3a, GB_EXTEND},
+            {0x1b3b, 0x1b3b, GB_SPACING_MARK},
+            {0x1b3c, 0x1b3c, GB_EXTEND},
+            {0x1b3d, 0x1b41, GB_SPACING_MARK},
+            {0x1b42, 0x1b42, GB_EXTEND},
+            {0x1b43, 0x1b44, GB_SPACING_MARK},
+            {0x1b6b, 0x1b73, GB_EXTEND},
+            {0x1b80, 0x1b81, GB_EXTEND},
+            {0x1b82, 0x1b82, GB_SPACING_MARK},
+            {0x1ba1, 0x1ba1, GB_SPACING_MARK},
+            {0x1ba2, 0x1ba5, GB_EXTEND},
+            {0x1ba6, 0x1ba7, GB_SPACING_MARK},
+            {0x1ba8, 0x1ba9, GB_EXTEND},
+            {0x1baa, 0x1baa, GB_SPACING_MARK},
+            {0x1bab, 0x1bad, GB_EXTEND},
+            {0x1be6, 0x1be6, GB_EXTEND},
+            {0x1be7, 0x1be7, GB_SPACING_MARK},
+            {0x1be8, 0x1be9, GB_EXTEND},
+            {0x1bea, 0x1bec, GB_SPACING_MARK},
+            {0x1bed, 0x1bed, GB_EXTEND},
+            {0x1bee, 0x1bee, GB_SPACING_MARK},
+            {0x1bef, 0x1bf1, GB_EXTEND},
+            {0x1bf2, 0x1bf3, GB_SPACING_MARK},
+            {0x1c24, 0x1c2b, GB_SPACING_MARK},
+            {0x1c2c, 0x1c33, GB_EXTEND},
+            {0x1c34, 0x1c35, GB_SPACING_MARK},
+            {0x1c36, 0x1c37, GB_EXTEND},
+            {0x1cd0, 0x1cd2, GB_EXTEND},
+            {0x1cd4, 0x1ce0, GB_EXTEND},
+            {0x1ce1, 0x1ce1, GB_SPACING_MARK},
+            {0x1ce2, 0x1ce8, GB_EXTEND},
+            {0x1ced, 0x1ced, GB_EXTEND},
+            {0x1cf4, 0x1cf4, GB_EXTEND},
+            {0x1cf7, 0x1cf7, GB_SPACING_MARK},
+            {0x1cf8, 0x1cf9, GB_EXTEND},
+            {0x1dc0, 0x1dff, GB_EXTEND},
+            {0x200b, 0x200b, GB_CONTROL},
+            {0x200c, 0x200c, GB_EXTEND},
+            {0x200d, 0x200d, GB_ZWJ},
+            {0x200e, 0x200f, GB_CONTROL},
+            {0x2028, 0x202e, GB_CONTROL},
+            {0x203c, 0x203c, GB_EXTENDED_PICTOGRAPHIC},
+            {0x2049, 0x2049, GB_EXTENDED_PICTOGRAPHIC},
+            {0x2060, 0x206f, GB_CONTROL},
+            {0x20d0, 0x20f0, GB_EXTEND},
+            {0x2122, 0x2122, GB_EXTENDED_PICTOGRAPHIC},
+            {0x2139, 0x2139, GB_EXTENDED_PICTOGRAPHIC},
+            {0x2194, 0x2199, GB_EXTENDED_PICTOGRAPHIC},
+            {0x21a9, 0x21aa, GB_EXTENDED_PICTOGRAPHIC},
+            {0x231a, 0x231b, GB_EXTENDED_PICTOGRAPHIC},
+            {0x2328, 0x2328, GB_EXTENDED_PICTOGRAPHIC},
+            {0x2388, 0x2388, GB_EXTENDED_PICTOGRAPHIC},
+            {0x23cf, 0x23cf, GB_EXTENDED_PICTOGRAPHIC},
+            {0x23e9, 0x23f3, GB_EXTENDED_PICTOGRAPHIC},
+            {0x23f8, 0x23fa, GB_EXTENDED_PICTOGRAPHIC},
+            {0x24c2, 0x24c2, GB_EXTENDED_PICTOGRAPHIC},
+            {0x25aa, 0x25ab, GB_EXTENDED_PICTOGRAPHIC},
+            {0x25b6, 0x25b6, GB_EXTENDED_PICTOGRAPHIC},
+            {0x25c0, 0x25c0, GB_EXTENDED_PICTOGRAPHIC},
+            {0x25fb, 0x25fe, GB_EXTENDED_PICTOGRAPHIC},
+            {0x2600, 0x2605, GB_EXTENDED_PICTOGRAPHIC},
+            {0x2607, 0x2612, GB_EXTENDED_PICTOGRAPHIC},
+            {0x2614, 0x2685, GB_EXTENDED_PICTOGRAPHIC},
+            {0x2690, 0x2705, GB_EXTENDED_PICTOGRAPHIC},
+            {0x2708, 0x2712, GB_EXTENDED_PICTOGRAPHIC},
+            {0x2714, 0x2714, GB_EXTENDED_PICTOGRAPHIC},
+            {0x2716, 0x2716, GB_EXTENDED_PICTOGRAPHIC},
+            {0x271d, 0x271d, GB_EXTENDED_PICTOGRAPHIC},
+            {0x2721, 0x2721, GB_EXTENDED_PICTOGRAPHIC},
+            {0x2728, 0x2728, GB_EXTENDED_PICTOGRAPHIC},
+            {0x2733, 0x2734, GB_EXTENDED_PICTOGRAPHIC},
+            {0x2744, 0x2744, GB_EXTENDED_PICTOGRAPHIC},
+            {0x2747, 0x2747, GB_EXTENDED_PICTOGRAPHIC},
+            {0x274c, 0x274c, GB_EXTENDED_PICTOGRAPHIC},
+            {0x274e, 0x274e, GB_EXTENDED_PICTOGRAPHIC},
+            {0x2753, 0x2755, GB_EXTENDED_PICTOGRAPHIC},
+            {0x2757, 0x2757, GB_EXTENDED_PICTOGRAPHIC},
+            {0x2763, 0x2767, GB_EXTENDED_PICTOGRAPHIC},
+            {0x2795, 0x2797, GB_EXTENDED_PICTOGRAPHIC},
+            {0x27a1, 0x27a1, GB_EXTENDED_PICTOGRAPHIC},
+            {0x27b0, 0x27b0, GB_EXTENDED_PICTOGRAPHIC},
+            {0x27bf, 0x27bf, GB_EXTENDED_PICTOGRAPHIC},
+            {0x2934, 0x2935, GB_EXTENDED_PICTOGRAPHIC},
+            {0x2b05, 0x2b07, GB_EXTENDED_PICTOGRAPHIC},
+            {0x2b1b, 0x2b1c, GB_EXTENDED_PICTOGRAPHIC},
+            {0x2b50, 0x2b50, GB_EXTENDED_PICTOGRAPHIC},
+            {0x2b55, 0x2b55, GB_EXTENDED_PICTOGRAPHIC},
+            {0x2cef, 0x2cf1, GB_EXTEND},
+            {0x2d7f, 0x2d7f, GB_EXTEND},
+            {0x2de0, 0x2dff, GB_EXTEND},
+            {0x302a, 0x302f, GB_EXTEND},
+            {0x3030, 0x3030, GB_EXTENDED_PICTOGRAPHIC},
+            {0x303d, 0x303d, GB_EXTENDED_PICTOGRAPHIC},
+            {0x3099, 0x309a, GB_EXTEND},
+            {0x3297, 0x3297, GB_EXTENDED_PICTOGRAPHIC},
+            {0x3299, 0x3299, GB_EXTENDED_PICTOGRAPHIC},
+            {0xa66f, 0xa672, GB_EXTEND},
+            {0xa674, 0xa67d, GB_EXTEND},
+            {0xa69e, 0xa69f, GB_EXTEND},
+            {0xa6f0, 0xa6f1, GB_EXTEND},
+            {0xa802, 0xa802, GB_EXTEND},
+            {0xa806, 0xa806, GB_EXTEND},
+            {0xa80b, 0xa80b, GB_EXTEND},
+            {0xa823, 0xa824, GB_SPACING_MARK},
+            {0xa825, 0xa826, GB_EXTEND},
+            {0xa827, 0xa827, GB_SPACING_MARK},
+            {0xa82c, 0xa82c, GB_EXTEND},
+            {0xa880, 0xa881, GB_SPACING_MARK},
+            {0xa8b4, 0xa8c3, GB_SPACING_MARK},
+            {0xa8c4, 0xa8c5, GB_EXTEND},
+            {0xa8e0, 0xa8f1, GB_EXTEND},
+            {0xa8ff, 0xa8ff, GB_EXTEND},
+            {0xa926, 0xa92d, GB_EXTEND},
+            {0xa947, 0xa951, GB_EXTEND},
+            {0xa952, 0xa953, GB_SPACING_MARK},
+            {0xa960, 0xa97c, GB_L},
+            {0xa980, 0xa982, GB_EXTEND},
+            {0xa983, 0xa983, GB_SPACING_MARK},
+            {0xa9b3, 0xa9b3, GB_EXTEND},
+            {0xa9b4, 0xa9b5, GB_SPACING_MARK},
+            {0xa9b6, 0xa9b9, GB_EXTEND},
+            {0xa9ba, 0xa9bb, GB_SPACING_MARK},
+            {0xa9bc, 0xa9bd, GB_EXTEND},
+            {0xa9be, 0xa9c0, GB_SPACING_MARK},
+            {0xa9e5, 0xa9e5, GB_EXTEND},
+            {0xaa29, 0xaa2e, GB_EXTEND},
+            {0xaa2f, 0xaa30, GB_SPACING_MARK},
+            {0xaa31, 0xaa32, GB_EXTEND},
+            {0xaa33, 0xaa34, GB_SPACING_MARK},
+            {0xaa35, 0xaa36, GB_EXTEND},
+            {0xaa43, 0xaa43, GB_EXTEND},
+            {0xaa4c, 0xaa4c, GB_EXTEND},
+            {0xaa4d, 0xaa4d, GB_SPACING_MARK},
+            {0xaa7c, 0xaa7c, GB_EXTEND},
+            {0xaab0, 0xaab0, GB_EXTEND},
+            {0xaab2, 0xaab4, GB_EXTEND},
+            {0xaab7, 0xaab8, GB_EXTEND},
+            {0xaabe, 0xaabf, GB_EXTEND},
+            {0xaac1, 0xaac1, GB_EXTEND},
+            {0xaaeb, 0xaaeb, GB_SPACING_MARK},
+            {0xaaec, 0xaaed, GB_EXTEND},
+            {0xaaee, 0xaaef, GB_SPACING_MARK},
+            {0xaaf5, 0xaaf5, GB_SPACING_MARK},
+            {0xaaf6, 0xaaf6, GB_EXTEND},
+            {0xabe3, 0xabe4, GB_SPACING_MARK},
+            {0xabe5, 0xabe5, GB_EXTEND},
+            {0xabe6, 0xabe7, GB_SPACING_MARK},
+            {0xabe8, 0xabe8, GB_EXTEND},
+            {0xabe9, 0xabea, GB_SPACING_MARK},
+            {0xabec, 0xabec, GB_SPACING_MARK},
+            {0xabed, 0xabed, GB_EXTEND},
+            {0xd7b0, 0xd7c6, GB_V},
+            {0xd7cb, 0xd7fb, GB_T},
+            {0xfb1e, 0xfb1e, GB_EXTEND},
+            {0xfe00, 0xfe0f, GB_EXTEND},
+            {0xfe20, 0xfe2f, GB_EXTEND},
+            {0xfeff, 0xfeff, GB_CONTROL},
+            {0xff9e, 0xff9f, GB_EXTEND},
+            {0xfff0, 0xfffb, GB_CONTROL},
+            {0x101fd, 0x101fd, GB_EXTEND},
+            {0x102e0, 0x102e0, GB_EXTEND},
+            {0x10376, 0x1037a, GB_EXTEND},
+            {0x10a01, 0x10a03, GB_EXTEND},
+            {0x10a05, 0x10a06, GB_EXTEND},
+            {0x10a0c, 0x10a0f, GB_EXTEND},
+            {0x10a38, 0x10a3a, GB_EXTEND},
+            {0x10a3f, 0x10a3f, GB_EXTEND},
+            {0x10ae5, 0x10ae6, GB_EXTEND},
+            {0x10d24, 0x10d27, GB_EXTEND},
+            {0x10eab, 0x10eac, GB_EXTEND},
+            {0x10f46, 0x10f50, GB_EXTEND},
+            {0x10f82, 0x10f85, GB_EXTEND},
+            {0x11000, 0x11000, GB_SPACING_MARK},
+            {0x11001, 0x11001, GB_EXTEND},
+            {0x11002, 0x11002, GB_SPACING_MARK},
+            {0x11038, 0x11046, GB_EXTEND},
+            {0x11070, 0x11070, GB_EXTEND},
+            {0x11073, 0x11074, GB_EXTEND},
+            {0x1107f, 0x11081, GB_EXTEND},
+            {0x11082, 0x11082, GB_SPACING_MARK},
+            {0x110b0, 0x110b2, GB_SPACING_MARK},
+            {0x110b3, 0x110b6, GB_EXTEND},
+            {0x110b7, 0x110b8, GB_SPACING_MARK},
+            {0x110b9, 0x110ba, GB_EXTEND},
+            {0x110bd, 0x110bd, GB_PREPEND},
+            {0x110c2, 0x110c2, GB_EXTEND},
+            {0x110cd, 0x110cd, GB_PREPEND},
+            {0x11100, 0x11102, GB_EXTEND},
+            {0x11127, 0x1112b, GB_EXTEND},
+            {0x1112c, 0x1112c, GB_SPACING_MARK},
+            {0x1112d, 0x11134, GB_EXTEND},
+            {0x11145, 0x11146, GB_SPACING_MARK},
+            {0x11173, 0x11173, GB_EXTEND},
+            {0x11180, 0x11181, GB_EXTEND},
+            {0x11182, 0x11182, GB_SPACING_MARK},
+            {0x111b3, 0x111b5, GB_SPACING_MARK},
+            {0x111b6, 0x111be, GB_EXTEND},
+            {0x111bf, 0x111c0, GB_SPACING_MARK},
+            {0x111c2, 0x111c3, GB_PREPEND},
+            {0x111c9, 0x111cc, GB_EXTEND},
+            {0x111ce, 0x111ce, GB_SPACING_MARK},
+            {0x111cf, 0x111cf, GB_EXTEND},
+            {0x1122c, 0x1122e, GB_SPACING_MARK},
+            {0x1122f, 0x11231, GB_EXTEND},
+            {0x11232, 0x11233, GB_SPACING_MARK},
+            {0x11234, 0x11234, GB_EXTEND},
+            {0x11235, 0x11235, GB_SPACING_MARK},
+            {0x11236, 0x11237, GB_EXTEND},
+            {0x1123e, 0x1123e, GB_EXTEND},
+            {0x112df, 0x112df, GB_EXTEND},
+            {0x112e0, 0x112e2, GB_SPACING_MARK},
+            {0x112e3, 0x112ea, GB_EXTEND},
+            {0x11300, 0x11301, GB_EXTEND},
+            {0x11302, 0x11303, GB_SPACING_MARK},
+            {0x1133b, 0x1133c, GB_EXTEND},
+            {0x1133e, 0x1133e, GB_EXTEND},
+            {0x1133f, 0x1133f, GB_SPACING_MARK},
+            {0x11340, 0x11340, GB_EXTEND},
+            {0x11341, 0x11344, GB_SPACING_MARK},
+            {0x11347, 0x11348, GB_SPACING_MARK},
+            {0x1134b, 0x1134d, GB_SPACING_MARK},
+            {0x11357, 0x11357, GB_EXTEND},
+            {0x11362, 0x11363, GB_SPACING_MARK},
+            {0x11366, 0x1136c, GB_EXTEND},
+            {0x11370, 0x11374, GB_EXTEND},
+            {0x11435, 0x11437, GB_SPACING_MARK},
+            {0x11438, 0x1143f, GB_EXTEND},
+            {0x11440, 0x11441, GB_SPACING_MARK},
+            {0x11442, 0x11444, GB_EXTEND},
+            {0x11445, 0x11445, GB_SPACING_MARK},
+            {0x11446, 0x11446, GB_EXTEND},
+            {0x1145e, 0x1145e, GB_EXTEND},
+            {0x114b0, 0x114b0, GB_EXTEND},
+            {0x114b1, 0x114b2, GB_SPACING_MARK},
+            {0x114b3, 0x114b8, GB_EXTEND},
+            {0x114b9, 0x114b9, GB_SPACING_MARK},
+            {0x114ba, 0x114ba, GB_EXTEND},
+            {0x114bb, 0x114bc, GB_SPACING_MARK},
+            {0x114bd, 0x114bd, GB_EXTEND},
+            {0x114be, 0x114be, GB_SPACING_MARK},
+            {0x114bf, 0x114c0, GB_EXTEND},
+            {0x114c1, 0x114c1, GB_SPACING_MARK},
+            {0x114c2, 0x114c3, GB_EXTEND},
+            {0x115af, 0x115af, GB_EXTEND},
+            {0x115b0, 0x115b1, GB_SPACING_MARK},
+            {0x115b2, 0x115b5, GB_EXTEND},
+            {0x115b8, 0x115bb, GB_SPACING_MARK},
+            {0x115bc, 0x115bd, GB_EXTEND},
+            {0x115be, 0x115be, GB_SPACING_MARK},
+            {0x115bf, 0x115c0, GB_EXTEND},
+            {0x115dc, 0x115dd, GB_EXTEND},
+            {0x11630, 0x11632, GB_SPACING_MARK},
+            {0x11633, 0x1163a, GB_EXTEND},
+            {0x1163b, 0x1163c, GB_SPACING_MARK},
+            {0x1163d, 0x1163d, GB_EXTEND},
+            {0x1163e, 0x1163e, GB_SPACING_MARK},
+            {0x1163f, 0x11640, GB_EXTEND},
+            {0x116ab, 0x116ab, GB_EXTEND},
+            {0x116ac, 0x116ac, GB_SPACING_MARK},
+            {0x116ad, 0x116ad, GB_EXTEND},
+            {0x116ae, 0x116af, GB_SPACING_MARK},
+            {0x116b0, 0x116b5, GB_EXTEND},
+            {0x116b6, 0x116b6, GB_SPACING_MARK},
+            {0x116b7, 0x116b7, GB_EXTEND},
+            {0x1171d, 0x1171f, GB_EXTEND},
+            {0x11722, 0x11725, GB_EXTEND},
+            {0x11726, 0x11726, GB_SPACING_MARK},
+            {0x11727, 0x1172b, GB_EXTEND},
+            {0x1182c, 0x1182e, GB_SPACING_MARK},
+            {0x1182f, 0x11837, GB_EXTEND},
+            {0x11838, 0x11838, GB_SPACING_MARK},
+            {0x11839, 0x1183a, GB_EXTEND},
+            {0x11930, 0x11930, GB_EXTEND},
+            {0x11931, 0x11935, GB_SPACING_MARK},
+            {0x11937, 0x11938, GB_SPACING_MARK},
+            {0x1193b, 0x1193c, GB_EXTEND},
+            {0x1193d, 0x1193d, GB_SPACING_MARK},
+            {0x1193e, 0x1193e, GB_EXTEND},
+            {0x1193f, 0x1193f, GB_PREPEND},
+            {0x11940, 0x11940, GB_SPACING_MARK},
+            {0x11941, 0x11941, GB_PREPEND},
+            {0x11942, 0x11942, GB_SPACING_MARK},
+            {0x11943, 0x11943, GB_EXTEND},
+            {0x119d1, 0x119d3, GB_SPACING_MARK},
+            {0x119d4, 0x119d7, GB_EXTEND},
+            {0x119da, 0x119db, GB_EXTEND},
+            {0x119dc, 0x119df, GB_SPACING_MARK},
+            {0x119e0, 0x119e0, GB_EXTEND},
+            {0x119e4, 0x119e4, GB_SPACING_MARK},
+            {0x11a01, 0x11a0a, GB_EXTEND},
+            {0x11a33, 0x11a38, GB_EXTEND},
+            {0x11a39, 0x11a39, GB_SPACING_MARK},
+            {0x11a3a, 0x11a3a, GB_PREPEND},
+            {0x11a3b, 0x11a3e, GB_EXTEND},
+            {0x11a47, 0x11a47, GB_EXTEND},
+            {0x11a51, 0x11a56, GB_EXTEND},
+            {0x11a57, 0x11a58, GB_SPACING_MARK},
+            {0x11a59, 0x11a5b, GB_EXTEND},
+            {0x11a84, 0x11a89, GB_PREPEND},
+            {0x11a8a, 0x11a96, GB_EXTEND},
+            {0x11a97, 0x11a97, GB_SPACING_MARK},
+            {0x11a98, 0x11a99, GB_EXTEND},
+            {0x11c2f, 0x11c2f, GB_SPACING_MARK},
+            {0x11c30, 0x11c36, GB_EXTEND},
+            {0x11c38, 0x11c3d, GB_EXTEND},
+            {0x11c3e, 0x11c3e, GB_SPACING_MARK},
+            {0x11c3f, 0x11c3f, GB_EXTEND},
+            {0x11c92, 0x11ca7, GB_EXTEND},
+            {0x11ca9, 0x11ca9, GB_SPACING_MARK},
+            {0x11caa, 0x11cb0, GB_EXTEND},
+            {0x11cb1, 0x11cb1, GB_SPACING_MARK},
+            {0x11cb2, 0x11cb3, GB_EXTEND},
+            {0x11cb4, 0x11cb4, GB_SPACING_MARK},
+            {0x11cb5, 0x11cb6, GB_EXTEND},
+            {0x11d31, 0x11d36, GB_EXTEND},
+            {0x11d3a, 0x11d3a, GB_EXTEND},
+            {0x11d3c, 0x11d3d, GB_EXTEND},
+            {0x11d3f, 0x11d45, GB_EXTEND},
+            {0x11d46, 0x11d46, GB_PREPEND},
+            {0x11d47, 0x11d47, GB_EXTEND},
+            {0x11d8a, 0x11d8e, GB_SPACING_MARK},
+            {0x11d90, 0x11d91, GB_EXTEND},
+            {0x11d93, 0x11d94, GB_SPACING_MARK},
+            {0x11d95, 0x11d95, GB_EXTEND},
+            {0x11d96, 0x11d96, GB_SPACING_MARK},
+            {0x11d97, 0x11d97, GB_EXTEND},
+            {0x11ef3, 0x11ef4, GB_EXTEND},
+            {0x11ef5, 0x11ef6, GB_SPACING_MARK},
+            {0x13430, 0x13438, GB_CONTROL},
+            {0x16af0, 0x16af4, GB_EXTEND},
+            {0x16b30, 0x16b36, GB_EXTEND},
+            {0x16f4f, 0x16f4f, GB_EXTEND},
+            {0x16f51, 0x16f87, GB_SPACING_MARK},
+            {0x16f8f, 0x16f92, GB_EXTEND},
+            {0x16fe4, 0x16fe4, GB_EXTEND},
+            {0x16ff0, 0x16ff1, GB_SPACING_MARK},
+            {0x1bc9d, 0x1bc9e, GB_EXTEND},
+            {0x1bca0, 0x1bca3, GB_CONTROL},
+            {0x1cf00, 0x1cf2d, GB_EXTEND},
+            {0x1cf30, 0x1cf46, GB_EXTEND},
+            {0x1d165, 0x1d165, GB_EXTEND},
+            {0x1d166, 0x1d166, GB_SPACING_MARK},
+            {0x1d167, 0x1d169, GB_EXTEND},
+            {0x1d16d, 0x1d16d, GB_SPACING_MARK},
+            {0x1d16e, 0x1d172, GB_EXTEND},
+            {0x1d173, 0x1d17a, GB_CONTROL},
+            {0x1d17b, 0x1d182, GB_EXTEND},
+            {0x1d185, 0x1d18b, GB_EXTEND},
+            {0x1d1aa, 0x1d1ad, GB_EXTEND},
+            {0x1d242, 0x1d244, GB_EXTEND},
+            {0x1da00, 0x1da36, GB_EXTEND},
+            {0x1da3b, 0x1da6c, GB_EXTEND},
+            {0x1da75, 0x1da75, GB_EXTEND},
+            {0x1da84, 0x1da84, GB_EXTEND},
+            {0x1da9b, 0x1da9f, GB_EXTEND},
+            {0x1daa1, 0x1daaf, GB_EXTEND},
+            {0x1e000, 0x1e006, GB_EXTEND},
+            {0x1e008, 0x1e018, GB_EXTEND},
+            {0x1e01b, 0x1e021, GB_EXTEND},
+            {0x1e023, 0x1e024, GB_EXTEND},
+            {0x1e026, 0x1e02a, GB_EXTEND},
+            {0x1e130, 0x1e136, GB_EXTEND},
+            {0x1e2ae, 0x1e2ae, GB_EXTEND},
+            {0x1e2ec, 0x1e2ef, GB_EXTEND},
+            {0x1e8d0, 0x1e8d6, GB_EXTEND},
+            {0x1e944, 0x1e94a, GB_EXTEND},
+            {0x1f000, 0x1f0ff, GB_EXTENDED_PICTOGRAPHIC},
+            {0x1f10d, 0x1f10f, GB_EXTENDED_PICTOGRAPHIC},
+            {0x1f12f, 0x1f12f, GB_EXTENDED_PICTOGRAPHIC},
+            {0x1f16c, 0x1f171, GB_EXTENDED_PICTOGRAPHIC},
+            {0x1f17e, 0x1f17f, GB_EXTENDED_PICTOGRAPHIC},
+            {0x1f18e, 0x1f18e, GB_EXTENDED_PICTOGRAPHIC},
+            {0x1f191, 0x1f19a, GB_EXTENDED_PICTOGRAPHIC},
+            {0x1f1ad, 0x1f1e5, GB_EXTENDED_PICTOGRAPHIC},
+            {0x1f1e6, 0x1f1ff, GB_REGIONAL_INDICATOR},
+            {0x1f201, 0x1f20f, GB_EXTENDED_PICTOGRAPHIC},
+            {0x1f21a, 0x1f21a, GB_EXTENDED_PICTOGRAPHIC},
+            {0x1f22f, 0x1f22f, GB_EXTENDED_PICTOGRAPHIC},
+            {0x1f232, 0x1f23a, GB_EXTENDED_PICTOGRAPHIC},
+            {0x1f23c, 0x1f23f, GB_EXTENDED_PICTOGRAPHIC},
+            {0x1f249, 0x1f3fa, GB_EXTENDED_PICTOGRAPHIC},
+            {0x1f3fb, 0x1f3ff, GB_EXTEND},
+            {0x1f400, 0x1f53d, GB_EXTENDED_PICTOGRAPHIC},
+            {0x1f546, 0x1f64f, GB_EXTENDED_PICTOGRAPHIC},
+            {0x1f680, 0x1f6ff, GB_EXTENDED_PICTOGRAPHIC},
+            {0x1f774, 0x1f77f, GB_EXTENDED_PICTOGRAPHIC},
+            {0x1f7d5, 0x1f7ff, GB_EXTENDED_PICTOGRAPHIC},
+            {0x1f80c, 0x1f80f, GB_EXTENDED_PICTOGRAPHIC},
+            {0x1f848, 0x1f84f, GB_EXTENDED_PICTOGRAPHIC},
+            {0x1f85a, 0x1f85f, GB_EXTENDED_PICTOGRAPHIC},
+            {0x1f888, 0x1f88f, GB_EXTENDED_PICTOGRAPHIC},
+            {0x1f8ae, 0x1f8ff, GB_EXTENDED_PICTOGRAPHIC},
+            {0x1f90c, 0x1f93a, GB_EXTENDED_PICTOGRAPHIC},
+            {0x1f93c, 0x1f945, GB_EXTENDED_PICTOGRAPHIC},
+            {0x1f947, 0x1faff, GB_EXTENDED_PICTOGRAPHIC},
+            {0x1fc00, 0x1fffd, GB_EXTENDED_PICTOGRAPHIC},
+            {0xe0000, 0xe001f, GB_CONTROL},
+            {0xe0020, 0xe007f, GB_EXTEND},
+            {0xe0080, 0xe00ff, GB_CONTROL},
+            {0xe0100, 0xe01ef, GB_EXTEND},
+            {0xe01f0, 0xe0fff, GB_CONTROL},
+        };
+    } // namespace Unicode
+} // namespace Ked
+
+#endif
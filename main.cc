@@ -14,15 +14,27 @@
 /* You should have received a copy of the GNU General Public License */
 /* along with this program.  If not, see <https://www.gnu.org/licenses/>. */
 
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdlib>
 #include <cstring>
+#include <fstream>
 #include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
 
 #include <fcntl.h>
 #include <pthread.h>
 #include <signal.h>
+#include <sys/stat.h>
 #include <unistd.h>
 
 #include <ked/Buffer.hh>
+#include <ked/Journal.hh>
+#include <ked/Profile.hh>
+#include <ked/Session.hh>
 #include <ked/Terminal.hh>
 #include <ked/Ui.hh>
 #include <ked/ked.hh>
@@ -32,24 +44,6 @@
 
 #include "ked.hh"
 
-/* static void handle_signal_thread(sigset_t *sigs) { */
-/*     int res, sig; */
-/*     for (;;) { */
-/*         res = sigwait(sigs, &sig); */
-
-/*         if (res != 0) continue; */
-
-/*         switch (sig) { */
-/*         case SIGCONT: */
-/*             term_set_up(); */
-/*             ui_invalidate(); */
-
-/*             display_buffer_unlock(); */
-/*             break; */
-/*         } */
-/*     } */
-/* } */
-
 static void check_term(int use_stdin) {
     if ((use_stdin && !(isatty(1) && isatty(2))) ||
         (!use_stdin && !(isatty(0) && isatty(1) && isatty(2)))) {
@@ -60,13 +54,35 @@ static void check_term(int use_stdin) {
 }
 
 static void print_help(void) {
-    std::cout << "usage: ked [options]... file" << std::endl
+    std::cout << "usage: ked [options]... file..." << std::endl
               << "Simple console text editor with minimal dependency."
               << std::endl
               << std::endl
+              << "  --cache-size=MB" << std::endl
+              << "                Keep buffers up to MB megabytes in the "
+                 "daemon. (default: "
+              << DAEMON_CACHE_SIZE << ")" << std::endl
+              << "  --daemon      Run in background and serve later ked "
+                 "invocations, which"
+              << std::endl
+              << "                then start with preference, extensions and "
+                 "buffers loaded."
+              << std::endl
               << "  --debug -d    Load config file for debug. (not ~/.kedrc)"
               << std::endl
               << "  --help        Print this help and exit." << std::endl
+              << "  --profile     Time commands, listeners and hooks of "
+                 "extensions for"
+              << std::endl
+              << "                show_profile." << std::endl
+              << "  --profile-startup[=FILE]" << std::endl
+              << "                Write time spent in each startup phase to "
+                 "FILE, or stderr"
+              << std::endl
+              << "                on exit." << std::endl
+              << "  --restore     Open files of the last session again, "
+                 "where they were left."
+              << std::endl
               << "  --version     Print version and brief license information "
                  "and exit."
               << std::endl;
@@ -85,9 +101,19 @@ static void print_version(void) {
 }
 
 static std::string opt_file_name;
+/* Files given after the first one, which are loaded in background. */
+static std::vector<std::string> opt_other_files;
 static bool opt_debug;
+static bool opt_daemon;
+/* Memory budget of the daemon's buffers in megabytes. */
+static std::size_t opt_cache_size = DAEMON_CACHE_SIZE;
 static bool opt_print_version;
 static bool opt_print_help;
+static bool opt_profile;
+static bool opt_profile_startup;
+static bool opt_restore;
+/* Empty for stderr. */
+static std::string opt_profile_file;
 static std::string opt_unrecognized;
 static char opt_unrecognized_char;
 
@@ -103,6 +129,28 @@ static void handle_option(int argc, char **argv) {
                 opt_print_version = 1;
             else if (std::strcmp(opt, "--debug") == 0)
                 opt_debug = 1;
+            else if (std::strcmp(opt, "--daemon") == 0)
+                opt_daemon = 1;
+            else if (std::strncmp(opt, "--cache-size=", 13) == 0 &&
+                     opt[13] >= '0' && opt[13] <= '9') {
+                char *end;
+                opt_cache_size = std::strtoul(opt + 13, &end, 10);
+                if (*end != '\0') {
+                    opt_unrecognized = opt;
+
+                    return;
+                }
+            }
+            else if (std::strcmp(opt, "--restore") == 0)
+                opt_restore = 1;
+            else if (std::strcmp(opt, "--profile") == 0)
+                opt_profile = 1;
+            else if (std::strcmp(opt, "--profile-startup") == 0)
+                opt_profile_startup = 1;
+            else if (std::strncmp(opt, "--profile-startup=", 18) == 0) {
+                opt_profile_startup = 1;
+                opt_profile_file = opt + 18;
+            }
             else {
                 opt_unrecognized = opt;
 
@@ -122,13 +170,77 @@ static void handle_option(int argc, char **argv) {
         } else {
             if (opt_file_name == "") {
                 opt_file_name = opt;
+            } else if (opt != opt_file_name && std::strcmp(opt, "-") != 0 &&
+                       std::find(std::begin(opt_other_files),
+                                 std::end(opt_other_files),
+                                 opt) == std::end(opt_other_files)) {
+                opt_other_files.push_back(opt);
             }
         }
     }
 }
 
+/* Offers to recover edits left in the journal of file by a session which
+ * did not exit, and deletes the journal if declined. Edits left are applied
+ * when the file is opened. */
+static void offer_recovery(std::string const &file) {
+    std::string journal = Ked::Session::journal_path(file);
+    if (journal.empty() || access(journal.c_str(), F_OK) != 0) return;
+
+    /* Missing file is journaled as empty one. */
+    struct timespec mtime = {0, 0};
+    std::size_t size = 0;
+    struct stat stat_buf;
+    if (stat(file.c_str(), &stat_buf) == 0) {
+        mtime = stat_buf.st_mtim;
+        size = stat_buf.st_size;
+    }
+
+    Ked::Journal *opened = Ked::Journal::open(journal);
+    if (opened == nullptr) {
+        if (errno == EWOULDBLOCK)
+            std::cerr << PROGRAM_NAME << ": " << file
+                      << ": Edited in another session; edits are not "
+                         "journaled"
+                      << std::endl;
+
+        return;
+    }
+
+    std::size_t n_edits = opened->read(mtime, size).size();
+    if (n_edits != 0) {
+        std::cerr << PROGRAM_NAME << ": " << file << ": " << n_edits
+                  << " edits are not saved by the last session. Recover "
+                     "them? [Y/n] ";
+        std::string answer;
+        std::getline(std::cin, answer);
+        if (answer == "n" || answer == "N") opened->remove();
+    }
+
+    /* Unlocks it for the editor to take over. */
+    delete opened;
+}
+
+static void write_startup_report() {
+    std::string report = Ked::Profile::startup_report();
+
+    if (opt_profile_file.empty()) {
+        std::cerr << report;
+
+        return;
+    }
+
+    std::ofstream out(opt_profile_file);
+    out << report;
+    if (!out)
+        std::cerr << PROGRAM_NAME << ": " << opt_profile_file
+                  << ": Cannot write startup profile" << std::endl;
+}
+
 int main(int argc, char **argv) {
     handle_option(argc, argv);
+    if (opt_profile_startup) Ked::Profile::start_startup_trace();
+    Ked::Profile::set_enabled(opt_profile);
 
     if (opt_unrecognized.length() != 0) {
         std::cerr << PROGRAM_NAME << ": " << opt_unrecognized
@@ -148,24 +260,43 @@ int main(int argc, char **argv) {
     if (opt_print_version) print_version();
     if (opt_print_help || opt_print_version) return 0;
 
-    if (opt_file_name.length() == 0) {
+    if (opt_file_name.length() == 0 && !opt_daemon && !opt_restore) {
         print_help();
 
         return 1;
     }
 
-    check_term(opt_file_name == "-");
+    if (!opt_daemon) check_term(opt_file_name == "-");
+
+    /* These signals are received by the event loop through signalfd, so
+     * block them before any thread inherits the mask. */
+    sigset_t sigs;
+    sigemptyset(&sigs);
+    sigaddset(&sigs, SIGCONT);
+    sigaddset(&sigs, SIGWINCH);
+    pthread_sigmask(SIG_BLOCK, &sigs, NULL);
 
-    /* sigset_t sigs; */
-    /* sigemptyset(&sigs); */
-    /* sigaddset(&sigs, SIGCONT); */
-    /* pthread_sigmask(SIG_BLOCK, &sigs, NULL); */
+    /* Files are opened by the daemon if it is running. */
+    if (!opt_daemon && !opt_restore && opt_file_name != "-") {
+        std::vector<std::string> files(1, opt_file_name);
+        files.insert(std::end(files), std::begin(opt_other_files),
+                     std::end(opt_other_files));
 
-    /* pthread_t thread; */
-    /* pthread_create(&thread, NULL, handle_signal_thread, &sigs); */
+        int status;
+        if (client_run(files, &status)) return status;
+    }
+
+    /* Journals of the daemon's buffers are in use, so they are asked
+     * about only when it does not take the files. */
+    if (!opt_daemon && opt_file_name != "-") {
+        if (opt_file_name != "") offer_recovery(opt_file_name);
+        for (auto itr = std::begin(opt_other_files);
+             itr != std::end(opt_other_files); ++itr)
+            offer_recovery(*itr);
+    }
 
-    Ked::Buffer *buf;
-    if (opt_file_name == "-") {
+    Ked::Buffer *buf = nullptr;
+    if (opt_file_name == "-" && !opt_daemon) {
         std::cerr << "Reading from stdin..." << std::endl;
         buf = Ked::buffer_from_stdin();
 
@@ -178,24 +309,68 @@ int main(int argc, char **argv) {
         dup2(fd, 0);
     }
 
-    if (userpref_load(opt_debug)) {
-        Ked::Terminal *term = new Ked::Terminal;
-        Ked::Ui *ui = new Ked::Ui(term);
-        Ked::Extension::attach_ui(ui);
+    int n_builtin;
+    {
+        Ked::Profile::Phase phase("load built-in extensions");
+        n_builtin = builtin_load();
+    }
+
+    bool loaded;
+    {
+        Ked::Profile::Phase phase("load preference");
+        loaded = userpref_load(opt_debug, n_builtin != 0);
+    }
+
+    if (opt_daemon) return loaded ? daemon_run(opt_cache_size << 20) : 1;
+
+    if (loaded) {
+        Ked::Terminal *term;
+        {
+            Ked::Profile::Phase phase("set up terminal");
+            term = new Ked::Terminal;
+        }
+        Ked::Ui *ui;
+        {
+            Ked::Profile::Phase phase("create ui");
+            ui = new Ked::Ui(term);
+        }
+        /* They are added while the first one is shown. */
+        ui->buffer_load(opt_other_files);
+        {
+            Ked::Profile::Phase phase("attach extensions");
+            Ked::Extension::attach_ui(ui);
+            userpref_attach_ui(*ui);
+        }
+
+        bool restored = false;
+        if (opt_restore) {
+            Ked::Profile::Phase phase("restore session");
+            restored = Ked::Session::restore(*ui);
+        }
 
-        if (opt_file_name != "-")
+        if (opt_file_name != "" && opt_file_name != "-") {
+            Ked::Profile::Phase phase("load buffer", opt_file_name);
             buf = new Ked::Buffer(opt_file_name, opt_file_name);
+        }
 
         if (buf != nullptr) {
-            buf->display_range_x_start = 1;
-            buf->display_range_x_end = term->width;
-            buf->display_range_y_start = 2;
-            buf->display_range_y_end = term->height;
             ui->buffer_add(buf);
             ui->buffer_show(buf->buf_name);
             ui->buffer_switch(buf->buf_name);
+        }
+
+        if (buf != nullptr || restored) {
+            /* Saved also while editing, in case the editor is killed. */
+            ui->event_loop.add_timer(SESSION_SAVE_INTERVAL, true, [ui]() {
+                Ked::Session::save(*ui, false);
+            });
 
             ui->main_loop();
+
+            Ked::Session::save(*ui, false);
+        } else {
+            std::cerr << PROGRAM_NAME << ": No session to restore"
+                      << std::endl;
         }
 
         Ked::Extension::detach_ui(ui);
@@ -205,8 +380,8 @@ int main(int argc, char **argv) {
 
     /* delete buf; */
 
-    /* pthread_cancel(thread); */
-    /* pthread_join(thread, NULL); */
+    /* The terminal is restored by now. */
+    if (opt_profile_startup) write_startup_report();
 
     return 0;
 }
@@ -0,0 +1,593 @@
+/* ked -- simple text editor with minimal dependency */
+/* Copyright (C) 2019  Koki Fukuda */
+
+/* This program is free software: you can redistribute it and/or modify */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or */
+/* (at your option) any later version. */
+
+/* This program is distributed in the hope that it will be useful, */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the */
+/* GNU General Public License for more details. */
+
+/* You should have received a copy of the GNU General Public License */
+/* along with this program.  If not, see <https://www.gnu.org/licenses/>. */
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/un.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include <ked/Buffer.hh>
+#include <ked/Extension.hh>
+#include <ked/Rune.hh>
+#include <ked/Terminal.hh>
+#include <ked/Ui.hh>
+
+#include "ked.hh"
+
+/* A client connects to the daemon and sends a request, which is the current
+ * directory and the files to open as NUL terminated strings followed by an
+ * empty one. Its terminal rides on the request as SCM_RIGHTS. After that,
+ * both sides send one byte messages below. */
+
+/* Client to daemon: the terminal is resized. */
+#define MSG_RESIZED 'W'
+/* Client to daemon: the client resumed from stop. */
+#define MSG_CONTINUED 'C'
+/* Daemon to client: the editor is on the terminal. */
+#define MSG_ATTACHED 'A'
+/* Daemon to client: another client is editing, so edit by yourself. */
+#define MSG_BUSY 'B'
+/* Daemon to client: stop yourself; the terminal is restored. */
+#define MSG_STOP 'S'
+/* Daemon to client: the editor exited and the terminal is restored. */
+#define MSG_EXITED 'X'
+
+/* Milliseconds to wait before accepting again when out of descriptors. */
+#define ACCEPT_RETRY_DELAY 100
+
+/* Longest request accepted from a client. */
+#define MAX_REQUEST_SIZE 65536
+/* Seconds to wait for the rest of a request. */
+#define REQUEST_TIMEOUT 1
+
+struct Request {
+    /* Input and output of the client's terminal. */
+    int tty[2];
+    std::string cwd;
+    std::vector<std::string> files;
+};
+
+static Ked::Ui *ui;
+/* When buffers were last opened or left current, for evicting the least
+ * recently used ones. */
+static std::map<Ked::Buffer *, unsigned long> last_used;
+static unsigned long use_count;
+/* Timer to watch the socket again after accept ran out of descriptors, or
+ * -1. */
+static int accept_timer = -1;
+
+static void print_error(char const *subject, char const *msg) {
+    fprintf(stderr, "%s: %s: %s\n", PROGRAM_NAME, subject, msg);
+}
+
+/* Returns the directory the socket is in, which only the user can
+ * enter. */
+static std::string socket_dir() {
+    char const *runtime = std::getenv("XDG_RUNTIME_DIR");
+    if (runtime != nullptr && runtime[0] != '\0')
+        return std::string(runtime) + "/ked";
+
+    return "/tmp/ked-" + std::to_string(getuid());
+}
+
+static bool socket_address(struct sockaddr_un &addr) {
+    std::string path = socket_dir() + "/server";
+    if (path.size() >= sizeof(addr.sun_path)) return false;
+
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+
+    return true;
+}
+
+static int connect_daemon() {
+    struct sockaddr_un addr;
+    if (!socket_address(addr)) return -1;
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        close(fd);
+
+        return -1;
+    }
+
+    return fd;
+}
+
+static void send_message(int fd, char msg) {
+    send(fd, &msg, 1, MSG_NOSIGNAL);
+}
+
+static bool send_all(int fd, char const *data, std::size_t len) {
+    while (len != 0) {
+        ssize_t n = send(fd, data, len, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+
+            return false;
+        }
+
+        data += n;
+        len -= n;
+    }
+
+    return true;
+}
+
+static bool send_request(int fd, std::vector<std::string> const &files) {
+    char *cwd = getcwd(nullptr, 0);
+    if (cwd == nullptr) return false;
+
+    std::string payload(cwd);
+    payload.push_back('\0');
+    free(cwd);
+    for (auto itr = std::begin(files); itr != std::end(files); ++itr) {
+        if (itr->empty()) continue;
+
+        payload += *itr;
+        payload.push_back('\0');
+    }
+    payload.push_back('\0');
+
+    int fds[2] = {STDIN_FILENO, STDOUT_FILENO};
+    char control[CMSG_SPACE(sizeof(fds))];
+    std::memset(control, 0, sizeof(control));
+
+    struct iovec iov;
+    iov.iov_base = &payload[0];
+    iov.iov_len = payload.size();
+    struct msghdr msg;
+    std::memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(fds));
+    std::memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+
+    ssize_t n = sendmsg(fd, &msg, MSG_NOSIGNAL);
+    if (n < 0) return false;
+
+    /* Rest of a long request goes without the descriptors. */
+    return send_all(fd, payload.data() + n, payload.size() - n);
+}
+
+bool client_run(std::vector<std::string> const &files, int *status) {
+    int fd = connect_daemon();
+    if (fd < 0) return false;
+
+    /* Kept to give the terminal back even if the daemon dies. */
+    struct termios orig_termios;
+    tcgetattr(STDIN_FILENO, &orig_termios);
+
+    char msg;
+    if (!send_request(fd, files) || recv(fd, &msg, 1, 0) != 1 ||
+        msg != MSG_ATTACHED) {
+        close(fd);
+
+        return false;
+    }
+
+    /* SIGWINCH and SIGCONT are blocked by the caller. */
+    sigset_t sigs;
+    sigemptyset(&sigs);
+    sigaddset(&sigs, SIGWINCH);
+    sigaddset(&sigs, SIGCONT);
+    int sig_fd = signalfd(-1, &sigs, SFD_NONBLOCK | SFD_CLOEXEC);
+
+    struct pollfd pfds[2];
+    pfds[0].fd = fd;
+    pfds[0].events = POLLIN;
+    pfds[1].fd = sig_fd;
+    pfds[1].events = POLLIN;
+    for (;;) {
+        if (poll(pfds, 2, -1) < 0) {
+            if (errno == EINTR) continue;
+
+            break;
+        }
+
+        struct signalfd_siginfo info;
+        while (read(sig_fd, &info, sizeof(info)) == sizeof(info))
+            send_message(fd, info.ssi_signo == SIGWINCH ? MSG_RESIZED
+                                                        : MSG_CONTINUED);
+
+        if (pfds[0].revents == 0) continue;
+        if (recv(fd, &msg, 1, 0) != 1) break;
+
+        if (msg == MSG_STOP) {
+            kill(0, SIGTSTP);
+        } else if (msg == MSG_EXITED) {
+            close(sig_fd);
+            close(fd);
+            *status = 0;
+
+            return true;
+        }
+    }
+
+    close(sig_fd);
+    close(fd);
+
+    tcsetattr(STDIN_FILENO, TCSADRAIN, &orig_termios);
+    fputs("\e[?2004l\e[?1049l", stdout);
+    fflush(stdout);
+    print_error("daemon", "Connection lost");
+    *status = 1;
+
+    return true;
+}
+
+static int listen_socket() {
+    std::string dir = socket_dir();
+    if (mkdir(dir.c_str(), 0700) != 0 && errno != EEXIST) {
+        print_error(dir.c_str(), strerror(errno));
+
+        return -1;
+    }
+
+    /* Anyone who can enter the directory could take the terminal of the
+     * user. */
+    struct stat st;
+    if (lstat(dir.c_str(), &st) != 0 || !S_ISDIR(st.st_mode) ||
+        st.st_uid != getuid() || (st.st_mode & 077) != 0) {
+        print_error(dir.c_str(), "Unsafe socket directory");
+
+        return -1;
+    }
+
+    struct sockaddr_un addr;
+    if (!socket_address(addr)) {
+        print_error(dir.c_str(), "Socket path too long");
+
+        return -1;
+    }
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        print_error("socket", strerror(errno));
+
+        return -1;
+    }
+
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        int other = errno == EADDRINUSE ? connect_daemon() : -1;
+        if (other >= 0) {
+            close(other);
+            close(fd);
+            print_error("daemon", "Already running");
+
+            return -1;
+        }
+
+        /* Socket left by a daemon that died. */
+        unlink(addr.sun_path);
+        if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+            print_error(addr.sun_path, strerror(errno));
+            close(fd);
+
+            return -1;
+        }
+    }
+
+    if (listen(fd, SOMAXCONN) != 0) {
+        print_error(addr.sun_path, strerror(errno));
+        close(fd);
+
+        return -1;
+    }
+
+    return fd;
+}
+
+static void close_fds(int const *fds, std::size_t n) {
+    for (std::size_t i = 0; i < n; ++i)
+        if (fds[i] >= 0) close(fds[i]);
+}
+
+static bool receive_request(int fd, Request &req) {
+    req.tty[0] = -1;
+    req.tty[1] = -1;
+
+    struct ucred cred;
+    socklen_t cred_len = sizeof(cred);
+    if (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &cred, &cred_len) != 0 ||
+        cred.uid != getuid())
+        return false;
+
+    struct timeval timeout;
+    timeout.tv_sec = REQUEST_TIMEOUT;
+    timeout.tv_usec = 0;
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    char buf[4096];
+    char control[CMSG_SPACE(sizeof(req.tty))];
+    struct iovec iov;
+    iov.iov_base = buf;
+    iov.iov_len = sizeof(buf);
+    struct msghdr msg;
+    std::memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    ssize_t n = recvmsg(fd, &msg, MSG_CMSG_CLOEXEC);
+    if (n <= 0) return false;
+
+    for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr;
+         cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+        if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS)
+            continue;
+
+        int fds[2] = {-1, -1};
+        std::size_t n_fd = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+        std::memcpy(fds, CMSG_DATA(cmsg),
+                    std::min(n_fd, (std::size_t)2) * sizeof(int));
+        if (n_fd == 2 && req.tty[0] < 0) {
+            req.tty[0] = fds[0];
+            req.tty[1] = fds[1];
+        } else {
+            close_fds(fds, std::min(n_fd, (std::size_t)2));
+        }
+    }
+    if (req.tty[0] < 0) return false;
+
+    std::string data(buf, n);
+    std::string const end("\0\0", 2);
+    while (data.find(end) == std::string::npos) {
+        if (data.size() > MAX_REQUEST_SIZE) return false;
+
+        n = recv(fd, buf, sizeof(buf), 0);
+        if (n <= 0) return false;
+        data.append(buf, n);
+    }
+
+    std::size_t start = data.find('\0') + 1;
+    req.cwd = data.substr(0, start - 1);
+    for (;;) {
+        std::size_t next = data.find('\0', start);
+        if (next == start) break;
+
+        req.files.push_back(data.substr(start, next - start));
+        start = next + 1;
+    }
+
+    return true;
+}
+
+/* Returns absolute path of path relative to cwd, which names its buffer
+ * in the daemon. */
+static std::string resolve_path(std::string const &cwd,
+                                std::string const &path) {
+    std::string joined = path[0] == '/' ? path : cwd + "/" + path;
+
+    char *real = realpath(joined.c_str(), nullptr);
+    if (real == nullptr) return joined;
+
+    std::string result(real);
+    free(real);
+
+    return result;
+}
+
+static void open_files(Request const &req) {
+    std::vector<std::string> others;
+    for (std::size_t i = 0; i < req.files.size(); ++i) {
+        std::string path = resolve_path(req.cwd, req.files[i]);
+        Ked::Buffer *buf = ui->buffer_find(path);
+
+        if (i == 0) {
+            /* Buffer kept from earlier sessions is just shown again. */
+            if (buf == nullptr) {
+                buf = new Ked::Buffer(path, path);
+                ui->buffer_add(buf);
+            }
+            ui->buffer_select(path);
+            last_used[buf] = ++use_count;
+        } else if (buf == nullptr &&
+                   std::find(std::begin(others), std::end(others), path) ==
+                       std::end(others)) {
+            others.push_back(path);
+        }
+    }
+
+    ui->buffer_load(others);
+}
+
+/* Returns true if accept failed for lack of descriptors or memory, which
+ * keeps failing until some are freed. */
+static bool out_of_resources(int err) {
+    return err == EMFILE || err == ENFILE || err == ENOBUFS || err == ENOMEM;
+}
+
+/* Turns away clients connecting while another one is served. */
+static void watch_busy(int listen_fd) {
+    ui->event_loop.add_fd(listen_fd, EPOLLIN, [listen_fd](std::uint32_t) {
+        int other = accept4(listen_fd, nullptr, nullptr, SOCK_CLOEXEC);
+        if (other < 0) {
+            /* The connection stays pending, so the socket stays ready. */
+            if (out_of_resources(errno)) {
+                ui->event_loop.remove_fd(listen_fd);
+                accept_timer = ui->event_loop.add_timer(
+                    ACCEPT_RETRY_DELAY, false, [listen_fd]() {
+                        accept_timer = -1;
+                        watch_busy(listen_fd);
+                    });
+            }
+
+            return;
+        }
+
+        send_message(other, MSG_BUSY);
+        close(other);
+    });
+}
+
+static void serve(int listen_fd, int fd, Request const &req) {
+    Ked::Terminal *term = new Ked::Terminal(req.tty[0], req.tty[1]);
+    if (ui == nullptr) {
+        ui = new Ked::Ui(term);
+        Ked::Extension::attach_ui(ui);
+        userpref_attach_ui(*ui);
+    } else {
+        ui->set_terminal(term);
+    }
+    /* Stopping the daemon would stop every session to come. */
+    ui->stop_process = [fd]() { send_message(fd, MSG_STOP); };
+
+    open_files(req);
+    send_message(fd, MSG_ATTACHED);
+
+    ui->event_loop.add_fd(fd, EPOLLIN, [fd](std::uint32_t) {
+        char msg;
+        if (recv(fd, &msg, 1, 0) != 1) {
+            /* Client is gone along with its terminal. */
+            ui->exit_editor();
+
+            return;
+        }
+
+        if (msg == MSG_RESIZED)
+            ui->handle_resize();
+        else if (msg == MSG_CONTINUED)
+            ui->resume();
+    });
+    watch_busy(listen_fd);
+
+    ui->main_loop();
+
+    if (accept_timer >= 0) ui->event_loop.cancel_timer(accept_timer);
+    accept_timer = -1;
+    ui->event_loop.remove_fd(listen_fd);
+    ui->event_loop.remove_fd(fd);
+    if (ui->current_buffer != nullptr)
+        last_used[ui->current_buffer] = ++use_count;
+
+    /* Terminal is restored before the client takes it back. */
+    delete term;
+    send_message(fd, MSG_EXITED);
+}
+
+static std::size_t buffer_memory(Ked::Buffer const &buf) {
+    return buf.buf_size * sizeof(Ked::AttrRune);
+}
+
+/* Deletes buffers least recently used first while buffers take more than
+ * limit bytes. Modified buffers and the ones shown are kept. */
+static void evict_buffers(std::size_t limit) {
+    std::size_t total = 0;
+    std::vector<std::pair<unsigned long, Ked::Buffer *>> candidates;
+    std::vector<Ked::Buffer *> const &buffers = ui->buffer_list();
+    for (auto itr = std::begin(buffers); itr != std::end(buffers); ++itr) {
+        Ked::Buffer *buf = *itr;
+        total += buffer_memory(*buf);
+        if (buf->modified || buf->path.empty()) continue;
+
+        auto found = last_used.find(buf);
+        candidates.push_back(std::make_pair(
+            found == std::end(last_used) ? 0 : found->second, buf));
+    }
+    std::sort(std::begin(candidates), std::end(candidates));
+
+    for (auto itr = std::begin(candidates);
+         itr != std::end(candidates) && total > limit; ++itr) {
+        std::size_t size = buffer_memory(*itr->second);
+        if (!ui->buffer_remove(itr->second)) continue;
+
+        last_used.erase(itr->second);
+        total -= size;
+    }
+}
+
+/* Detaches from the terminal and the shell. Returns in the new process. */
+static bool daemonize() {
+    pid_t pid = fork();
+    if (pid < 0) return false;
+    if (pid > 0) _exit(0);
+
+    setsid();
+
+    int null_fd = open("/dev/null", O_RDWR);
+    if (null_fd >= 0) {
+        dup2(null_fd, STDIN_FILENO);
+        dup2(null_fd, STDOUT_FILENO);
+        dup2(null_fd, STDERR_FILENO);
+        if (null_fd > STDERR_FILENO) close(null_fd);
+    }
+
+    return true;
+}
+
+int daemon_run(std::size_t cache_size) {
+    int listen_fd = listen_socket();
+    if (listen_fd < 0) return 1;
+
+    if (!daemonize()) {
+        print_error("fork", strerror(errno));
+
+        return 1;
+    }
+    /* Clients may be gone while being written to. */
+    signal(SIGPIPE, SIG_IGN);
+
+    for (;;) {
+        int fd = accept4(listen_fd, nullptr, nullptr, SOCK_CLOEXEC);
+        if (fd < 0) {
+            /* Retrying at once would spin until a descriptor is freed. */
+            if (out_of_resources(errno)) poll(nullptr, 0, ACCEPT_RETRY_DELAY);
+
+            continue;
+        }
+
+        Request req;
+        if (receive_request(fd, req)) {
+            serve(listen_fd, fd, req);
+            evict_buffers(cache_size);
+        }
+
+        close_fds(req.tty, 2);
+        close(fd);
+    }
+}
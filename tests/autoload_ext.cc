@@ -0,0 +1,37 @@
+/*
+ * ked -- simple text editor with minimal dependency
+ * Copyright (C) 2019  Koki Fukuda
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/* Extension autoloaded by autoload_test, which binds a key of its own
+ * when attached. */
+
+#include <ked/ked.hh>
+
+namespace AutoloadExtension {
+    DEFINE_EDITOR_COMMAND(test_mark) { buf.insert_utf8("mark", 4); }
+
+    DEFINE_EDITOR_COMMAND(test_other) { buf.insert_utf8("other", 5); }
+
+    extern "C" {
+    void EXTENSION_HOOK(extension_on_attach_ui)(Ked::Ui &ui) {
+        ADD_EDITOR_COMMAND(ui, test_mark);
+        ADD_EDITOR_COMMAND(ui, test_other);
+
+        ui.add_global_keybind("^B", EDITOR_COMMAND_PTR(test_other));
+    }
+    }
+} // namespace AutoloadExtension
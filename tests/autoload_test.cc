@@ -0,0 +1,144 @@
+/*
+ * ked -- simple text editor with minimal dependency
+ * Copyright (C) 2019  Koki Fukuda
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#include <pty.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <ked/Buffer.hh>
+#include <ked/Extension.hh>
+#include <ked/Profile.hh>
+#include <ked/Terminal.hh>
+#include <ked/Ui.hh>
+
+#include "../ked.hh"
+#include "test.hh"
+
+namespace {
+    std::string text_of(Ked::Buffer const &buf) {
+        std::string result;
+        std::size_t len = buf.buf_size - (buf.gap_end - buf.gap_start);
+        for (std::size_t i = 0; i < len; ++i)
+            result.push_back(buf.get_rune(i).c[0]);
+
+        return result;
+    }
+
+    void press(Ked::Ui &ui, std::string const &keys) {
+        unsigned int state = 0;
+        for (unsigned char c : keys)
+            ui.current_keybind().handle(state, c, ui, *ui.current_buffer);
+    }
+
+    /* Writes etc/kedrc under dir, which autoloads autoload_ext.so in this
+     * directory and binds ^B to its command over its own binding. */
+    bool write_kedrc(std::string const &dir) {
+        char *cwd = getcwd(nullptr, 0);
+        if (cwd == nullptr) return false;
+        std::string ext = std::string(cwd) + "/autoload_ext.so";
+        std::free(cwd);
+
+        if (mkdir((dir + "/etc").c_str(), 0700) != 0) return false;
+        std::FILE *f = std::fopen((dir + "/etc/kedrc").c_str(), "w");
+        if (f == nullptr) return false;
+        std::fprintf(f, "autoloadExtension(\"%s\");\n", ext.c_str());
+        std::fprintf(f, "bindKey(\"^B\", \"test_mark\");\n");
+        std::fclose(f);
+
+        return true;
+    }
+
+    void test_kedrc_binding_kept_after_autoload(Ked::Ui &ui) {
+        Ked::Buffer *buf = new Ked::Buffer("test");
+        ui.buffer_add(buf);
+        ui.buffer_switch("test");
+
+        /* The first one loads the extension, which binds ^B on attach. */
+        press(ui, "\x02");
+        press(ui, "\x02");
+
+        CHECK(text_of(*buf) == "markmark");
+    }
+
+    /* Returns true if report has a line of the site. */
+    bool has_site(std::string const &report, std::string const &owner,
+                  std::string const &name) {
+        std::string owner_column = owner;
+        owner_column.resize(12, ' ');
+        std::string line = "\n" + owner_column + " " + name + " ";
+
+        return report.find(line) != std::string::npos;
+    }
+
+    void test_key_profiled_as_extension(Ked::Ui &ui) {
+        Ked::Profile::set_enabled(true);
+        press(ui, "\x02");
+        Ked::Profile::set_enabled(false);
+
+        /* Bound by kedrc, but runs the command of the extension. */
+        std::string report = Ked::Profile::report();
+        CHECK(has_site(report, "autoload_ext", "^B"));
+        CHECK(!has_site(report, "ked", "^B"));
+    }
+} // namespace
+
+int main() {
+    char dir[] = "/tmp/ked-test-XXXXXX";
+    if (mkdtemp(dir) == nullptr || !write_kedrc(dir)) {
+        std::perror("autoload_test");
+
+        return 1;
+    }
+
+    /* The preference is read from etc/kedrc in debug mode. */
+    char *cwd = getcwd(nullptr, 0);
+    if (chdir(dir) != 0) return 1;
+    bool loaded = userpref_load(true, true);
+    if (chdir(cwd) != 0) return 1;
+    std::free(cwd);
+    CHECK(loaded);
+
+    int master, slave;
+    if (openpty(&master, &slave, nullptr, nullptr, nullptr) != 0) {
+        std::perror("autoload_test");
+
+        return 1;
+    }
+    Ked::Terminal *term = new Ked::Terminal(slave, slave);
+    Ked::Ui *ui = new Ked::Ui(term);
+    Ked::Extension::attach_ui(ui);
+    userpref_attach_ui(*ui);
+
+    test_kedrc_binding_kept_after_autoload(*ui);
+    test_key_profiled_as_extension(*ui);
+
+    Ked::Extension::detach_ui(ui);
+    delete ui;
+    delete term;
+    close(master);
+    close(slave);
+    unlink((std::string(dir) + "/etc/kedrc").c_str());
+    rmdir((std::string(dir) + "/etc").c_str());
+    rmdir(dir);
+
+    return test_failures != 0;
+}
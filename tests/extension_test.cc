@@ -0,0 +1,83 @@
+/*
+ * ked -- simple text editor with minimal dependency
+ * Copyright (C) 2019  Koki Fukuda
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include <dlfcn.h>
+#include <unistd.h>
+
+#include <ked/Extension.hh>
+
+#include "test.hh"
+
+namespace {
+    /* Returns how many times loaded_ext.so has been loaded. */
+    int loads() {
+        void *handle = dlopen("./loaded_ext.so", RTLD_LAZY | RTLD_NOLOAD);
+        if (handle == nullptr) return 0;
+
+        int result = *(int *)dlsym(handle, "loaded_ext_loads");
+        dlclose(handle);
+
+        return result;
+    }
+
+    void test_duplicates_loaded_once(std::string const &link) {
+        std::vector<std::string> paths = {"./loaded_ext.so",
+                                          "../tests/loaded_ext.so", link};
+        std::vector<std::string> errors;
+
+        CHECK(Ked::Extension::load_all(paths, errors));
+        CHECK(errors.empty());
+        CHECK(loads() == 1);
+
+        /* Ones already loaded are skipped as well. */
+        CHECK(Ked::Extension::load_all(paths, errors));
+        CHECK(loads() == 1);
+    }
+} // namespace
+
+int main() {
+    char dir[] = "/tmp/ked-test-XXXXXX";
+    char *cwd = getcwd(nullptr, 0);
+    if (mkdtemp(dir) == nullptr || cwd == nullptr) {
+        std::perror("extension_test");
+
+        return 1;
+    }
+
+    /* Named differently, so only its real path tells it apart. */
+    std::string link = std::string(dir) + "/alias.so";
+    if (symlink((std::string(cwd) + "/loaded_ext.so").c_str(),
+                link.c_str()) != 0) {
+        std::perror("extension_test");
+
+        return 1;
+    }
+    std::free(cwd);
+
+    test_duplicates_loaded_once(link);
+
+    Ked::Extension::unload_all();
+    unlink(link.c_str());
+    rmdir(dir);
+
+    return test_failures != 0;
+}
@@ -0,0 +1,144 @@
+/*
+ * ked -- simple text editor with minimal dependency
+ * Copyright (C) 2019  Koki Fukuda
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <memory>
+#include <string>
+
+#include <ked/Buffer.hh>
+#include <ked/EventLoop.hh>
+#include <ked/Job.hh>
+
+#include "test.hh"
+
+namespace {
+    /* Runs the loop until pending becomes 0 or it gets idle for a second. */
+    void wait_jobs(Ked::EventLoop &loop, int const &pending) {
+        while (pending > 0 && loop.run_once(1000) > 0)
+            ;
+    }
+
+    void test_snapshot_shared_in_version() {
+        Ked::EventLoop loop;
+        Ked::JobPool pool(loop);
+        Ked::Buffer buf("test");
+        buf.insert_utf8("hello", 5);
+        /* Leaves the gap in the middle of the text. */
+        buf.cursor_move(3, false);
+        buf.insert('X');
+
+        int pending = 2;
+        std::string texts[2];
+        Ked::BufferSnapshot const *snapshots[2] = {nullptr, nullptr};
+        for (int i = 0; i < 2; ++i) {
+            pool.submit(buf, [&, i](Ked::BufferSnapshot const &snapshot,
+                                    Ked::Job const &) {
+                texts[i] = snapshot.text();
+                snapshots[i] = &snapshot;
+
+                return [&pending]() { --pending; };
+            });
+        }
+        wait_jobs(loop, pending);
+
+        CHECK(pending == 0);
+        CHECK(texts[0] == "heXllo");
+        CHECK(texts[1] == "heXllo");
+        CHECK(snapshots[0] == snapshots[1]);
+    }
+
+    void test_snapshot_copied_in_chunks() {
+        Ked::EventLoop loop;
+        Ked::JobPool pool(loop);
+        Ked::Buffer buf("test");
+        std::string text(SNAPSHOT_CHUNK_SIZE * 2, 'a');
+        buf.insert_utf8(text.data(), text.size());
+        buf.cursor_move(SNAPSHOT_CHUNK_SIZE / 2, false);
+        buf.insert('b');
+        text.insert(text.size() - SNAPSHOT_CHUNK_SIZE / 2, 1, 'b');
+
+        int pending = 1;
+        std::string copied;
+        pool.submit(buf, [&](Ked::BufferSnapshot const &snapshot,
+                             Ked::Job const &) {
+            copied = snapshot.text();
+
+            return [&pending]() { --pending; };
+        });
+        wait_jobs(loop, pending);
+
+        CHECK(pending == 0);
+        CHECK(copied == text);
+    }
+
+    void test_result_dropped_after_edit() {
+        Ked::EventLoop loop;
+        Ked::JobPool pool(loop);
+        Ked::Buffer buf("test");
+        buf.insert_utf8("hello", 5);
+
+        int pending = 1;
+        bool delivered = false;
+        pool.submit(buf, [&](Ked::BufferSnapshot const &, Ked::Job const &) {
+            return [&delivered]() { delivered = true; };
+        });
+        pool.submit([&](Ked::BufferSnapshot const &, Ked::Job const &) {
+            return [&pending]() { --pending; };
+        });
+        buf.insert('!');
+        wait_jobs(loop, pending);
+
+        CHECK(pending == 0);
+        CHECK(!delivered);
+    }
+
+    void test_cancel_before_delete() {
+        Ked::EventLoop loop;
+        Ked::JobPool pool(loop);
+
+        for (int i = 0; i < 100; ++i) {
+            std::unique_ptr<Ked::Buffer> buf(new Ked::Buffer("test"));
+            std::string text(10000, 'a');
+            buf->insert_utf8(text.data(), text.size());
+
+            bool delivered = false;
+            pool.submit(*buf,
+                        [&delivered](Ked::BufferSnapshot const &,
+                                     Ked::Job const &) {
+                            return [&delivered]() { delivered = true; };
+                        });
+            pool.cancel(buf.get());
+            buf.reset();
+
+            int pending = 1;
+            pool.submit([&](Ked::BufferSnapshot const &, Ked::Job const &) {
+                return [&pending]() { --pending; };
+            });
+            wait_jobs(loop, pending);
+            CHECK(!delivered);
+        }
+    }
+} // namespace
+
+int main() {
+    test_snapshot_shared_in_version();
+    test_snapshot_copied_in_chunks();
+    test_result_dropped_after_edit();
+    test_cancel_before_delete();
+
+    return test_failures != 0;
+}
@@ -0,0 +1,137 @@
+/*
+ * ked -- simple text editor with minimal dependency
+ * Copyright (C) 2019  Koki Fukuda
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <cerrno>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <ked/Buffer.hh>
+#include <ked/Journal.hh>
+
+#include "test.hh"
+
+namespace {
+    void test_locked_while_open(std::string const &path) {
+        Ked::Buffer buf("test");
+        buf.insert_utf8("hello", 5);
+
+        Ked::Journal *first = Ked::Journal::open(path);
+        CHECK(first != nullptr);
+        if (first == nullptr) return;
+        CHECK(first->reset(buf));
+        first->record(buf, 0, 0, 5);
+        CHECK(first->flush());
+
+        /* Another session must neither replay nor truncate it. */
+        errno = 0;
+        Ked::Journal *second = Ked::Journal::open(path);
+        CHECK(second == nullptr);
+        CHECK(errno == EWOULDBLOCK);
+        delete second;
+
+        std::vector<Ked::JournalRecord> records =
+            first->read(buf.file_mtime, buf.file_size);
+        CHECK(records.size() == 1);
+        delete first;
+
+        /* It is free once the first one is closed. */
+        Ked::Journal *third = Ked::Journal::open(path);
+        CHECK(third != nullptr);
+        if (third == nullptr) return;
+        records = third->read(buf.file_mtime, buf.file_size);
+        CHECK(records.size() == 1 && records[0].text == "hello");
+        third->remove();
+        delete third;
+    }
+
+    void test_reopened_after_remove(std::string const &path) {
+        Ked::Journal *first = Ked::Journal::open(path);
+        CHECK(first != nullptr);
+        if (first == nullptr) return;
+
+        /* Deleted journal does not keep the file locked. */
+        first->remove();
+        Ked::Journal *second = Ked::Journal::open(path);
+        CHECK(second != nullptr);
+        delete first;
+
+        struct stat stat_buf;
+        CHECK(stat(path.c_str(), &stat_buf) == 0);
+        if (second != nullptr) second->remove();
+        delete second;
+    }
+    void test_recovered_kept(std::string const &path) {
+        Ked::Buffer buf("test");
+        buf.insert_utf8("hello", 5);
+
+        Ked::Journal *journal = Ked::Journal::open(path);
+        CHECK(journal != nullptr);
+        if (journal == nullptr) return;
+        CHECK(journal->reset(buf));
+        journal->record(buf, 0, 0, 5);
+        CHECK(journal->flush());
+        delete journal;
+
+        /* Record being written on crash. */
+        int fd = ::open(path.c_str(), O_WRONLY | O_APPEND);
+        CHECK(fd >= 0);
+        CHECK(write(fd, "\x01\x02", 2) == 2);
+        close(fd);
+
+        journal = Ked::Journal::open(path);
+        CHECK(journal != nullptr);
+        if (journal == nullptr) return;
+        std::size_t end;
+        std::vector<Ked::JournalRecord> records =
+            journal->read(buf.file_mtime, buf.file_size, &end);
+        CHECK(records.size() == 1);
+
+        /* Recovered record stays on the disk without being written
+         * again, and new ones follow it. */
+        CHECK(journal->truncate(end));
+        struct stat stat_buf;
+        CHECK(stat(path.c_str(), &stat_buf) == 0 &&
+              (std::size_t)stat_buf.st_size == end);
+        journal->record(buf, 0, 5, 5);
+        CHECK(journal->flush());
+
+        records = journal->read(buf.file_mtime, buf.file_size);
+        CHECK(records.size() == 2 && records[1].removed == 5);
+        journal->remove();
+        delete journal;
+    }
+} // namespace
+
+int main() {
+    char dir[] = "/tmp/ked-test-XXXXXX";
+    if (mkdtemp(dir) == nullptr) return 1;
+    std::string path = std::string(dir) + "/test.journal";
+
+    test_locked_while_open(path);
+    test_reopened_after_remove(path);
+    test_recovered_kept(path);
+
+    rmdir(dir);
+
+    return test_failures != 0;
+}
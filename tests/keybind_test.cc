@@ -0,0 +1,113 @@
+/*
+ * ked -- simple text editor with minimal dependency
+ * Copyright (C) 2019  Koki Fukuda
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <string>
+
+#include <ked/Keybind.hh>
+
+#include "test.hh"
+
+using Ked::KeyHandling::EditorCommand;
+using Ked::KeyHandling::Keybind;
+
+namespace {
+    using CommandFunc = void (*)(Ked::Ui &, Ked::Buffer &);
+
+    void global_command(Ked::Ui &, Ked::Buffer &) {}
+    void mode_command(Ked::Ui &, Ked::Buffer &) {}
+    void buffer_command(Ked::Ui &, Ked::Buffer &) {}
+
+    /* Returns the function bound to key, or nullptr if more keys are
+     * waited or key is not bound. */
+    CommandFunc lookup(Keybind const &keybind, std::string const &key) {
+        unsigned int state = 0;
+        for (unsigned char c : key) {
+            state = keybind.advance(state, c);
+            if (state == 0) return nullptr;
+        }
+
+        EditorCommand const *func = keybind.command(state);
+        if (func == nullptr) return nullptr;
+
+        CommandFunc const *target = func->target<CommandFunc>();
+        return target ? *target : nullptr;
+    }
+
+    /* Merges layers from the lowest one as Ui::current_keybind does. */
+    void resolve(Keybind &resolved, Keybind const &global,
+                 Keybind const &mode, Keybind const &buffer) {
+        resolved.clear();
+        resolved.merge(global);
+        resolved.merge(mode);
+        resolved.merge(buffer);
+    }
+
+    void test_mode_prefix_over_global_command() {
+        Keybind global, mode, buffer, resolved;
+        global.add("^X", global_command);
+        mode.add("^X^S", mode_command);
+        resolve(resolved, global, mode, buffer);
+
+        /* ^X has to wait for the rest of the mode binding. */
+        unsigned int state = resolved.advance(0, '\x18');
+        CHECK(state != 0);
+        CHECK(resolved.command(state) == nullptr);
+        CHECK(lookup(resolved, "\x18\x13") == mode_command);
+    }
+
+    void test_mode_command_over_global_prefix() {
+        Keybind global, mode, buffer, resolved;
+        global.add("^X^S", global_command);
+        mode.add("^X", mode_command);
+        resolve(resolved, global, mode, buffer);
+
+        CHECK(lookup(resolved, "\x18") == mode_command);
+    }
+
+    void test_buffer_prefix_over_mode_command() {
+        Keybind global, mode, buffer, resolved;
+        global.add("^X^S", global_command);
+        mode.add("^X", mode_command);
+        buffer.add("^X^F", buffer_command);
+        resolve(resolved, global, mode, buffer);
+
+        CHECK(resolved.command(resolved.advance(0, '\x18')) == nullptr);
+        CHECK(lookup(resolved, "\x18\x06") == buffer_command);
+        CHECK(lookup(resolved, "\x18\x13") == global_command);
+    }
+
+    void test_same_sequence_replaced() {
+        Keybind global, mode, buffer, resolved;
+        global.add("^X^S", global_command);
+        global.add("^A", global_command);
+        mode.add("^X^S", mode_command);
+        resolve(resolved, global, mode, buffer);
+
+        CHECK(lookup(resolved, "\x18\x13") == mode_command);
+        CHECK(lookup(resolved, "\x01") == global_command);
+    }
+} // namespace
+
+int main() {
+    test_mode_prefix_over_global_command();
+    test_mode_command_over_global_prefix();
+    test_buffer_prefix_over_mode_command();
+    test_same_sequence_replaced();
+
+    return test_failures != 0;
+}
@@ -19,6 +19,10 @@
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <iterator>
+#include <string>
+#include <utility>
+#include <vector>
 
 #include <fcntl.h>
 #include <pwd.h>
@@ -28,6 +32,9 @@
 #include <unistd.h>
 
 #include <ked/Extension.hh>
+#include <ked/Face.hh>
+#include <ked/Profile.hh>
+#include <ked/Ui.hh>
 
 #include "libked/libked.hh"
 
@@ -83,92 +90,347 @@ static char *path_expand(const char *path) {
     return result;
 }
 
-static inline void skip_spaces(const char *content, size_t *off, size_t len) {
-    while (*off < len) {
-        if (content[*off] == '\n' || content[*off] == '\r' ||
-            content[*off] == ' ' || content[*off] == '\t')
-            ++(*off);
-        else
+/* Argument of a statement, which is either a string or an integer. */
+struct Arg {
+    bool is_string;
+    std::string str;
+    long num;
+};
+
+/* Statement in the form of name(arg, ...);. */
+struct Statement {
+    std::string name;
+    std::vector<Arg> args;
+    unsigned int line;
+};
+
+struct Parser {
+    const char *content;
+    size_t len;
+    size_t off;
+    unsigned int line;
+};
+
+struct KeyBinding {
+    /* Empty for the global keymap. */
+    std::string mode;
+    std::string key;
+    std::string command;
+};
+
+static const char *config_name;
+static std::vector<std::string> extension_paths;
+static std::vector<KeyBinding> key_bindings;
+/* Bindings declared by manifests of autoloaded extensions, which are
+ * overridden by the ones of the user. */
+static std::vector<KeyBinding> manifest_bindings;
+/* Commands declared by the manifest being read. */
+static std::vector<std::string> manifest_commands;
+static std::vector<std::pair<std::string, Ked::Face::Attributes>> faces;
+
+static void print_config_error(unsigned int line, std::string const &msg) {
+    fprintf(stderr, "%s: %s:%u: %s\n", PROGRAM_NAME, config_name, line,
+            msg.c_str());
+}
+
+/* Skips white spaces and comments, which start with # and last until the end
+ * of line. */
+static void skip_spaces(Parser &p) {
+    while (p.off < p.len) {
+        char c = p.content[p.off];
+        if (c == '#') {
+            while (p.off < p.len && p.content[p.off] != '\n') ++p.off;
+        } else if (c == '\n') {
+            ++p.line;
+            ++p.off;
+        } else if (c == '\r' || c == ' ' || c == '\t') {
+            ++p.off;
+        } else {
             break;
+        }
     }
 }
 
-static bool parse_and_eval(const char *content, size_t len) {
-    // temporary implementation
-    size_t off = 0;
-    skip_spaces(content, &off, len);
-    if (strncmp(content + (off), "loadSystemExtension", 19) != 0) {
-        return 0;
+static bool is_ident_char(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+           (c >= '0' && c <= '9') || c == '_';
+}
+
+static bool parse_string(Parser &p, std::string &out) {
+    char quote = p.content[p.off++];
+    while (p.off < p.len) {
+        char c = p.content[p.off++];
+        if (c == quote) return true;
+        if (c == '\n') break;
+
+        if (c == '\\' && p.off < p.len) {
+            c = p.content[p.off++];
+            if (c == 'n')
+                c = '\n';
+            else if (c == 't')
+                c = '\t';
+            else if (c == 'e')
+                c = '\e';
+        }
+        out.push_back(c);
     }
-    off += 19;
-    skip_spaces(content, &off, len);
-    if (content[off] != '(') {
-        return 0;
+
+    print_config_error(p.line, "Unterminated string");
+
+    return false;
+}
+
+static bool parse_arg(Parser &p, Arg &arg) {
+    char c = p.content[p.off];
+    if (c == '"' || c == '\'') {
+        arg.is_string = true;
+        arg.num = 0;
+
+        return parse_string(p, arg.str);
+    }
+
+    if (c == '-' || (c >= '0' && c <= '9')) {
+        std::string digits;
+        while (p.off < p.len && (is_ident_char(p.content[p.off]) ||
+                                 p.content[p.off] == '-'))
+            digits.push_back(p.content[p.off++]);
+
+        char *end;
+        arg.is_string = false;
+        arg.num = strtol(digits.c_str(), &end, 0);
+        if (*end == 0) return true;
+
+        print_config_error(p.line, "Invalid number: " + digits);
+
+        return false;
+    }
+
+    print_config_error(p.line, "String or number expected");
+
+    return false;
+}
+
+/* Parses a statement, and returns false on error or at the end. */
+static bool parse_statement(Parser &p, Statement &stmt, bool &error) {
+    error = true;
+
+    skip_spaces(p);
+    if (p.off >= p.len) {
+        error = false;
+
+        return false;
+    }
+
+    stmt.line = p.line;
+    while (p.off < p.len && is_ident_char(p.content[p.off]))
+        stmt.name.push_back(p.content[p.off++]);
+    if (stmt.name.empty()) {
+        print_config_error(p.line, "Statement expected");
+
+        return false;
+    }
+
+    skip_spaces(p);
+    if (p.off >= p.len || p.content[p.off] != '(') {
+        print_config_error(p.line, "( expected after " + stmt.name);
+
+        return false;
     }
-    ++off;
-    skip_spaces(content, &off, len);
-    size_t start, end = 0;
-    if (content[off] == '"') {
-        ++off;
-        start = off;
-        while (off < len) {
-            if (content[off] == '"') {
-                end = off;
-                break;
-            } else
-                ++off;
+    ++p.off;
+
+    skip_spaces(p);
+    while (p.off < p.len && p.content[p.off] != ')') {
+        if (!stmt.args.empty()) {
+            if (p.content[p.off] != ',') {
+                print_config_error(p.line, ", or ) expected");
+
+                return false;
+            }
+            ++p.off;
+            skip_spaces(p);
+            if (p.off >= p.len) break;
         }
-    } else if (content[off] == '\'') {
-        ++off;
-        start = off;
-        while (off < len) {
-            if (content[off] == '\'') {
-                end = off;
-                break;
-            } else
-                ++off;
+
+        Arg arg;
+        if (!parse_arg(p, arg)) return false;
+        stmt.args.push_back(arg);
+        skip_spaces(p);
+    }
+    if (p.off >= p.len) {
+        print_config_error(p.line, ") expected");
+
+        return false;
+    }
+    ++p.off;
+
+    skip_spaces(p);
+    if (p.off < p.len && p.content[p.off] == ';') ++p.off;
+
+    error = false;
+
+    return true;
+}
+
+static bool check_args(Statement const &stmt, const char *types) {
+    size_t n = strlen(types);
+    bool ok = stmt.args.size() == n;
+    for (size_t i = 0; ok && i < n; ++i)
+        ok = stmt.args[i].is_string == (types[i] == 's');
+
+    if (!ok) {
+        std::string expected;
+        for (size_t i = 0; i < n; ++i) {
+            if (i != 0) expected += ", ";
+            expected += types[i] == 's' ? "string" : "number";
         }
+        print_config_error(stmt.line,
+                           stmt.name + " takes (" + expected + ")");
+    }
+
+    return ok;
+}
+
+/* Converts color argument, which is a palette index, "#RRGGBB" or
+ * "default". */
+static bool parse_color(Statement const &stmt, Arg const &arg,
+                        Ked::Face::Color &color) {
+    if (!arg.is_string) {
+        if (arg.num < 0 || arg.num > 255) {
+            print_config_error(stmt.line, "Color index out of range");
+
+            return false;
+        }
+        color = Ked::Face::color_256(arg.num);
+
+        return true;
+    }
+
+    if (arg.str == "default") {
+        color = Ked::Face::default_color();
+
+        return true;
+    }
+
+    char *end;
+    if (arg.str.size() == 7 && arg.str[0] == '#') {
+        unsigned long rgb = strtoul(arg.str.c_str() + 1, &end, 16);
+        if (*end == 0) {
+            color = Ked::Face::color_rgb(rgb);
+
+            return true;
+        }
+    }
+
+    print_config_error(stmt.line, "Invalid color: " + arg.str);
+
+    return false;
+}
+
+static bool parse_flag(Statement const &stmt, Arg const &arg,
+                       unsigned int &flags) {
+    static const char *const names[] = {"bold", "dim", "italic", "underline",
+                                        "reverse"};
+    static const unsigned int values[] = {
+        Ked::Face::BOLD, Ked::Face::DIM, Ked::Face::ITALIC,
+        Ked::Face::UNDERLINE, Ked::Face::REVERSE};
+
+    for (size_t i = 0; i < sizeof(names) / sizeof(*names); ++i) {
+        if (arg.is_string && arg.str == names[i]) {
+            flags |= values[i];
+
+            return true;
+        }
+    }
+
+    print_config_error(stmt.line, "Invalid attribute: " + arg.str);
+
+    return false;
+}
+
+static bool eval_face(Statement const &stmt) {
+    if (stmt.args.size() < 3 || !stmt.args[0].is_string) {
+        print_config_error(stmt.line,
+                           "setFace takes (name, fg, bg, attribute...)");
+
+        return false;
+    }
+
+    Ked::Face::Color fg, bg;
+    unsigned int flags = 0;
+    if (!parse_color(stmt, stmt.args[1], fg) ||
+        !parse_color(stmt, stmt.args[2], bg))
+        return false;
+    for (size_t i = 3; i < stmt.args.size(); ++i)
+        if (!parse_flag(stmt, stmt.args[i], flags)) return false;
+
+    faces.push_back(std::make_pair(stmt.args[0].str,
+                                   Ked::Face::attributes(fg, bg, flags)));
+
+    return true;
+}
+
+static bool eval_key_binding(Statement const &stmt,
+                             std::vector<KeyBinding> &bindings) {
+    if (stmt.name == "bindKey") {
+        if (!check_args(stmt, "ss")) return false;
+
+        bindings.push_back(KeyBinding{"", stmt.args[0].str, stmt.args[1].str});
     } else {
-        return 0;
+        if (!check_args(stmt, "sss")) return false;
+
+        bindings.push_back(KeyBinding{stmt.args[0].str, stmt.args[1].str,
+                                      stmt.args[2].str});
     }
 
-    if (end == 0) return 0;
+    return true;
+}
 
-    char *path = (char *)malloc(sizeof(char) * (end - start + 1));
-    memcpy(path, content + start, end - start);
-    path[end - start] = 0;
+/* Evaluates a statement of extension manifest, which declares commands of
+ * the extension and keys bound to them by default. */
+static bool eval_manifest(Statement const &stmt) {
+    if (stmt.name == "command") {
+        if (!check_args(stmt, "s")) return false;
 
-    char *expanded = path_expand(path);
-    free(path);
+        manifest_commands.push_back(stmt.args[0].str);
 
-    bool res = Ked::Extension::load(expanded);
+        return true;
+    } else if (stmt.name == "bindKey" || stmt.name == "bindModeKey") {
+        return eval_key_binding(stmt, manifest_bindings);
+    }
 
-    free(expanded);
+    print_config_error(stmt.line, "Unknown statement: " + stmt.name);
 
-    return res;
+    return false;
 }
 
-bool userpref_load(bool debug) {
-    if (!detect_home_dir()) return 0;
+static bool parse_and_eval(const char *content, size_t len,
+                           bool (*eval)(Statement const &)) {
+    Parser p{content, len, 0, 1};
 
-    char *file_name;
-    if (debug)
-        file_name = path_expand("etc/kedrc");
-    else
-        file_name = path_expand("~/.kedrc");
+    for (;;) {
+        Statement stmt;
+        bool error;
+        if (!parse_statement(p, stmt, error)) return !error;
 
+        if (!eval(stmt)) return false;
+    }
+}
+
+/* Reads file_name and evaluates its statements with eval. */
+static bool eval_file(const char *file_name,
+                      bool (*eval)(Statement const &)) {
     struct stat stat_buf;
     if (stat(file_name, &stat_buf) == -1) {
         print_error_2(file_name, strerror(errno));
-        free(file_name);
 
         return false;
     }
+    /* Empty file cannot be mapped. */
+    if (stat_buf.st_size == 0) return true;
 
     int fd = open(file_name, O_RDONLY);
     if (fd < 0) {
         print_error_2(file_name, strerror(errno));
-        free(file_name);
 
         return false;
     }
@@ -178,14 +440,141 @@ bool userpref_load(bool debug) {
     if (config == MAP_FAILED) {
         print_error_2(file_name, strerror(errno));
         close(fd);
-        free(file_name);
 
         return false;
     }
 
-    bool s = parse_and_eval(config, stat_buf.st_size);
+    const char *prev_name = config_name;
+    config_name = file_name;
+    bool s = parse_and_eval(config, stat_buf.st_size, eval);
+    config_name = prev_name;
 
+    munmap(config, stat_buf.st_size);
     close(fd);
+
+    return s;
+}
+
+/* Returns path of the manifest of extension at path, which is foo.manifest
+ * for foo.so. */
+static std::string manifest_path(std::string const &path) {
+    std::string result = path;
+    if (result.size() > 3 &&
+        result.compare(result.size() - 3, 3, ".so") == 0)
+        result.resize(result.size() - 3);
+
+    return result + ".manifest";
+}
+
+/* Evaluates a statement. Extensions are only collected here and loaded
+ * together after the whole file is read. Key bindings and faces are applied
+ * once the extensions are attached to the UI, so that they override the
+ * defaults of extensions. */
+static bool eval(Statement const &stmt) {
+    if (stmt.name == "loadSystemExtension" || stmt.name == "loadExtension") {
+        if (!check_args(stmt, "s")) return false;
+
+        char *expanded = path_expand(stmt.args[0].str.c_str());
+        extension_paths.push_back(expanded);
+        free(expanded);
+
+        return true;
+    } else if (stmt.name == "autoloadExtension") {
+        if (!check_args(stmt, "s")) return false;
+
+        char *expanded = path_expand(stmt.args[0].str.c_str());
+        std::string path = expanded;
+        free(expanded);
+
+        manifest_commands.clear();
+        if (!eval_file(manifest_path(path).c_str(), eval_manifest))
+            return false;
+        Ked::Extension::autoload(path, manifest_commands);
+
+        return true;
+    } else if (stmt.name == "bindKey" || stmt.name == "bindModeKey") {
+        return eval_key_binding(stmt, key_bindings);
+    } else if (stmt.name == "setFace") {
+        return eval_face(stmt);
+    }
+
+    print_config_error(stmt.line, "Unknown statement: " + stmt.name);
+
+    return false;
+}
+
+/* Binds keys to commands, which are looked up in ui. Missing commands are
+ * reported if report is true. */
+static void apply_key_bindings(Ked::Ui &ui,
+                               std::vector<KeyBinding> const &bindings,
+                               bool report) {
+    for (auto itr = std::begin(bindings); itr != std::end(bindings); ++itr) {
+        Ked::KeyHandling::EditorCommand const *command =
+            ui.find_command(itr->command);
+        if (command == nullptr) {
+            if (report) ui.write_message("No such command: " + itr->command);
+
+            continue;
+        }
+
+        /* Time spent in the key is of the extension of the command. */
+        Ked::Profile::Owner owner(ui.command_owner(itr->command));
+
+        if (itr->mode.empty())
+            ui.add_global_keybind(itr->key, *command);
+        else
+            ui.add_mode_keybind(itr->mode, itr->key, *command);
+    }
+}
+
+void userpref_attach_ui(Ked::Ui &ui) {
+    for (auto itr = std::begin(faces); itr != std::end(faces); ++itr)
+        Ked::Face::add(itr->first, itr->second);
+
+    apply_key_bindings(ui, manifest_bindings, true);
+    apply_key_bindings(ui, key_bindings, true);
+
+    /* Autoloaded extension binds its defaults over them when it runs. */
+    Ked::Extension::on_autoload_attached([](Ked::Ui &ui) {
+        apply_key_bindings(ui, manifest_bindings, false);
+        apply_key_bindings(ui, key_bindings, false);
+    });
+}
+
+bool userpref_load(bool debug, bool has_builtin) {
+    if (!detect_home_dir()) return 0;
+
+    char *file_name;
+    if (debug)
+        file_name = path_expand("etc/kedrc");
+    else
+        file_name = path_expand("~/.kedrc");
+
+    struct stat stat_buf;
+    if (has_builtin && stat(file_name, &stat_buf) == -1 && errno == ENOENT) {
+        free(file_name);
+
+        return true;
+    }
+
+    if (!eval_file(file_name, eval)) {
+        free(file_name);
+
+        return false;
+    }
+
+    if (extension_paths.empty() && !has_builtin) {
+        print_error_2(file_name, "No extension is loaded");
+        free(file_name);
+
+        return false;
+    }
+
+    std::vector<std::string> errors;
+    bool s = Ked::Extension::load_all(extension_paths, errors);
+    for (auto itr = std::begin(errors); itr != std::end(errors); ++itr)
+        print_error_2(file_name, itr->c_str());
+
     free(file_name);
 
     return s;